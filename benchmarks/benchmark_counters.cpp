@@ -0,0 +1,64 @@
+#include "benchmark_counters.h"
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic<uint64_t> allocation_count{0};
+
+double GetPeakRssKilobytes() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+    // Bytes on macOS, kilobytes elsewhere.
+    return static_cast<double>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<double>(usage.ru_maxrss);
+#endif
+  }
+#endif
+  return 0;
+}
+
+}  // namespace
+
+#if defined(SCRATCH_BENCHMARK_COUNT_ALLOCATIONS)
+// The generated program is linked with -Wl,--wrap=malloc and friends, so its calls end up here.
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __real_realloc(pointer, size);
+}
+}
+#endif
+
+uint64_t GetAllocationCount() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+void ReportTickCounters(benchmark::State& state, uint64_t allocations) {
+  state.counters["ticks/s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["allocs/tick"] =
+      benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+  state.counters["peak_rss_kb"] = GetPeakRssKilobytes();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+// Number of malloc, calloc and realloc calls made by the generated program so far. Counted only when the
+// build wraps them (SCRATCH_BENCHMARK_COUNT_ALLOCATIONS), always 0 otherwise.
+uint64_t GetAllocationCount();
+
+// Reports ticks per second, allocations per tick and the peak RSS of the process. Every iteration of
+// |state| must be a single tick, |allocations| are made by all the iterations.
+void ReportTickCounters(benchmark::State& state, uint64_t allocations);
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include "benchmark_counters.h"
+
+// Header of the transpiled program, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+// Runs the first tick of the program, e.g. the whole generated long script advances within it.
+static void BM_FirstTick(benchmark::State& state) {
+  ScratchContext* ctx = Scratch_NewContext();
+  ScratchVariable* counter = Scratch_FindVariable(ctx, "Stage", "Counter");
+  uint64_t allocations = GetAllocationCount();
+  for (auto _ : state) {
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    Scratch_Advance(ctx, 1.0 / 30.0);
+    benchmark::DoNotOptimize(Scratch_ReadNumberVariable(counter));
+  }
+  ReportTickCounters(state, GetAllocationCount() - allocations);
+  Scratch_DeleteContext(ctx);
+}
+BENCHMARK(BM_FirstTick);
+
+// Baseline to subtract from BM_FirstTick.
+static void BM_Init(benchmark::State& state) {
+  ScratchContext* ctx = Scratch_NewContext();
+  ScratchVariable* counter = Scratch_FindVariable(ctx, "Stage", "Counter");
+  for (auto _ : state) {
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    benchmark::DoNotOptimize(Scratch_ReadNumberVariable(counter));
+  }
+  Scratch_DeleteContext(ctx);
+}
+BENCHMARK(BM_Init);
+
+// Ticks after the first one, e.g. all the generated sleeping scripts are waiting.
+static void BM_Tick(benchmark::State& state) {
+  ScratchContext* ctx = Scratch_NewContext();
+  ScratchVariable* counter = Scratch_FindVariable(ctx, "Stage", "Counter");
+  Scratch_Advance(ctx, 1.0 / 30.0);
+  uint64_t allocations = GetAllocationCount();
+  for (auto _ : state) {
+    Scratch_Advance(ctx, 1.0 / 30.0);
+    benchmark::DoNotOptimize(Scratch_ReadNumberVariable(counter));
+  }
+  ReportTickCounters(state, GetAllocationCount() - allocations);
+  Scratch_DeleteContext(ctx);
+}
+BENCHMARK(BM_Tick);
+
+BENCHMARK_MAIN();
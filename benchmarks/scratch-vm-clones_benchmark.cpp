@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-clones.h"
+#include "templates/scratch-vm-columns.h"
+
+namespace {
+
+// The former representation of clones: a singly linked list of heap nodes.
+struct LinkedClone {
+  ScratchNumber x;
+  ScratchNumber y;
+  ScratchNumber direction_x;
+  ScratchNumber direction_y;
+  LinkedClone* next;
+};
+
+LinkedClone* SpawnLinkedClones(int count) {
+  LinkedClone* clones = nullptr;
+  for (int i = 0; i < count; ++i) {
+    LinkedClone* clone = static_cast<LinkedClone*>(std::malloc(sizeof(LinkedClone)));
+    *clone = LinkedClone{0, 0, 1, 0, clones};
+    clones = clone;
+  }
+  return clones;
+}
+
+void DeleteLinkedClones(LinkedClone* clones) {
+  while (clones) {
+    LinkedClone* next = clones->next;
+    std::free(clones);
+    clones = next;
+  }
+}
+
+// A `change x by` block called for a single clone, the way scripts of other blocks run clone by clone.
+__attribute__((noinline)) void ChangeCloneX(ScratchClonePool* pool, int index, ScratchNumber delta) {
+  pool->x[index] += delta;
+}
+
+}  // namespace
+
+// Spawns state.range(0) clones and deletes all of them.
+static void BM_SpawnClones(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+  for (auto _ : state) {
+    for (int i = 0; i < count; ++i) {
+      Scratch_CreateClone(&pool, 0, 0, 1, 0);
+    }
+    for (int i = 0; i < count; ++i) {
+      Scratch_DeleteClone(&pool, i);
+    }
+  }
+  Scratch_FreeClonePool(&pool);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_SpawnClones)->Arg(10000)->Arg(100000);
+
+static void BM_SpawnLinkedClones(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    DeleteLinkedClones(SpawnLinkedClones(count));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_SpawnLinkedClones)->Arg(10000)->Arg(100000);
+
+// Mirrors a per-clone `move (direction)` script over state.range(0) clones.
+static void BM_MoveClones(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+  for (int i = 0; i < count; ++i) {
+    Scratch_CreateClone(&pool, 0, 0, 1, 0);
+  }
+  for (auto _ : state) {
+    for (int i = 0; i < pool.count; ++i) {
+      pool.x[i] += pool.direction_x[i];
+      pool.y[i] += pool.direction_y[i];
+    }
+    benchmark::ClobberMemory();
+  }
+  Scratch_FreeClonePool(&pool);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_MoveClones)->Arg(10000)->Arg(100000);
+
+static void BM_MoveLinkedClones(benchmark::State& state) {
+  LinkedClone* clones = SpawnLinkedClones(static_cast<int>(state.range(0)));
+  for (auto _ : state) {
+    for (LinkedClone* clone = clones; clone; clone = clone->next) {
+      clone->x += clone->direction_x;
+      clone->y += clone->direction_y;
+    }
+    benchmark::ClobberMemory();
+  }
+  DeleteLinkedClones(clones);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MoveLinkedClones)->Arg(10000)->Arg(100000);
+
+// `change x by 1` in a "when I start as a clone" script, started for state.range(0) clones at once.
+static void BM_ChangeXKernel(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+  for (int i = 0; i < count; ++i) {
+    Scratch_CreateClone(&pool, 0, 0, 1, 0);
+  }
+  for (auto _ : state) {
+    Scratch_AddToColumn(pool.x, pool.count, 1);
+    benchmark::ClobberMemory();
+  }
+  Scratch_FreeClonePool(&pool);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ChangeXKernel)->Arg(10000)->Arg(100000);
+
+static void BM_ChangeXPerClone(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+  for (int i = 0; i < count; ++i) {
+    Scratch_CreateClone(&pool, 0, 0, 1, 0);
+  }
+  for (auto _ : state) {
+    for (int i = 0; i < pool.count; ++i) {
+      ChangeCloneX(&pool, i, 1);
+    }
+    benchmark::ClobberMemory();
+  }
+  Scratch_FreeClonePool(&pool);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ChangeXPerClone)->Arg(10000)->Arg(100000);
@@ -0,0 +1,158 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-variables-public.h"
+#include "templates/scratch-vm-variables-internal.h"
+#include "templates/scratch-vm-lists.h"
+
+namespace {
+
+void AddNumbers(ScratchList* list, int count) {
+  for (int i = 0; i < count; ++i) {
+    Scratch_AddNumberToList(list, i);
+  }
+}
+
+// Words like "item 42", longer than inline strings from "item 1000000" on.
+std::vector<std::string> MakeWords(int count) {
+  std::vector<std::string> words;
+  for (int i = 0; i < count; ++i) {
+    words.push_back("item " + std::to_string(i));
+  }
+  return words;
+}
+
+void AddWords(ScratchList* list, const std::vector<std::string>& words) {
+  for (const std::string& word : words) {
+    ScratchVariable item;
+    Scratch_InitStringVariable(&item, word.c_str(), /*is_const_str_value=*/ 1);
+    Scratch_AddToList(list, &item);
+  }
+}
+
+// The index of every lookup, spread over the list.
+int LookupIndex(int lookup, int count) {
+  return static_cast<int>((static_cast<int64_t>(lookup) * 7919) % count);
+}
+
+}  // namespace
+
+// `add (i) to [list]` state.range(0) times into an empty list.
+static void BM_AddNumbers(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    ScratchList list;
+    Scratch_InitList(&list);
+    AddNumbers(&list, count);
+    benchmark::DoNotOptimize(list.numbers);
+    Scratch_FreeList(&list);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_AddNumbers)->Arg(100000)->Arg(SCRATCH_VM_LIST_ITEM_LIMIT);
+
+static void BM_AddStrings(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  const std::vector<std::string> words = MakeWords(count);
+  for (auto _ : state) {
+    ScratchList list;
+    Scratch_InitList(&list);
+    AddWords(&list, words);
+    benchmark::DoNotOptimize(list.items);
+    Scratch_FreeList(&list);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_AddStrings)->Arg(100000)->Arg(SCRATCH_VM_LIST_ITEM_LIMIT);
+
+// `item (i) of [list]` over a list of state.range(0) numbers, read as numbers.
+static void BM_ItemOfNumbers(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchList list;
+  Scratch_InitList(&list);
+  AddNumbers(&list, count);
+  int lookup = 0;
+  for (auto _ : state) {
+    ScratchVariable item = Scratch_GetListItem(&list, LookupIndex(lookup++, count) + 1);
+    benchmark::DoNotOptimize(Scratch_ReadNumberVariable(&item));
+  }
+  Scratch_FreeList(&list);
+}
+BENCHMARK(BM_ItemOfNumbers)->Arg(100000);
+
+// `item # of (i) in [list]` over a list of state.range(0) numbers, items are found all over the list.
+static void BM_FindNumber(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  const bool is_indexed = state.range(1) != 0;
+  ScratchList list;
+  Scratch_InitList(&list);
+  if (is_indexed) {
+    Scratch_EnableListIndex(&list);
+  }
+  AddNumbers(&list, count);
+  int lookup = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Scratch_FindListNumber(&list, LookupIndex(lookup++, count)));
+  }
+  Scratch_FreeList(&list);
+}
+BENCHMARK(BM_FindNumber)->ArgNames({"items", "indexed"})->Args({100000, 0})->Args({100000, 1});
+
+// The same with strings compared case insensitively.
+static void BM_FindString(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  const bool is_indexed = state.range(1) != 0;
+  const std::vector<std::string> words = MakeWords(count);
+  ScratchList list;
+  Scratch_InitList(&list);
+  if (is_indexed) {
+    Scratch_EnableListIndex(&list);
+  }
+  AddWords(&list, words);
+  int lookup = 0;
+  for (auto _ : state) {
+    ScratchVariable item;
+    Scratch_InitStringVariable(&item, words[LookupIndex(lookup++, count)].c_str(), /*is_const_str_value=*/ 1);
+    benchmark::DoNotOptimize(Scratch_FindListItem(&list, item));
+  }
+  Scratch_FreeList(&list);
+}
+BENCHMARK(BM_FindString)->ArgNames({"items", "indexed"})->Args({100000, 0})->Args({100000, 1});
+
+// `replace item (i) of [list] with (i)` followed by a lookup, the index is rebuilt every other lookup at most.
+static void BM_ReplaceAndFind(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchList list;
+  Scratch_InitList(&list);
+  Scratch_EnableListIndex(&list);
+  AddNumbers(&list, count);
+  int lookup = 0;
+  for (auto _ : state) {
+    const int index = LookupIndex(lookup++, count);
+    Scratch_ReplaceListItemWithNumber(&list, index + 1, index);
+    benchmark::DoNotOptimize(Scratch_FindListNumber(&list, index));
+  }
+  Scratch_FreeList(&list);
+}
+BENCHMARK(BM_ReplaceAndFind)->Arg(100000);
+
+// `delete (last) of [list]` until the list of state.range(0) numbers is empty.
+static void BM_DeleteLast(benchmark::State& state) {
+  const int count = static_cast<int>(state.range(0));
+  ScratchList list;
+  Scratch_InitList(&list);
+  for (auto _ : state) {
+    state.PauseTiming();
+    AddNumbers(&list, count);
+    state.ResumeTiming();
+    while (Scratch_GetListLength(&list) > 0) {
+      Scratch_DeleteListItem(&list, Scratch_GetListLength(&list));
+    }
+  }
+  Scratch_FreeList(&list);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_DeleteLast)->Arg(100000);
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+
+#include "templates/scratch-vm-variables-internal.h"
+
+// Mirrors `set variable to (value)` with a literal right-hand side.
+static void BM_AssignLiteral(benchmark::State& state, const char* literal) {
+  ScratchVariable literal_variable;
+  Scratch_InitStringVariable(&literal_variable, literal, /*is_const_str_value=*/ 1);
+
+  ScratchVariable variable;
+  Scratch_InitVariable(&variable);
+
+  for (auto _ : state) {
+    Scratch_AssignVariable(&variable, &literal_variable);
+    benchmark::DoNotOptimize(Scratch_ReadStringVariable(&variable));
+  }
+
+  Scratch_FreeVariable(&variable);
+  Scratch_FreeVariable(&literal_variable);
+}
+BENCHMARK_CAPTURE(BM_AssignLiteral, short, "banana");
+BENCHMARK_CAPTURE(BM_AssignLiteral, long, "chicken banana chicken banana chicken banana");
+
+// Mirrors `set variable to (join (a) (b))` as emitted by the transpiler.
+static void BM_JoinAndAssign(benchmark::State& state, const char* s1, const char* s2) {
+  ScratchVariable variable1;
+  Scratch_InitStringVariable(&variable1, s1, /*is_const_str_value=*/ 1);
+
+  ScratchVariable variable2;
+  Scratch_InitStringVariable(&variable2, s2, /*is_const_str_value=*/ 1);
+
+  ScratchVariable variable;
+  Scratch_InitVariable(&variable);
+
+  ScratchArena arena;
+  Scratch_InitArena(&arena);
+
+  for (auto _ : state) {
+    ScratchVariable joined = Scratch_JoinStringVariables(&arena, &variable1, &variable2);
+    Scratch_AssignVariable(&variable, &joined);
+    Scratch_ResetArena(&arena);
+    benchmark::DoNotOptimize(Scratch_ReadStringVariable(&variable));
+  }
+
+  Scratch_FreeArena(&arena);
+
+  Scratch_FreeVariable(&variable);
+  Scratch_FreeVariable(&variable1);
+  Scratch_FreeVariable(&variable2);
+}
+BENCHMARK_CAPTURE(BM_JoinAndAssign, short, "chicken ", "banana");
+BENCHMARK_CAPTURE(BM_JoinAndAssign, long, "chicken banana chicken banana ", "chicken banana");
+
+// Mirrors copying one variable into another, e.g. `set a to (b)`.
+static void BM_AssignVariable(benchmark::State& state, const char* str) {
+  ScratchVariable source;
+  Scratch_InitVariable(&source);
+  Scratch_AssignStringVariable(&source, str);
+
+  ScratchVariable variable;
+  Scratch_InitVariable(&variable);
+
+  for (auto _ : state) {
+    Scratch_AssignVariable(&variable, &source);
+    benchmark::DoNotOptimize(Scratch_ReadStringVariable(&variable));
+  }
+
+  Scratch_FreeVariable(&variable);
+  Scratch_FreeVariable(&source);
+}
+BENCHMARK_CAPTURE(BM_AssignVariable, short, "banana");
+BENCHMARK_CAPTURE(BM_AssignVariable, long, "chicken banana chicken banana chicken banana");
+
+// Mirrors reading a variable in a numeric expression. Strings are converted once and the number is cached.
+static void BM_ReadNumber(benchmark::State& state, const char* str) {
+  ScratchVariable variable;
+  if (str) {
+    Scratch_InitStringVariable(&variable, str, /*is_const_str_value=*/ 1);
+  } else {
+    Scratch_InitNumberVariable(&variable, 42);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(&variable);
+    benchmark::DoNotOptimize(Scratch_ReadNumberVariable(&variable));
+  }
+
+  Scratch_FreeVariable(&variable);
+}
+BENCHMARK_CAPTURE(BM_ReadNumber, number, nullptr);
+BENCHMARK_CAPTURE(BM_ReadNumber, numeric_string, "42");
+
+// Mirrors `set a to (a + 1)` for a variable holding a numeric string: the first read converts it.
+static void BM_IncrementString(benchmark::State& state) {
+  ScratchVariable variable;
+  for (auto _ : state) {
+    Scratch_InitStringVariable(&variable, "42", /*is_const_str_value=*/ 1);
+    Scratch_AssignNumberVariable(&variable, Scratch_ReadNumberVariable(&variable) + 1);
+    benchmark::DoNotOptimize(&variable);
+  }
+
+  Scratch_FreeVariable(&variable);
+}
+BENCHMARK(BM_IncrementString);
+
+// Mirrors joining a number, e.g. `join (score) [ points]`. The string is printed on the first read only.
+static void BM_ReadNumberAsString(benchmark::State& state, bool assign) {
+  ScratchVariable variable;
+  Scratch_InitNumberVariable(&variable, 0.1);
+
+  for (auto _ : state) {
+    if (assign) {
+      Scratch_AssignNumberVariable(&variable, 0.1);
+    }
+    benchmark::DoNotOptimize(&variable);
+    benchmark::DoNotOptimize(Scratch_ReadStringVariable(&variable));
+  }
+
+  Scratch_FreeVariable(&variable);
+}
+BENCHMARK_CAPTURE(BM_ReadNumberAsString, cached, false);
+BENCHMARK_CAPTURE(BM_ReadNumberAsString, after_assign, true);
+
+BENCHMARK_MAIN();
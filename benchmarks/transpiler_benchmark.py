@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+import argparse
+import importlib.util
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+import zipfile
+
+kRepositoryRoot = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def parse_arguments() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Measures transpile time of generated programs against their block count"
+    )
+
+    parser.add_argument(
+        "--kind",
+        default="long-script",
+        help="Kind of the generated program, see scripts/generate_stress_project.py.",
+    )
+    parser.add_argument(
+        "--sizes",
+        type=int,
+        nargs="+",
+        default=[500, 1000, 2000, 5000, 10000],
+        help="Sizes of the generated programs.",
+    )
+    parser.add_argument(
+        "--repetitions", type=int, default=3, help="The best of this many runs is reported."
+    )
+
+    return parser.parse_args()
+
+
+def load_transpiler():
+    # The templates are loaded by the module name, so it must be importable from the repository root.
+    sys.path.insert(0, kRepositoryRoot)
+    spec = importlib.util.spec_from_file_location(
+        "scratch-transpiler", os.path.join(kRepositoryRoot, "scratch-transpiler.py")
+    )
+    transpiler = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(transpiler)
+    return transpiler
+
+
+def best_time(function, repetitions: int) -> float:
+    times = []
+    for _ in range(repetitions):
+        start = time.perf_counter()
+        function()
+        times.append(time.perf_counter() - start)
+    return min(times)
+
+
+def main():
+    args = parse_arguments()
+    transpiler = load_transpiler()
+
+    print(
+        f"{'blocks':>8} {'read (s)':>10} {'front end (s)':>14} {'total (s)':>10} {'cached (s)':>11}"
+    )
+    with tempfile.TemporaryDirectory() as directory:
+        for size in args.sizes:
+            sb3_path = os.path.join(directory, f"{size}.sb3")
+            subprocess.check_call(
+                [
+                    sys.executable,
+                    os.path.join(kRepositoryRoot, "scripts", "generate_stress_project.py"),
+                    "--kind",
+                    args.kind,
+                    "--size",
+                    str(size),
+                    "-o",
+                    sb3_path,
+                ]
+            )
+            with zipfile.ZipFile(sb3_path) as file:
+                with file.open("project.json") as project_file:
+                    block_count = sum(
+                        len(t["blocks"]) for t in json.load(project_file)["targets"]
+                    )
+
+            read_time = best_time(
+                lambda: transpiler.read_scratch_program(sb3_path), args.repetitions
+            )
+            # Blocks are annotated while indexing, every run starts from a freshly read program.
+            front_end_time = best_time(
+                lambda: transpiler.extract_targets_blocks_and_variables(
+                    transpiler.read_scratch_program(sb3_path)
+                ),
+                args.repetitions,
+            ) - read_time
+
+            output_stem = os.path.join(directory, "program")
+
+            def transpile():
+                with open(os.devnull, "w") as null:
+                    subprocess.check_call(
+                        [
+                            sys.executable,
+                            os.path.join(kRepositoryRoot, "scratch-transpiler.py"),
+                            "-i",
+                            sb3_path,
+                            "-o",
+                            output_stem,
+                        ],
+                        stdout=null,
+                    )
+
+            def transpile_without_cache():
+                if os.path.exists(f"{output_stem}.cache.json"):
+                    os.remove(f"{output_stem}.cache.json")
+                transpile()
+
+            total_time = best_time(transpile_without_cache, args.repetitions)
+            # Nothing changed since the previous run, units of all the targets are skipped.
+            cached_time = best_time(transpile, args.repetitions)
+            print(
+                f"{block_count:>8} {read_time:>10.3f} {front_end_time:>14.3f} {total_time:>10.3f} "
+                f"{cached_time:>11.3f}",
+                flush=True,
+            )
+
+
+if __name__ == "__main__":
+    main()
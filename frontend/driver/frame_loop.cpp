@@ -0,0 +1,90 @@
+#include "frame_loop.h"
+
+#include <algorithm>
+#include <ostream>
+#include <thread>
+
+namespace scratch {
+
+double FrameStats::AverageFrameSeconds() const {
+  return frames > 0 ? frame_seconds_total / static_cast<double>(frames) : 0;
+}
+
+double FrameStats::AverageTickSeconds() const {
+  return ticks > 0 ? tick_seconds_total / static_cast<double>(ticks) : 0;
+}
+
+void FrameStats::Print(std::ostream& out) const {
+  out << "frames: " << frames << "\n"
+      << "ticks: " << ticks << "\n"
+      << "dropped ticks: " << dropped_ticks << "\n"
+      << "frame ms min/avg/max: " << frame_seconds_min * 1e3 << "/" << AverageFrameSeconds() * 1e3 << "/"
+      << frame_seconds_max * 1e3 << "\n"
+      << "tick ms avg/max: " << AverageTickSeconds() * 1e3 << "/" << tick_seconds_max * 1e3 << "\n";
+}
+
+FrameLoop::FrameLoop(ScratchContext* ctx, AdvanceFunction advance, const FrameLoopOptions& options)
+    : ctx_(ctx), advance_(advance), options_(options), tick_seconds_(1.0 / options.ticks_per_second) {}
+
+size_t FrameLoop::Update(double elapsed_seconds) {
+  elapsed_seconds = std::max(0.0, elapsed_seconds);
+  if (stats_.frames == 0 || elapsed_seconds < stats_.frame_seconds_min) {
+    stats_.frame_seconds_min = elapsed_seconds;
+  }
+  stats_.frame_seconds_max = std::max(stats_.frame_seconds_max, elapsed_seconds);
+  stats_.frame_seconds_total += elapsed_seconds;
+  ++stats_.frames;
+
+  accumulator_ += elapsed_seconds;
+  size_t ticks = 0;
+  while (accumulator_ >= tick_seconds_) {
+    if (ticks == options_.max_ticks_per_frame) {
+      size_t dropped = static_cast<size_t>(accumulator_ / tick_seconds_);
+      stats_.dropped_ticks += dropped;
+      accumulator_ -= static_cast<double>(dropped) * tick_seconds_;
+      break;
+    }
+    AdvanceTick();
+    accumulator_ -= tick_seconds_;
+    ++ticks;
+  }
+  return ticks;
+}
+
+void FrameLoop::AdvanceTicks(size_t ticks) {
+  for (size_t i = 0; i < ticks; ++i) {
+    AdvanceTick();
+  }
+}
+
+double FrameLoop::GetInterpolationAlpha() const {
+  return std::min(accumulator_ / tick_seconds_, 1.0);
+}
+
+void FrameLoop::AdvanceTick() {
+  auto start = std::chrono::steady_clock::now();
+  advance_(ctx_, tick_seconds_);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  stats_.tick_seconds_max = std::max(stats_.tick_seconds_max, seconds);
+  stats_.tick_seconds_total += seconds;
+  ++stats_.ticks;
+}
+
+FramePacer::FramePacer(double frames_per_second)
+    : period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frames_per_second))),
+      next_frame_(Clock::now() + period_) {}
+
+void FramePacer::Wait() {
+  auto now = Clock::now();
+  if (now < next_frame_) {
+    std::this_thread::sleep_until(next_frame_);
+    next_frame_ += period_;
+  } else if (now - next_frame_ > period_) {
+    next_frame_ = now + period_;
+  } else {
+    next_frame_ += period_;
+  }
+}
+
+}  // namespace scratch
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+
+#include "templates/scratch-vm-types.h"
+
+namespace scratch {
+
+struct FrameLoopOptions {
+  // Scratch advances its programs 30 times a second.
+  double ticks_per_second = 30;
+  // Ticks advanced at most in a single frame. After a stall, e.g. a breakpoint or a dragged window, the rest of
+  // the elapsed time is dropped instead of catching up with a burst of ticks, which would stall the next frame.
+  size_t max_ticks_per_frame = 5;
+};
+
+// Timing of the frames passed to FrameLoop::Update.
+struct FrameStats {
+  size_t frames = 0;
+  size_t ticks = 0;
+  // Ticks dropped because of FrameLoopOptions::max_ticks_per_frame.
+  size_t dropped_ticks = 0;
+
+  // Real time between frames.
+  double frame_seconds_min = 0;
+  double frame_seconds_max = 0;
+  double frame_seconds_total = 0;
+
+  // Time spent advancing the program.
+  double tick_seconds_max = 0;
+  double tick_seconds_total = 0;
+
+  double AverageFrameSeconds() const;
+  double AverageTickSeconds() const;
+
+  void Print(std::ostream& out) const;
+};
+
+// Advances a program by fixed ticks of 1 / ticks_per_second seconds, whatever the frame rate of the host is.
+//
+// Real time elapsed between frames is accumulated and spent on whole ticks, the remainder carries over to the
+// next frame. The program sees the same dt on every tick, so it runs the same in a headless run driven by
+// AdvanceTicks and on the desktop at any frame rate. Rendering between two ticks blends the states before and
+// after the last tick with GetInterpolationAlpha.
+class FrameLoop {
+ public:
+  using AdvanceFunction = void (*)(ScratchContext* ctx, ScratchNumber dt);
+
+  FrameLoop(ScratchContext* ctx, AdvanceFunction advance, const FrameLoopOptions& options = {});
+
+  // Starts a frame |elapsed_seconds| of real time after the previous one and advances the program by all the
+  // whole ticks the accumulated time covers. Returns the number of advanced ticks.
+  size_t Update(double elapsed_seconds);
+
+  // Advances the program by |ticks| ticks at once regardless of real time, e.g. in a headless run.
+  void AdvanceTicks(size_t ticks);
+
+  // Part of the next tick already elapsed in [0, 1): 0 renders the state after the last tick, values close to 1
+  // approach the state after the next one.
+  double GetInterpolationAlpha() const;
+
+  double GetTickSeconds() const { return tick_seconds_; }
+  const FrameStats& GetStats() const { return stats_; }
+
+ private:
+  void AdvanceTick();
+
+  ScratchContext* ctx_ = nullptr;
+  AdvanceFunction advance_ = nullptr;
+  FrameLoopOptions options_;
+  double tick_seconds_ = 0;
+  double accumulator_ = 0;
+  FrameStats stats_;
+};
+
+// Linear blend of a value before and after the last tick.
+inline double Interpolate(double previous, double current, double alpha) {
+  return previous + (current - previous) * alpha;
+}
+
+// Limits the frame rate by sleeping, for hosts whose presentation doesn't wait for vsync.
+class FramePacer {
+ public:
+  explicit FramePacer(double frames_per_second);
+
+  // Sleeps until the start of the next frame. A frame late by more than a whole period restarts the schedule
+  // instead of running the next frames without sleeping.
+  void Wait();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::duration period_;
+  Clock::time_point next_frame_;
+};
+
+}  // namespace scratch
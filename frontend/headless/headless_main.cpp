@@ -0,0 +1,48 @@
+// Header of the transpiled program, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "frame_loop.h"
+
+// Usage: <binary> [ticks] [--realtime]
+// Advances the program by |ticks| ticks as fast as possible, or in real time at 30 ticks per second with
+// --realtime, and prints the frame statistics.
+int main(int argc, char* argv[]) {
+  size_t ticks = 300;
+  bool realtime = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--realtime") == 0) {
+      realtime = true;
+    } else {
+      ticks = std::strtoull(argv[i], nullptr, 10);
+    }
+  }
+
+  ScratchContext* ctx = Scratch_NewContext();
+  scratch::FrameLoop loop(ctx, Scratch_Advance);
+
+  auto start = std::chrono::steady_clock::now();
+  if (realtime) {
+    scratch::FramePacer pacer(1.0 / loop.GetTickSeconds());
+    auto previous_frame = start;
+    while (loop.GetStats().ticks < ticks) {
+      pacer.Wait();
+      auto now = std::chrono::steady_clock::now();
+      loop.Update(std::chrono::duration<double>(now - previous_frame).count());
+      previous_frame = now;
+    }
+  } else {
+    loop.AdvanceTicks(ticks);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  loop.GetStats().Print(std::cout);
+  std::cout << "seconds: " << seconds << "\n";
+
+  Scratch_DeleteContext(ctx);
+  return 0;
+}
@@ -1,13 +1,45 @@
+// Header of the transpiled program, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
 #include <SDL.h>
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_loop.h"
+#include "sprite_renderer.h"
 
 extern "C" {
 int SDL_main(int argc, char *argv[]);
 }
 
-int SDL_main(int /* argc */, char */* argv */[]) {
+namespace {
+
+// Frame rate of the sleep based pacing when presenting doesn't wait for vsync.
+constexpr double kFallbackFramesPerSecond = 60;
+
+}  // namespace
+
+// Usage: <binary> [--ticks N] [--unpaced]
+// Runs the program until the window is closed or, with --ticks, for N ticks, then prints the frame statistics.
+// With --unpaced every frame advances a single tick without waiting, to measure the frame time, e.g. with
+// SDL_VIDEODRIVER=dummy and SDL_RENDER_DRIVER=software.
+int SDL_main(int argc, char* argv[]) {
+  size_t maxTicks = 0;
+  bool isUnpaced = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      maxTicks = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--unpaced") == 0) {
+      isUnpaced = true;
+    }
+  }
+
   int res = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER);
   if (res < 0) {
     std::cerr << "SDL_Init failed: " << SDL_GetError() << std::endl;
@@ -16,13 +48,51 @@ int SDL_main(int /* argc */, char */* argv */[]) {
 
   auto* pWindow =
       SDL_CreateWindow("test", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                       300, 200, SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN);
+                       480, 360, SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN);
   assert(pWindow);
 
-  auto* pRenderer = SDL_CreateRenderer(pWindow, -1, 0);
+  auto* pRenderer = SDL_CreateRenderer(pWindow, -1, SDL_RENDERER_PRESENTVSYNC);
+  if (!pRenderer) {
+    // E.g. the software renderer of the dummy video driver.
+    pRenderer = SDL_CreateRenderer(pWindow, -1, 0);
+  }
+  assert(pRenderer);
+
+  // Without vsync SDL_RenderPresent returns immediately, sleep instead of spinning.
+  SDL_RendererInfo rendererInfo;
+  std::unique_ptr<scratch::FramePacer> pacer;
+  if (!isUnpaced &&
+      (SDL_GetRendererInfo(pRenderer, &rendererInfo) != 0 || !(rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC))) {
+    pacer = std::make_unique<scratch::FramePacer>(kFallbackFramesPerSecond);
+  }
 
   auto windowID = SDL_GetWindowID(pWindow);
 
+  ScratchContext* ctx = Scratch_NewContext();
+  scratch::FrameLoop loop(ctx, Scratch_Advance);
+
+  std::unique_ptr<scratch::SpriteRenderer> spriteRenderer;
+#if defined(SCRATCH_PROGRAM_ATLAS_FILE)
+  {
+    // The atlas is generated next to the binary.
+    std::string atlasPath = SCRATCH_PROGRAM_ATLAS_FILE;
+    if (char* basePath = SDL_GetBasePath()) {
+      atlasPath = basePath + atlasPath;
+      SDL_free(basePath);
+    }
+    std::vector<ScratchRenderTarget> targets(Scratch_GetRenderTargets(ctx, nullptr, 0));
+    Scratch_GetRenderTargets(ctx, targets.data(), static_cast<int>(targets.size()));
+    spriteRenderer = std::make_unique<scratch::SpriteRenderer>(pRenderer, Scratch_GetAtlas(), atlasPath.c_str(),
+                                                               std::move(targets));
+    if (!spriteRenderer->IsValid()) {
+      std::cerr << "Loading " << atlasPath << " failed: " << SDL_GetError() << std::endl;
+    }
+  }
+#endif
+  const double counterSeconds = 1.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+  const Uint64 firstFrame = SDL_GetPerformanceCounter();
+  Uint64 previousFrame = firstFrame;
+
   bool isRunning{true};
   while (isRunning) {
     SDL_Event event;
@@ -59,10 +129,38 @@ int SDL_main(int /* argc */, char */* argv */[]) {
       }
     }
 
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (isUnpaced) {
+      loop.AdvanceTicks(1);
+    } else {
+      loop.Update(static_cast<double>(now - previousFrame) * counterSeconds);
+    }
+    previousFrame = now;
+    if (maxTicks > 0 && loop.GetStats().ticks >= maxTicks) {
+      isRunning = false;
+    }
+
+    // Targets are drawn as of the last tick, the renderer reads positions straight from the context.
     SDL_SetRenderDrawColor(pRenderer, 255, 255, 255, 255);
     SDL_RenderClear(pRenderer);
+    if (spriteRenderer) {
+      spriteRenderer->Draw();
+    }
     SDL_RenderPresent(pRenderer);
+
+    if (pacer) {
+      pacer->Wait();
+    }
+  }
+
+  loop.GetStats().Print(std::cout);
+  if (spriteRenderer) {
+    spriteRenderer->GetStats().Print(std::cout);
   }
+  std::cout << "seconds: " << static_cast<double>(SDL_GetPerformanceCounter() - firstFrame) * counterSeconds
+            << std::endl;
+  spriteRenderer.reset();
+  Scratch_DeleteContext(ctx);
 
   SDL_DestroyRenderer(pRenderer);
   SDL_DestroyWindow(pWindow);
@@ -0,0 +1,132 @@
+#include "sprite_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <utility>
+
+namespace scratch {
+namespace {
+
+// The Scratch stage, drawn with its origin in the center and y growing upwards.
+constexpr int kStageWidth = 480;
+constexpr int kStageHeight = 360;
+
+}  // namespace
+
+void RenderStats::Print(std::ostream& out) const {
+  const double frame_count = frames > 0 ? static_cast<double>(frames) : 1;
+  out << "rendered frames: " << frames << "\n"
+      << "sprites drawn/culled per frame: " << static_cast<double>(drawn_sprites) / frame_count << "/"
+      << static_cast<double>(culled_sprites) / frame_count << "\n"
+      << "draw calls per frame: " << static_cast<double>(draw_calls) / frame_count << "\n";
+}
+
+SpriteRenderer::SpriteRenderer(SDL_Renderer* renderer, const ScratchAtlas* atlas, const char* atlas_path,
+                               std::vector<ScratchRenderTarget> targets)
+    : renderer_(renderer), atlas_(atlas), targets_(std::move(targets)) {
+  for (int i = 0; i < atlas_->costume_count; ++i) {
+    const ScratchCostume& costume = atlas_->costumes[i];
+    const double left = costume.rotation_center_x;
+    const double right = costume.width - costume.rotation_center_x;
+    const double top = costume.rotation_center_y;
+    const double bottom = costume.height - costume.rotation_center_y;
+    const double radius = std::sqrt(std::max(left * left, right * right) + std::max(top * top, bottom * bottom));
+    costume_radii_.push_back(static_cast<float>(radius / costume.resolution));
+  }
+
+  SDL_Surface* surface = SDL_LoadBMP(atlas_path);
+  if (!surface) {
+    return;
+  }
+  texture_ = SDL_CreateTextureFromSurface(renderer_, surface);
+  SDL_FreeSurface(surface);
+  if (!texture_) {
+    return;
+  }
+  SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+  SDL_RenderSetLogicalSize(renderer_, kStageWidth, kStageHeight);
+}
+
+SpriteRenderer::~SpriteRenderer() {
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+  }
+}
+
+void SpriteRenderer::Draw() {
+  if (!texture_) {
+    return;
+  }
+  ++stats_.frames;
+  vertices_.clear();
+  indices_.clear();
+
+  for (const ScratchRenderTarget& target : targets_) {
+    if (!target.is_visible || target.costume < 0) {
+      continue;
+    }
+    // Clones are drawn right below their sprite, the pool is read on every frame as clones come and go.
+    if (const ScratchClonePool* clones = target.clones) {
+      for (int i = 0; i < clones->count; ++i) {
+        AddSprite(target.costume, clones->x[i], clones->y[i], clones->direction_x[i], clones->direction_y[i],
+                  target.scale);
+      }
+    }
+    AddSprite(target.costume, *target.x, *target.y, *target.direction_x, *target.direction_y, target.scale);
+  }
+
+  if (!indices_.empty()) {
+    SDL_RenderGeometry(renderer_, texture_, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(),
+                       static_cast<int>(indices_.size()));
+    ++stats_.draw_calls;
+  }
+}
+
+void SpriteRenderer::AddSprite(int costume_index, ScratchNumber x, ScratchNumber y, ScratchNumber direction_x,
+                               ScratchNumber direction_y, ScratchNumber scale) {
+  const double radius = costume_radii_[costume_index] * scale;
+  if (x + radius < -kStageWidth / 2 || x - radius > kStageWidth / 2 || y + radius < -kStageHeight / 2 ||
+      y - radius > kStageHeight / 2) {
+    ++stats_.culled_sprites;
+    return;
+  }
+  ++stats_.drawn_sprites;
+
+  // Axes of the costume on the stage: right along the direction, up 90 degrees counterclockwise from it.
+  const double length = std::sqrt(direction_x * direction_x + direction_y * direction_y);
+  double right_x = 1;
+  double right_y = 0;
+  if (length > 1e-9) {
+    right_x = direction_x / length;
+    right_y = direction_y / length;
+  }
+  const double up_x = -right_y;
+  const double up_y = right_x;
+
+  const ScratchCostume& costume = atlas_->costumes[costume_index];
+  const double units_per_pixel = scale / costume.resolution;
+  const int first = static_cast<int>(vertices_.size());
+  for (int corner = 0; corner < 4; ++corner) {
+    // Top left, top right, bottom right, bottom left in pixels of the costume.
+    const int pixel_x = (corner == 1 || corner == 2) ? costume.width : 0;
+    const int pixel_y = corner >= 2 ? costume.height : 0;
+    const double u = (pixel_x - costume.rotation_center_x) * units_per_pixel;
+    const double v = (costume.rotation_center_y - pixel_y) * units_per_pixel;
+    const double stage_x = x + u * right_x + v * up_x;
+    const double stage_y = y + u * right_y + v * up_y;
+
+    SDL_Vertex vertex;
+    vertex.position.x = static_cast<float>(kStageWidth / 2 + stage_x);
+    vertex.position.y = static_cast<float>(kStageHeight / 2 - stage_y);
+    vertex.color = SDL_Color{255, 255, 255, 255};
+    vertex.tex_coord.x = static_cast<float>(costume.x + pixel_x) / static_cast<float>(atlas_->width);
+    vertex.tex_coord.y = static_cast<float>(costume.y + pixel_y) / static_cast<float>(atlas_->height);
+    vertices_.push_back(vertex);
+  }
+  for (int offset : {0, 1, 2, 0, 2, 3}) {
+    indices_.push_back(first + offset);
+  }
+}
+
+}  // namespace scratch
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-clones.h"
+#include "templates/scratch-vm-render.h"
+
+namespace scratch {
+
+// Sprites counted by SpriteRenderer::Draw.
+struct RenderStats {
+  size_t frames = 0;
+  size_t drawn_sprites = 0;
+  // Sprites and clones entirely off the stage, skipped before their vertices are generated.
+  size_t culled_sprites = 0;
+  // SDL_RenderGeometry calls, a single one per frame with anything to draw.
+  size_t draw_calls = 0;
+
+  void Print(std::ostream& out) const;
+};
+
+// Draws the stage, sprites and their clones from a texture atlas with a single SDL_RenderGeometry call a frame.
+//
+// Costumes are regions of the atlas the transpiler packs with --atlas. Positions are read through
+// ScratchRenderTarget pointers into the context on every frame, so the renderer draws the state after the last
+// tick without copying anything between ticks. Vertex and index buffers are reused across frames.
+//
+// The logical size of |renderer| is set to the 480x360 stage, the window scales it with letterboxing.
+class SpriteRenderer {
+ public:
+  // |atlas_path| is the bitmap of |atlas|, see SCRATCH_PROGRAM_ATLAS_FILE.
+  SpriteRenderer(SDL_Renderer* renderer, const ScratchAtlas* atlas, const char* atlas_path,
+                 std::vector<ScratchRenderTarget> targets);
+  ~SpriteRenderer();
+
+  SpriteRenderer(const SpriteRenderer&) = delete;
+  SpriteRenderer& operator=(const SpriteRenderer&) = delete;
+
+  // False if the atlas couldn't be loaded, SDL_GetError tells why. Draw does nothing then.
+  bool IsValid() const { return texture_ != nullptr; }
+
+  // Queues the targets in their drawing order and submits them at once, the caller presents the frame.
+  void Draw();
+
+  const RenderStats& GetStats() const { return stats_; }
+
+ private:
+  // Adds a quad of |costume| unless it's off the stage.
+  void AddSprite(int costume, ScratchNumber x, ScratchNumber y, ScratchNumber direction_x,
+                 ScratchNumber direction_y, ScratchNumber scale);
+
+  SDL_Renderer* renderer_ = nullptr;
+  SDL_Texture* texture_ = nullptr;
+  const ScratchAtlas* atlas_ = nullptr;
+  std::vector<ScratchRenderTarget> targets_;
+  // Distance from the rotation center to the farthest corner of every costume in stage units, for culling.
+  std::vector<float> costume_radii_;
+
+  std::vector<SDL_Vertex> vertices_;
+  std::vector<int> indices_;
+  RenderStats stats_;
+};
+
+}  // namespace scratch
@@ -0,0 +1,285 @@
+#include "batch_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace scratch {
+
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+constexpr size_t kDefaultL2CacheSize = 256 * 1024;
+// Enough work items per worker for stealing to even out the load.
+constexpr size_t kMinChunksPerWorker = 4;
+
+size_t AlignToCacheLine(size_t size) {
+  return (size + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
+
+size_t GetL2CacheSize() {
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+  long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (size > 0) {
+    return static_cast<size_t>(size);
+  }
+#endif
+  return kDefaultL2CacheSize;
+}
+
+void PinCurrentThread(size_t cpu) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu % CPU_SETSIZE, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+  (void)cpu;
+#endif
+}
+
+}  // namespace
+
+// Instances owned by a single worker. Chunks are taken from the front by the owner and by thieves alike, a
+// single atomic counter is enough because chunks are never pushed back.
+struct BatchRunner::Partition {
+  size_t first_instance = 0;
+  size_t instances = 0;
+  size_t chunks = 0;
+  unsigned char* memory = nullptr;
+
+  alignas(kCacheLineSize) std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> steals{0};
+
+  Partition() = default;
+  Partition(Partition&& other) noexcept
+      : first_instance(other.first_instance),
+        instances(other.instances),
+        chunks(other.chunks),
+        memory(other.memory) {}
+};
+
+// Persistent worker threads, all of them run the same job and the caller waits for all of them to finish.
+class BatchRunner::Pool {
+ public:
+  Pool(size_t threads, bool pin_threads) {
+    for (size_t i = 0; i < threads; ++i) {
+      threads_.emplace_back([this, i, pin_threads] {
+        if (pin_threads) {
+          PinCurrentThread(i);
+        }
+        WorkerLoop(i);
+      });
+    }
+  }
+
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t GetThreadCount() const { return threads_.size(); }
+
+  void RunOnAllWorkers(const std::function<void(size_t)>& job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &job;
+    running_ = threads_.size();
+    ++generation_;
+    start_.notify_all();
+    done_.wait(lock, [this] { return running_ == 0; });
+    job_ = nullptr;
+  }
+
+ private:
+  void WorkerLoop(size_t worker) {
+    uint64_t seen_generation = 0;
+    for (;;) {
+      const std::function<void(size_t)>* job = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+        if (stop_) {
+          return;
+        }
+        seen_generation = generation_;
+        job = job_;
+      }
+
+      (*job)(worker);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--running_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(size_t)>* job_ = nullptr;
+  uint64_t generation_ = 0;
+  size_t running_ = 0;
+  bool stop_ = false;
+};
+
+double BatchReport::TicksPerSecond() const {
+  if (seconds <= 0) {
+    return 0;
+  }
+  return static_cast<double>(instances) * static_cast<double>(ticks) / seconds;
+}
+
+double BatchReport::TicksPerSecondPerCore() const {
+  if (threads == 0) {
+    return 0;
+  }
+  return TicksPerSecond() / static_cast<double>(threads);
+}
+
+void BatchReport::Print(std::ostream& out) const {
+  out << "instances: " << instances << "\n"
+      << "ticks: " << ticks << "\n"
+      << "threads: " << threads << "\n"
+      << "chunk size: " << chunk_size << "\n"
+      << "steals: " << steals << "\n"
+      << "seconds: " << seconds << "\n"
+      << "ticks/s: " << TicksPerSecond() << "\n"
+      << "ticks/s/core: " << TicksPerSecondPerCore() << "\n";
+}
+
+BatchRunner::BatchRunner(const Program& program, size_t instances, const BatchRunnerOptions& options)
+    : program_(program), instances_(instances) {
+  size_t threads = options.threads;
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  threads = std::max<size_t>(1, std::min(threads, std::max<size_t>(1, instances)));
+
+  context_stride_ = AlignToCacheLine(program_.get_context_size());
+
+  chunk_size_ = options.chunk_size;
+  if (chunk_size_ == 0) {
+    // Half of L2 for contexts, the rest for the heap memory they own.
+    chunk_size_ = std::max<size_t>(1, GetL2CacheSize() / 2 / context_stride_);
+    size_t per_worker = instances / threads;
+    chunk_size_ = std::max<size_t>(1, std::min(chunk_size_, per_worker / kMinChunksPerWorker));
+  }
+
+  partitions_.resize(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    Partition& partition = partitions_[i];
+    partition.first_instance = instances * i / threads;
+    partition.instances = instances * (i + 1) / threads - partition.first_instance;
+    partition.chunks = (partition.instances + chunk_size_ - 1) / chunk_size_;
+  }
+
+  pool_ = std::make_unique<Pool>(threads, options.pin_threads);
+  pool_->RunOnAllWorkers([this](size_t worker) { AllocatePartition(worker); });
+}
+
+BatchRunner::~BatchRunner() {
+  pool_->RunOnAllWorkers([this](size_t worker) { FreePartition(worker); });
+}
+
+ScratchContext* BatchRunner::GetContext(size_t index) {
+  assert(index < instances_);
+  auto it = std::upper_bound(
+      partitions_.begin(), partitions_.end(), index,
+      [](size_t i, const Partition& partition) { return i < partition.first_instance; });
+  Partition& partition = *(it - 1);
+  return reinterpret_cast<ScratchContext*>(
+      partition.memory + (index - partition.first_instance) * context_stride_);
+}
+
+void BatchRunner::AllocatePartition(size_t worker) {
+  Partition& partition = partitions_[worker];
+  if (partition.instances == 0) {
+    return;
+  }
+
+  // Touched first by this thread, so the pages are placed on its NUMA node.
+  partition.memory =
+      static_cast<unsigned char*>(std::aligned_alloc(kCacheLineSize, partition.instances * context_stride_));
+  for (size_t i = 0; i < partition.instances; ++i) {
+    program_.init(reinterpret_cast<ScratchContext*>(partition.memory + i * context_stride_));
+  }
+}
+
+void BatchRunner::FreePartition(size_t worker) {
+  Partition& partition = partitions_[worker];
+  for (size_t i = 0; i < partition.instances; ++i) {
+    program_.free(reinterpret_cast<ScratchContext*>(partition.memory + i * context_stride_));
+  }
+  std::free(partition.memory);
+  partition.memory = nullptr;
+}
+
+void BatchRunner::AdvancePartitions(size_t worker, size_t ticks, ScratchNumber dt) {
+  const size_t count = partitions_.size();
+  for (size_t offset = 0; offset < count; ++offset) {
+    Partition& partition = partitions_[(worker + offset) % count];
+    for (;;) {
+      size_t chunk = partition.next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= partition.chunks) {
+        break;
+      }
+      if (offset != 0) {
+        partition.steals.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      size_t begin = chunk * chunk_size_;
+      size_t end = std::min(begin + chunk_size_, partition.instances);
+      unsigned char* memory = partition.memory;
+      for (size_t tick = 0; tick < ticks; ++tick) {
+        for (size_t i = begin; i < end; ++i) {
+          program_.advance(reinterpret_cast<ScratchContext*>(memory + i * context_stride_), dt);
+        }
+      }
+    }
+  }
+}
+
+BatchReport BatchRunner::Run(size_t ticks, ScratchNumber dt) {
+  for (Partition& partition : partitions_) {
+    partition.next_chunk.store(0, std::memory_order_relaxed);
+    partition.steals.store(0, std::memory_order_relaxed);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  pool_->RunOnAllWorkers([this, ticks, dt](size_t worker) { AdvancePartitions(worker, ticks, dt); });
+  auto finish = std::chrono::steady_clock::now();
+
+  BatchReport report;
+  report.instances = instances_;
+  report.ticks = ticks;
+  report.threads = pool_->GetThreadCount();
+  report.chunk_size = chunk_size_;
+  for (const Partition& partition : partitions_) {
+    report.steals += partition.steals.load(std::memory_order_relaxed);
+  }
+  report.seconds = std::chrono::duration<double>(finish - start).count();
+  return report;
+}
+
+}  // namespace scratch
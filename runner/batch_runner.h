@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "templates/scratch-vm-types.h"
+
+namespace scratch {
+
+// Entry points of a transpiled program, e.g.
+// {Scratch_GetContextSize, Scratch_Init, Scratch_Free, Scratch_Advance}.
+struct Program {
+  size_t (*get_context_size)(void);
+  void (*init)(ScratchContext* ctx);
+  void (*free)(ScratchContext* ctx);
+  void (*advance)(ScratchContext* ctx, ScratchNumber dt);
+};
+
+struct BatchRunnerOptions {
+  // Number of worker threads, std::thread::hardware_concurrency() when 0.
+  size_t threads = 0;
+  // Number of instances in a single work item, derived from the context size and the L2 cache size when 0.
+  size_t chunk_size = 0;
+  // Pin worker i to CPU i, keeps the partition of a worker on its NUMA node. Linux only.
+  bool pin_threads = false;
+};
+
+struct BatchReport {
+  size_t instances = 0;
+  size_t ticks = 0;
+  size_t threads = 0;
+  size_t chunk_size = 0;
+  // Work items taken from partitions of other workers.
+  size_t steals = 0;
+  double seconds = 0;
+
+  // Single Scratch_Advance of a single instance is a tick.
+  double TicksPerSecond() const;
+  double TicksPerSecondPerCore() const;
+
+  void Print(std::ostream& out) const;
+};
+
+// Advances a batch of independent instances of a program on a pool of worker threads.
+//
+// Instances are split into one contiguous partition per worker. A worker allocates and initializes its own
+// partition, so with first-touch allocation the memory of the partition lives on the NUMA node of the worker.
+// Contexts are padded to the cache line size to avoid false sharing between work items.
+//
+// Partitions are split into chunks of instances which fit into the L2 cache. A chunk is advanced for all
+// requested ticks at once, so its contexts stay in cache. Workers take chunks from their own partition first
+// and steal chunks from partitions of other workers when done.
+class BatchRunner {
+ public:
+  BatchRunner(const Program& program, size_t instances, const BatchRunnerOptions& options = {});
+  ~BatchRunner();
+
+  BatchRunner(const BatchRunner&) = delete;
+  BatchRunner& operator=(const BatchRunner&) = delete;
+
+  // Advances every instance |ticks| times by |dt|.
+  BatchReport Run(size_t ticks, ScratchNumber dt);
+
+  size_t GetInstanceCount() const { return instances_; }
+  ScratchContext* GetContext(size_t index);
+
+ private:
+  struct Partition;
+  class Pool;
+
+  void AllocatePartition(size_t worker);
+  void FreePartition(size_t worker);
+  void AdvancePartitions(size_t worker, size_t ticks, ScratchNumber dt);
+
+  Program program_;
+  size_t instances_ = 0;
+  size_t context_stride_ = 0;
+  size_t chunk_size_ = 0;
+  std::vector<Partition> partitions_;
+  std::unique_ptr<Pool> pool_;
+};
+
+}  // namespace scratch
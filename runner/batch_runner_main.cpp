@@ -0,0 +1,22 @@
+// Header of the transpiled program, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <cstdlib>
+#include <iostream>
+
+#include "batch_runner.h"
+
+// Usage: <binary> [instances] [ticks] [threads]
+int main(int argc, char* argv[]) {
+  size_t instances = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+  size_t ticks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+
+  scratch::BatchRunnerOptions options;
+  options.threads = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+
+  scratch::Program program{Scratch_GetContextSize, Scratch_Init, Scratch_Free, Scratch_Advance};
+  scratch::BatchRunner runner(program, instances, options);
+  runner.Run(ticks, 1.0 / 30.0).Print(std::cout);
+
+  return 0;
+}
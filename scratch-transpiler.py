@@ -1,9 +1,21 @@
 import argparse
+import decimal
+import gc
+import hashlib
+import os
+import re
+import struct
 import zipfile
+import zlib
 import json
+import math
 from jinja2 import Environment, PackageLoader, select_autoescape
 
 
+kSchedulerRecursive = "recursive"
+kSchedulerThreaded = "threaded"
+
+
 def parse_arguments() -> argparse.Namespace:
     parser = argparse.ArgumentParser(
         prog="Scratch Transpiler",
@@ -11,7 +23,41 @@ def parse_arguments() -> argparse.Namespace:
     )
 
     parser.add_argument("-i", "--input", help="Input Scratch program (*.sb3).")
-    parser.add_argument("-o", "--output", help="Output files stem.")
+    parser.add_argument(
+        "-o",
+        "--output",
+        help="Output files stem: <stem>.h is the public header, <stem>.c the runtime and "
+        "<stem>_<sprite>.c scripts of every sprite.",
+    )
+    parser.add_argument(
+        "--scheduler",
+        choices=[kSchedulerRecursive, kSchedulerThreaded],
+        default=kSchedulerRecursive,
+        help="How scripts are advanced: by the recursive Scratch_AdvanceSingleProgram "
+        "or by a flat switch over the blocks of every script.",
+    )
+    parser.add_argument(
+        "--profile",
+        action="store_true",
+        help="Count calls and cycles of every generated block function and helper, "
+        "see Scratch_DumpProfile.",
+    )
+    parser.add_argument(
+        "--drop-unread-variables",
+        action="store_true",
+        help="Remove writes to variables no block reads. "
+        "Such variables keep their initial value for Scratch_FindVariable.",
+    )
+    parser.add_argument(
+        "--atlas",
+        action="store_true",
+        help="Pack costumes of all the targets into <stem>_atlas.bmp, see Scratch_GetAtlas.",
+    )
+    parser.add_argument(
+        "--list-outputs",
+        action="store_true",
+        help="Print names of the generated files, one per line, without generating them.",
+    )
 
     return parser.parse_args()
 
@@ -22,17 +68,49 @@ def read_scratch_program(file_path: str):
             return json.loads(project_file.read())
 
 
+def read_scratch_costume_assets(file_path: str, scratch_json) -> dict:
+    """Files of costumes of every target by their names in the *.sb3, missing ones are skipped."""
+    names = {
+        c.get("md5ext")
+        for t in scratch_json["targets"]
+        for c in t.get("costumes", [])
+        if c.get("md5ext")
+    }
+    assets = {}
+    with zipfile.ZipFile(file_path) as file:
+        for name in names & set(file.namelist()):
+            assets[name] = file.read(name)
+    return assets
+
+
 def extract_sprite_name(scratch_target) -> str:
     return scratch_target["name"].replace(" ", "_")
 
 
 class Target:
-    def __init__(self, sprite_name):
+    def __init__(self, sprite_name, scratch_name):
         self.sprite_name = sprite_name
+        self.scratch_name = scratch_name
         self.c_struct_name = f"{self.sprite_name}_t"
         self.variable_name = self.sprite_name
-        self.clone_c_struct_name = f"{self.sprite_name}_Clone_t"
+        self.clone_scripts = []
         self.per_level_runtimes = []
+        # Blocks left after optimizations and programs of the target, see compile_scratch_program.
+        self.blocks = []
+        self.hat_blocks = []
+        # First index of the target in profile sites.
+        self.profile_sites_begin = 0
+        # Initial state and drawing order from project.json, see extract_target_properties.
+        self.is_stage = False
+        self.layer_order = 0
+        self.x = 0.0
+        self.y = 0.0
+        self.direction_x = 1.0
+        self.direction_y = 0.0
+        self.scale = 1.0
+        self.is_visible = True
+        # Index of the current costume in the atlas, -1 without one, see pack_costumes.
+        self.costume = -1
 
     def __repr__(self):
         return self.__str__()
@@ -41,6 +119,24 @@ class Target:
         return f"Target({self.sprite_name}, {self.c_struct_name})"
 
 
+def extract_target_properties(target: Target, scratch_target):
+    """Position, direction and looks of the target in project.json, Scratch defaults for missing ones.
+
+    Direction is kept as the unit vector the target points to: (sin, cos) of the Scratch direction, so
+    direction 90 is (1, 0).
+    """
+    target.is_stage = bool(scratch_target["isStage"])
+    target.layer_order = scratch_target.get("layerOrder", 0 if target.is_stage else 1)
+    target.x = float(scratch_target.get("x", 0))
+    target.y = float(scratch_target.get("y", 0))
+    direction = math.radians(float(scratch_target.get("direction", 90)))
+    # Rounded, so that right angles give exact zeros.
+    target.direction_x = round(math.sin(direction), 12) + 0.0
+    target.direction_y = round(math.cos(direction), 12) + 0.0
+    target.scale = float(scratch_target.get("size", 100)) / 100
+    target.is_visible = bool(scratch_target.get("visible", True))
+
+
 class Variable:
     def __init__(
         self, scratch_target: str, variable_name: str, value: str, scratch_variable_name
@@ -49,10 +145,11 @@ class Variable:
         self.variable_name = variable_name
         self.scratch_variable_name = scratch_variable_name
         self.scratch_target_name = self.scratch_target["name"]
-        try:
-            self.value = float(value)
+        number = parse_scratch_number(value)
+        if number is not None:
+            self.value = number
             self.is_string = False
-        except:
+        else:
             self.value = value
             self.is_string = True
 
@@ -63,32 +160,156 @@ class Variable:
         return f"Variable({self.variable_name}: {self.value})"
 
 
-def extract_variable(scratch_json, scratch_target, scratch_variable_id) -> Variable:
-    if scratch_variable_id in scratch_target["variables"]:
-        variable_value = scratch_target["variables"][scratch_variable_id][1]
-        scratch_variable_name = scratch_target["variables"][scratch_variable_id][0]
-        return Variable(
-            scratch_target,
-            extract_sprite_name(scratch_target)
-            + "_"
-            + scratch_variable_name.replace(" ", "_"),
-            variable_value,
-            scratch_variable_name,
+def extract_variable(scratch_target, scratch_variable_id) -> Variable:
+    variable_value = scratch_target["variables"][scratch_variable_id][1]
+    scratch_variable_name = scratch_target["variables"][scratch_variable_id][0]
+    return Variable(
+        scratch_target,
+        extract_sprite_name(scratch_target)
+        + "_"
+        + scratch_variable_name.replace(" ", "_"),
+        variable_value,
+        scratch_variable_name,
+    )
+
+
+class List:
+    def __init__(self, scratch_target, list_name: str, scratch_list_name, items):
+        self.list_name = list_name
+        self.scratch_list_name = scratch_list_name
+        self.scratch_target_name = scratch_target["name"]
+        # Numeric items are added as numbers, like values of variables.
+        self.items = []
+        for item in items:
+            number = parse_scratch_number(item)
+            if number is not None:
+                self.items.append(
+                    {"is_string": False, "value": to_c_number_literal(number)}
+                )
+            else:
+                self.items.append({"is_string": True, "value": str(item)})
+        # Set for lists searched by `item # of`, which get a hash index of items.
+        self.is_indexed = False
+
+    def __repr__(self):
+        return self.__str__()
+
+    def __str__(self):
+        return f"List({self.list_name}: {len(self.items)} items)"
+
+
+def extract_list(scratch_target, scratch_list_id) -> List:
+    scratch_list_name, items = scratch_target["lists"][scratch_list_id]
+    return List(
+        scratch_target,
+        extract_sprite_name(scratch_target)
+        + "_"
+        + scratch_list_name.replace(" ", "_")
+        + "_list",
+        scratch_list_name,
+        items,
+    )
+
+
+class Broadcast:
+    """A broadcast message: its dense ID, the scripts receiving it and the scripts waiting for them.
+
+    Scripts are referred to by program indices, see assign_program_indices.
+    """
+
+    def __init__(self, name: str):
+        self.name = name
+        # Set by assign_broadcast_ids.
+        self.id = -1
+        self.receivers = []
+        self.waiters = []
+
+    def __repr__(self):
+        return self.__str__()
+
+    def __str__(self):
+        return f"Broadcast({self.id}: {self.name})"
+
+
+def access_broadcast(target_index, name: str) -> Broadcast:
+    # Scratch matches names of broadcasts case insensitively.
+    key = name.upper()
+    if key not in target_index.broadcasts:
+        target_index.broadcasts[key] = Broadcast(name)
+    return target_index.broadcasts[key]
+
+
+def extract_broadcast_input(target_index, scratch_block) -> Broadcast:
+    """Resolves the broadcast sent by event_broadcast or event_broadcastandwait at compile time."""
+    input_obj = scratch_block["inputs"]["BROADCAST_INPUT"]
+    # [1, menu] for a message picked in the menu, [3, reporter, menu] when a reporter covers it.
+    if input_obj[0] != 1:
+        print(
+            f"Warning: {scratch_block[kScratchBlockIdKey]} broadcasts a computed message, "
+            f"which isn't supported, the message of its menu is sent"
         )
+    menu = input_obj[-1]
+    return access_broadcast(target_index, menu[1])
+
 
-    scratch_stage_target = None
+class TargetIndex:
+    """Lookup tables of one target of project.json, see index_scratch_program."""
+
+    def __init__(self, scratch_target, stage_variables, stage_lists, broadcasts):
+        self.scratch_target = scratch_target
+        self.sprite_name = extract_sprite_name(scratch_target)
+        self.blocks = scratch_target["blocks"]
+        # Variable ID -> Variable for every variable visible to the target, stage ones included.
+        self.variables = dict(stage_variables)
+        for scratch_variable_id in scratch_target["variables"]:
+            self.variables[scratch_variable_id] = extract_variable(
+                scratch_target, scratch_variable_id
+            )
+        # List ID -> List, the same way. Lists of the stage are shared by all the targets, blocks of any of
+        # them mark the list indexed.
+        self.lists = dict(stage_lists)
+        for scratch_list_id in scratch_target.get("lists", {}):
+            if scratch_list_id not in self.lists:
+                self.lists[scratch_list_id] = extract_list(
+                    scratch_target, scratch_list_id
+                )
+        # Upper case name -> Broadcast, shared by all the targets like broadcasts in Scratch.
+        self.broadcasts = broadcasts
+        self.top_level_block_ids = []
+
+
+def index_scratch_program(scratch_json, broadcasts) -> list:
+    """Builds lookup tables of every target in a single pass over project.json.
+
+    Blocks are annotated with their IDs (see kScratchBlockIdKey), variables are resolved once per
+    target instead of searching for the stage on every access. Broadcasts referenced by blocks of any
+    target are collected into |broadcasts|.
+    """
+    stage_variables = {}
+    stage_lists = {}
     for scratch_target in scratch_json["targets"]:
         if scratch_target["isStage"]:
-            scratch_stage_target = scratch_target
+            stage_index = TargetIndex(scratch_target, {}, {}, broadcasts)
+            stage_variables = stage_index.variables
+            stage_lists = stage_index.lists
             break
 
-    return extract_variable(scratch_json, scratch_stage_target, scratch_variable_id)
+    target_indices = []
+    for scratch_target in scratch_json["targets"]:
+        target_index = TargetIndex(
+            scratch_target, stage_variables, stage_lists, broadcasts
+        )
+        for scratch_block_id, scratch_block in target_index.blocks.items():
+            scratch_block[kScratchBlockIdKey] = scratch_block_id
+            if scratch_block["topLevel"]:
+                target_index.top_level_block_ids.append(scratch_block_id)
+        target_indices.append(target_index)
 
+    return target_indices
 
-def access_variable(
-    scratch_json, scratch_target, scratch_variable_id, all_variables_and_cache
-):
-    variable = extract_variable(scratch_json, scratch_target, scratch_variable_id)
+
+def access_variable(target_index, scratch_variable_id, all_variables_and_cache):
+    variable = target_index.variables[scratch_variable_id]
     if variable.variable_name in all_variables_and_cache["cache"]:
         return
 
@@ -96,11 +317,116 @@ def access_variable(
     all_variables_and_cache["cache"][variable.variable_name] = scratch_variable_id
 
 
+# Helper value types.
+kValueTypeNumber = "number"
+kValueTypeString = "string"
+kValueTypeAny = "any"
+
+# How a helper is emitted: as a function returning ScratchVariable (boxing the C expression of
+# a numeric helper) or not at all because it's inlined into the C expression of its consumer.
+kEmitBoxed = "boxed"
+kEmitBoxedNumber = "boxed_number"
+kEmitInlined = "inlined"
+
+kNumberOperators = {
+    "operator_add": "+",
+    "operator_multiply": "*",
+    "operator_divide": "/",
+}
+
+kMathOpFunctions = {
+    "abs": "fabs",
+    "floor": "floor",
+    "ceiling": "ceil",
+    "sqrt": "sqrt",
+    "ln": "log",
+    "log": "log10",
+    "e ^": "exp",
+}
+
+
+# Decimal numbers JavaScript Number() reads, unlike float() no "inf", "nan" or "1_000". Hex literals stay strings,
+# the runtime reads them as numbers like Scratch_ParseNumber does.
+kScratchNumberText = re.compile(r"\s*[+-]?(Infinity|(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?)\s*")
+
+
+def parse_scratch_number(value):
+    """|value| as a float if project.json stores it as a number or as the text of one, None otherwise."""
+    if isinstance(value, bool) or value is None:
+        return None
+    if isinstance(value, (int, float)):
+        return float(value)
+    if isinstance(value, str) and kScratchNumberText.fullmatch(value):
+        return float(value)
+    return None
+
+
+def to_c_number_literal(value) -> str:
+    try:
+        number = float(value)
+    except (TypeError, ValueError):
+        return "0.0"
+    if math.isnan(number):
+        return "NAN"
+    if math.isinf(number):
+        return "INFINITY" if number > 0 else "-INFINITY"
+    return repr(number)
+
+
+def to_c_string_literal(value) -> str:
+    escaped = ""
+    for c in str(value):
+        # "?" is escaped to never form a trigraph.
+        if c == "\\" or c == '"' or c == "?":
+            escaped += "\\" + c
+        elif c == "\n":
+            escaped += "\\n"
+        elif ord(c) < 0x20:
+            escaped += f"\\{ord(c):03o}"
+        else:
+            escaped += c
+    return f'"{escaped}"'
+
+
+class StringConstants:
+    """Interns string literals so every distinct value is emitted once as a static C array."""
+
+    def __init__(self):
+        self.names = {}
+        self.constants = []
+
+    def intern(self, value) -> str:
+        value = str(value)
+        if value not in self.names:
+            name = f"kScratchString{len(self.constants)}"
+            self.names[value] = name
+            self.constants.append((name, to_c_string_literal(value)))
+        return self.names[value]
+
+
 class Helper:
     def __init__(self, op_code, function_name):
         self.op_code = op_code
         self.function_name = function_name
         self.arguments = []
+        # Helpers computing the inputs of this helper.
+        self.inputs = []
+        # Filled by infer_helper_types.
+        self.value_type = kValueTypeAny
+        self.emit = kEmitBoxed
+        self.c_expression = ""
+        # Filled for list blocks taking an index by emit_list_helper.
+        self.index_c_expression = ""
+        # Filled for motion blocks by emit_boxed_helper.
+        self.motion_updates = []
+        # Sent by "broadcast" helpers.
+        self.broadcast = None
+        # Scratch block computing the helper, the block owning the input for shadow inputs.
+        self.scratch_block_id = ""
+        self.scratch_op_code = ""
+        # Index in profile sites, set when profiling.
+        self.profile_index = -1
+        self.profile_return_type = ""
 
     def __repr__(self):
         return self.__str__()
@@ -109,13 +435,54 @@ class Helper:
         return f"Helper({self.op_code}, {self.function_name})"
 
 
+# Motion blocks: opcode -> updates of sprite fields as (input name, field, "set" or "change").
+kMotionBlocks = {
+    "motion_setx": [("X", "x", "set")],
+    "motion_sety": [("Y", "y", "set")],
+    "motion_changexby": [("DX", "x", "change")],
+    "motion_changeyby": [("DY", "y", "change")],
+    "motion_gotoxy": [("X", "x", "set"), ("Y", "y", "set")],
+}
+
+
+# List blocks: opcode -> names of inputs in the order Scratch evaluates them.
+kListBlocks = {
+    "data_addtolist": ["ITEM"],
+    "data_deleteoflist": ["INDEX"],
+    "data_deletealloflist": [],
+    "data_replaceitemoflist": ["INDEX", "ITEM"],
+    "data_itemoflist": ["INDEX"],
+    "data_lengthoflist": [],
+    "data_itemnumoflist": ["ITEM"],
+}
+# List blocks run inplace, the rest are reporters.
+kListStackBlocks = (
+    "data_addtolist",
+    "data_deleteoflist",
+    "data_deletealloflist",
+    "data_replaceitemoflist",
+)
+
+
+# Key of the ID of a block stored in the block itself, IDs are only the keys of `blocks` in project.json.
+kScratchBlockIdKey = "transpiler_block_id"
+
+
+def set_helpers_scratch_block(helpers, scratch_block):
+    """Attributes helpers not attributed to any block yet, i.e. shadow inputs and the block itself."""
+    for helper in helpers:
+        if not helper.scratch_block_id:
+            helper.scratch_block_id = scratch_block[kScratchBlockIdKey]
+            helper.scratch_op_code = scratch_block["opcode"]
+
+
 def add_new_helper(helper, helpers, helpers_count_obj):
     count = helpers_count_obj["count"]
     helpers.append(helper)
     helpers_count_obj["count"] = helpers_count_obj["count"] + 1
 
 
-def extract_inputs_r(scratch_json, scratch_target, input_obj, helpers, count_obj):
+def extract_inputs_r(target_index, input_obj, helpers, count_obj):
     value_input_type = input_obj[0]
     value = input_obj[1]
 
@@ -126,16 +493,12 @@ def extract_inputs_r(scratch_json, scratch_target, input_obj, helpers, count_obj
         count = count_obj["count"]
 
         opcode = "read_value_string"
-        if value[0] in (4, 5, 6, 7):
-            opcode = "read_value_number"
-        if value[0] == 10:
-            try:
-                float(value[1])
+        if value[0] in (4, 5, 6, 7, 10):
+            # Number fields may hold text too, e.g. "last" as an index of a list item.
+            if parse_scratch_number(value[1]) is not None:
                 opcode = "read_value_number"
-            except:
-                opcode = "read_value_string"
 
-        function_name = f"{extract_sprite_name(scratch_target)}_{opcode}_helper_{count}"
+        function_name = f"{target_index.sprite_name}_{opcode}_helper_{count}"
         helper = Helper(opcode, function_name)
 
         helper.arguments = [value[1]]
@@ -149,50 +512,108 @@ def extract_inputs_r(scratch_json, scratch_target, input_obj, helpers, count_obj
                 count = count_obj["count"]
                 opcode = "read_variable"
                 function_name = (
-                    f"{extract_sprite_name(scratch_target)}_{opcode}_helper_{count}"
+                    f"{target_index.sprite_name}_{opcode}_helper_{count}"
                 )
 
                 helper = Helper(opcode, function_name)
-                variable = extract_variable(scratch_json, scratch_target, value[2])
+                variable = target_index.variables[value[2]]
                 helper.arguments = [variable.variable_name]
 
                 add_new_helper(helper, helpers, count_obj)
         else:
             # value is input ID
-            next_block = scratch_target["blocks"][value]
-            extract_inline_helpers_r(
-                scratch_json, scratch_target, next_block, helpers, count_obj
-            )
+            next_block = target_index.blocks[value]
+            extract_inline_helpers_r(target_index, next_block, helpers, count_obj)
 
 
-def extract_inline_helpers_r(
-    scratch_json, scratch_target, scratch_block, helpers, count_obj
-):
+def extract_inline_helpers_r(target_index, scratch_block, helpers, count_obj):
     opcode = scratch_block["opcode"]
     if opcode == "data_setvariableto":
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["VALUE"],
             helpers,
             count_obj,
         )
 
         variable_id = scratch_block["fields"]["VARIABLE"][1]
-        variable = extract_variable(scratch_json, scratch_target, variable_id)
+        variable = target_index.variables[variable_id]
 
         count = count_obj["count"]
-        function_name = f"{extract_sprite_name(scratch_target)}_set_variable_{count}"
+        function_name = f"{target_index.sprite_name}_set_variable_{count}"
         helper = Helper("set_variable", function_name)
         if len(helpers) > 0:
             value_helper = helpers[-1]
             helper.arguments = [value_helper.function_name, variable.variable_name]
+            helper.inputs = [value_helper]
+        add_new_helper(helper, helpers, count_obj)
+
+    if opcode in kMotionBlocks:
+        input_helpers = []
+        for input_name, _, _ in kMotionBlocks[opcode]:
+            extract_inputs_r(
+                target_index,
+                scratch_block["inputs"][input_name],
+                helpers,
+                count_obj,
+            )
+            input_helpers.append(helpers[-1])
+
+        count = count_obj["count"]
+        function_name = f"{target_index.sprite_name}_{opcode}_{count}"
+        helper = Helper(opcode, function_name)
+        helper.arguments = [h.function_name for h in input_helpers]
+        helper.inputs = input_helpers
+        add_new_helper(helper, helpers, count_obj)
+
+    if opcode in kListBlocks:
+        input_helpers = []
+        for input_name in kListBlocks[opcode]:
+            extract_inputs_r(
+                target_index,
+                scratch_block["inputs"][input_name],
+                helpers,
+                count_obj,
+            )
+            input_helpers.append(helpers[-1])
+
+        scratch_list = target_index.lists[scratch_block["fields"]["LIST"][1]]
+        if opcode == "data_itemnumoflist":
+            scratch_list.is_indexed = True
+
+        count = count_obj["count"]
+        function_name = f"{target_index.sprite_name}_{opcode}_{count}"
+        helper = Helper(opcode, function_name)
+        helper.arguments = [scratch_list.list_name] + [
+            h.function_name for h in input_helpers
+        ]
+        helper.inputs = input_helpers
+        add_new_helper(helper, helpers, count_obj)
+
+    if opcode == "control_create_clone_of":
+        menu_id = scratch_block["inputs"]["CLONE_OPTION"][1]
+        clone_option = target_index.blocks[menu_id]["fields"]["CLONE_OPTION"][0]
+        if clone_option == "_myself_":
+            sprite_name = target_index.sprite_name
+        else:
+            sprite_name = clone_option.replace(" ", "_")
+
+        count = count_obj["count"]
+        function_name = f"{target_index.sprite_name}_create_clone_{count}"
+        helper = Helper("create_clone", function_name)
+        helper.arguments = [sprite_name]
+        add_new_helper(helper, helpers, count_obj)
+
+    if opcode == "event_broadcast":
+        count = count_obj["count"]
+        function_name = f"{target_index.sprite_name}_broadcast_{count}"
+        helper = Helper("broadcast", function_name)
+        helper.broadcast = extract_broadcast_input(target_index, scratch_block)
         add_new_helper(helper, helpers, count_obj)
 
     if opcode == "operator_mathop":
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["NUM"],
             helpers,
             count_obj,
@@ -203,9 +624,10 @@ def extract_inline_helpers_r(
         operator = scratch_block["fields"]["OPERATOR"][0]
 
         count = count_obj["count"]
-        function_name = f"{extract_sprite_name(scratch_target)}_{operator}_{count}"
+        function_name = f"{target_index.sprite_name}_{opcode}_{count}"
         helper = Helper(operator, function_name)
         helper.arguments = [num_helper.function_name]
+        helper.inputs = [num_helper]
         add_new_helper(helper, helpers, count_obj)
 
     if (
@@ -214,8 +636,7 @@ def extract_inline_helpers_r(
         or opcode == "operator_multiply"
     ):
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["NUM1"],
             helpers,
             count_obj,
@@ -223,8 +644,7 @@ def extract_inline_helpers_r(
         num1_helper = helpers[-1]
 
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["NUM2"],
             helpers,
             count_obj,
@@ -232,15 +652,15 @@ def extract_inline_helpers_r(
         num2_helper = helpers[-1]
 
         count = count_obj["count"]
-        function_name = f"{extract_sprite_name(scratch_target)}_{opcode}_{count}"
+        function_name = f"{target_index.sprite_name}_{opcode}_{count}"
         helper = Helper(opcode, function_name)
         helper.arguments = [num1_helper.function_name, num2_helper.function_name]
+        helper.inputs = [num1_helper, num2_helper]
         add_new_helper(helper, helpers, count_obj)
 
     if opcode == "operator_join":
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["STRING1"],
             helpers,
             count_obj,
@@ -248,8 +668,7 @@ def extract_inline_helpers_r(
         num1_helper = helpers[-1]
 
         extract_inputs_r(
-            scratch_json,
-            scratch_target,
+            target_index,
             scratch_block["inputs"]["STRING2"],
             helpers,
             count_obj,
@@ -257,11 +676,181 @@ def extract_inline_helpers_r(
         num2_helper = helpers[-1]
 
         count = count_obj["count"]
-        function_name = f"{extract_sprite_name(scratch_target)}_{opcode}_{count}"
+        function_name = f"{target_index.sprite_name}_{opcode}_{count}"
         helper = Helper(opcode, function_name)
         helper.arguments = [num1_helper.function_name, num2_helper.function_name]
+        helper.inputs = [num1_helper, num2_helper]
         add_new_helper(helper, helpers, count_obj)
 
+    # Helpers of nested blocks are attributed by the recursive calls.
+    set_helpers_scratch_block(helpers, scratch_block)
+
+
+def helper_c_return_type(helper) -> str:
+    """Return type of the function emitted for |helper|, empty for helpers inlined into their users."""
+    if helper.emit == kEmitInlined:
+        return ""
+    if helper.op_code in ("set_variable", "create_clone", "broadcast"):
+        return "void"
+    if helper.op_code in kMotionBlocks:
+        return "void"
+    if helper.op_code in kListStackBlocks:
+        return "void"
+    return "ScratchVariable"
+
+
+def infer_helper_value_type(helper):
+    if helper.op_code == "read_value_number":
+        return kValueTypeNumber
+    if helper.op_code in kNumberOperators or helper.op_code in kMathOpFunctions:
+        return kValueTypeNumber
+    if helper.op_code in ("data_lengthoflist", "data_itemnumoflist"):
+        return kValueTypeNumber
+    if helper.op_code in ("read_value_string", "operator_join"):
+        return kValueTypeString
+    return kValueTypeAny
+
+
+def number_c_expression(helper) -> str:
+    """Returns C expression computing |helper| as ScratchNumber.
+
+    Numeric inputs are inlined recursively. Anything else is read through its boxed helper function.
+    """
+    if helper.op_code == "read_value_number":
+        helper.emit = kEmitInlined
+        return to_c_number_literal(helper.arguments[0])
+    if helper.op_code == "read_variable":
+        helper.emit = kEmitInlined
+        return f"Scratch_ReadNumberVariable(&ctx->{helper.arguments[0]})"
+    if helper.op_code in kNumberOperators:
+        helper.emit = kEmitInlined
+        operator = kNumberOperators[helper.op_code]
+        num1 = number_c_expression(helper.inputs[0])
+        num2 = number_c_expression(helper.inputs[1])
+        return f"({num1} {operator} {num2})"
+    if helper.op_code in kMathOpFunctions:
+        helper.emit = kEmitInlined
+        function = kMathOpFunctions[helper.op_code]
+        return f"{function}({number_c_expression(helper.inputs[0])})"
+    if helper.op_code == "data_lengthoflist":
+        helper.emit = kEmitInlined
+        return f"((ScratchNumber) Scratch_GetListLength(&ctx->{helper.arguments[0]}))"
+    if helper.op_code == "data_itemnumoflist":
+        helper.emit = kEmitInlined
+        list_name = helper.arguments[0]
+        item_helper = helper.inputs[0]
+        if item_helper.value_type == kValueTypeNumber:
+            item = number_c_expression(item_helper)
+            return f"((ScratchNumber) Scratch_FindListNumber(&ctx->{list_name}, {item}))"
+        emit_boxed_helper(item_helper)
+        item = f"{item_helper.function_name}(ctx, sprite, dt)"
+        return f"((ScratchNumber) Scratch_FindListItem(&ctx->{list_name}, {item}))"
+
+    emit_boxed_helper(helper)
+    return f"Scratch_ToNumber({helper.function_name}(ctx, sprite, dt))"
+
+
+def list_index_c_expression(list_name, index_helper, accept_all: bool) -> str:
+    """Returns C expression converting |index_helper| to an index of the list, see Scratch_ToListIndex."""
+    if index_helper.op_code == "read_value_string":
+        # The usual literals of list menus are resolved at compile time.
+        if index_helper.arguments[0] == "last":
+            index_helper.emit = kEmitInlined
+            return f"Scratch_GetListLength(&ctx->{list_name})"
+        if index_helper.arguments[0] == "all" and accept_all:
+            index_helper.emit = kEmitInlined
+            return "SCRATCH_VM_LIST_INDEX_ALL"
+    if index_helper.value_type == kValueTypeNumber:
+        index = number_c_expression(index_helper)
+        return f"Scratch_NumberToListIndex(&ctx->{list_name}, {index})"
+    emit_boxed_helper(index_helper)
+    index = f"{index_helper.function_name}(ctx, sprite, dt)"
+    return f"Scratch_ToListIndex(&ctx->{list_name}, {index}, {int(accept_all)})"
+
+
+def emit_list_helper(helper):
+    """Emits C expressions of the inputs of list blocks: the index and the number stored, if it's a number.
+
+    Items which aren't numbers are read through their boxed helpers.
+    """
+    list_name = helper.arguments[0]
+    item_helper = None
+    if helper.op_code in ("data_deleteoflist", "data_replaceitemoflist", "data_itemoflist"):
+        helper.index_c_expression = list_index_c_expression(
+            list_name, helper.inputs[0], helper.op_code == "data_deleteoflist"
+        )
+    if helper.op_code == "data_addtolist":
+        item_helper = helper.inputs[0]
+    if helper.op_code == "data_replaceitemoflist":
+        item_helper = helper.inputs[1]
+
+    if item_helper:
+        if item_helper.value_type == kValueTypeNumber:
+            helper.c_expression = number_c_expression(item_helper)
+        else:
+            emit_boxed_helper(item_helper)
+
+
+def emit_boxed_helper(helper):
+    """Emits |helper| as a function, boxing its value into ScratchVariable where it's needed."""
+    if helper.value_type == kValueTypeNumber:
+        helper.c_expression = number_c_expression(helper)
+        helper.emit = kEmitBoxedNumber
+        return
+
+    helper.emit = kEmitBoxed
+    if helper.op_code in kMotionBlocks:
+        helper.motion_updates = [
+            {
+                "field": field,
+                "kind": kind,
+                "c_expression": number_c_expression(input_helper),
+            }
+            for (_, field, kind), input_helper in zip(
+                kMotionBlocks[helper.op_code], helper.inputs
+            )
+        ]
+        return
+
+    if helper.op_code in kListBlocks:
+        emit_list_helper(helper)
+        return
+
+    if helper.op_code == "set_variable":
+        value_helper = helper.inputs[0]
+        if value_helper.value_type == kValueTypeNumber:
+            helper.c_expression = number_c_expression(value_helper)
+            return
+
+    for input_helper in helper.inputs:
+        emit_boxed_helper(input_helper)
+
+
+def infer_helper_types(helpers):
+    """Infers value types of the helpers of one block and decides how every helper is emitted.
+
+    |helpers| are in post-order, the last one is the root. Numeric subtrees are emitted as a single
+    ScratchNumber C expression. ScratchVariable boxing is kept only where a value is consumed as a
+    string (e.g. inputs of operator_join) or its type isn't known at compile time.
+    """
+    for helper in helpers:
+        helper.value_type = infer_helper_value_type(helper)
+        helper.emit = kEmitBoxed
+        helper.c_expression = ""
+
+
+def lower_helpers(blocks):
+    """Infers helper types of every block and decides how helpers are emitted."""
+    for block in blocks:
+        if block.op_code == kOpcodeRunInplace:
+            for helpers in block.scratch_input_helpers:
+                infer_helper_types(helpers)
+                emit_boxed_helper(helpers[-1])
+        elif block.op_code == "kScratchControlWait":
+            helpers = block.scratch_input_helpers[0]
+            infer_helper_types(helpers)
+            block.duration_c_expression = number_c_expression(helpers[-1])
+
 
 class Block:
     def __init__(self, target: Target, op_code: str, is_top_level: bool, level):
@@ -277,11 +866,26 @@ class Block:
         self.block_name = ""
         self.next_block_name = ""
         self.substack_block_name = ""
+        self.duration_c_expression = ""
+        # Received by kScratchWhenBroadcastReceived blocks, sent by kScratchBroadcastAndWait ones.
+        self.broadcast = None
+        # Index of the program of hat blocks, see assign_program_indices.
+        self.program_index = -1
+        # Blocks of a program reset when it's restarted, filled for hat blocks.
+        self.runtime_blocks = []
+        # Scratch block implemented by the block, the first one for inplace blocks.
+        self.scratch_block_id = ""
+        self.scratch_op_code = ""
+        # Index in profile sites, set when profiling.
+        self.profile_index = -1
+
+    def set_scratch_block(self, scratch_block):
+        self.scratch_block_id = scratch_block[kScratchBlockIdKey]
+        self.scratch_op_code = scratch_block["opcode"]
 
     def set_inplace_blocks(
         self,
-        scratch_json,
-        scratch_target,
+        target_index,
         helpers_count_obj,
         all_variables_and_cache,
         scratch_inplace_blocks,
@@ -294,18 +898,10 @@ class Block:
             if b["opcode"] == "data_setvariableto":
                 variable_id = b["fields"]["VARIABLE"][1]
 
-                access_variable(
-                    scratch_json, scratch_target, variable_id, all_variables_and_cache
-                )
+                access_variable(target_index, variable_id, all_variables_and_cache)
 
             helpers = []
-            extract_inline_helpers_r(
-                scratch_json,
-                scratch_target,
-                b,
-                helpers,
-                helpers_count_obj,
-            )
+            extract_inline_helpers_r(target_index, b, helpers, helpers_count_obj)
             self.scratch_input_helpers.append(helpers)
             self.scratch_functions.append(helpers[-1].function_name)
 
@@ -326,7 +922,13 @@ class Block:
 def can_run_inplace(scratch_block) -> bool:
     if scratch_block["opcode"] == "data_setvariableto":
         return True
-    if scratch_block["opcode"] == "motion_setx":
+    if scratch_block["opcode"] in kMotionBlocks:
+        return True
+    if scratch_block["opcode"] == "control_create_clone_of":
+        return True
+    if scratch_block["opcode"] == "event_broadcast":
+        return True
+    if scratch_block["opcode"] in kListStackBlocks:
         return True
 
     return False
@@ -342,11 +944,27 @@ def has_substack(scratch_block) -> bool:
 
 
 kOpcodeRunInplace = "kScratchInPlace"
+# Op codes of blocks starting scripts.
+kHatOpCodes = (
+    "kScratchWhenFlagClicked",
+    "kScratchWhenStartAsClone",
+    "kScratchWhenBroadcastReceived",
+)
+# Hat blocks of scripts advanced by the scheduler, the programs.
+kProgramHatOpCodes = ("kScratchWhenFlagClicked", "kScratchWhenBroadcastReceived")
+# Blocks with per instance state in ScratchContext, reset when their program is restarted.
+kRuntimeOpCodes = ("kScratchControlWait", "kScratchBroadcastAndWait")
 
 
 def to_known_op_codes(scratch_op_code):
     if scratch_op_code == "event_whenflagclicked":
         return "kScratchWhenFlagClicked"
+    if scratch_op_code == "control_start_as_clone":
+        return "kScratchWhenStartAsClone"
+    if scratch_op_code == "event_whenbroadcastreceived":
+        return "kScratchWhenBroadcastReceived"
+    if scratch_op_code == "event_broadcastandwait":
+        return "kScratchBroadcastAndWait"
     if scratch_op_code == "control_forever":
         return "kScratchControlForever"
     if scratch_op_code == "control_if":
@@ -355,221 +973,1273 @@ def to_known_op_codes(scratch_op_code):
         return "kScratchControlWait"
 
 
-def extract_targets_blocks_and_variables_r(
-    scratch_json,
-    scratch_target,
+def extract_script_blocks(
+    target_index,
+    target,
     helpers_count_obj,
-    scratch_block,
-    level,
-    all_targets,
+    blocks_count_obj,
+    scratch_top_level_block,
     all_blocks,
     all_variables_and_cache,
 ):
-    inplace_blocks = []
+    """Extracts blocks of the script starting at |scratch_top_level_block| into |all_blocks|.
+
+    The script is walked iteratively, so long scripts aren't limited by the Python recursion limit.
+    Blocks are extracted depth first, a substack before the rest of its chain, because block and
+    helper names are numbered in this order.
+    """
+
+    def add_block(op_code, scratch_block, level, link):
+        block = Block(target, op_code, scratch_block["topLevel"], level)
+        block.set_scratch_block(scratch_block)
+        name = "inplace" if op_code == kOpcodeRunInplace else scratch_block["opcode"]
+        # Numbered within the target, so that names don't depend on other targets.
+        block.block_name = f"{target_index.sprite_name}_{name}{blocks_count_obj['count']}"
+        blocks_count_obj["count"] += 1
+        all_blocks.append(block)
+        if link:
+            link_block, link_attribute = link
+            setattr(link_block, link_attribute, block.block_name)
+        return block
 
-    block = None
+    first_block_index = len(all_blocks)
 
-    scratch_next_block = scratch_block
-    while scratch_next_block:
-        scratch_cur_block = scratch_next_block
-        if not scratch_cur_block["next"]:
-            scratch_next_block = None
-        else:
-            scratch_next_block = scratch_target["blocks"][scratch_cur_block["next"]]
-        if can_run_inplace(scratch_cur_block):
-            inplace_blocks.append(scratch_cur_block)
-        else:
-            if len(inplace_blocks) > 0:
-                block = Block(
-                    all_targets[-1],
-                    kOpcodeRunInplace,
-                    scratch_cur_block["topLevel"],
-                    level,
-                )
-                block.max_level = level
+    # Chains left to walk: (first Scratch block, level, (block, attribute) linking the chain).
+    pending_chains = [(scratch_top_level_block, 0, None)]
+    while pending_chains:
+        scratch_block, level, link = pending_chains.pop()
+
+        inplace_blocks = []
+        while scratch_block:
+            if can_run_inplace(scratch_block):
+                inplace_blocks.append(scratch_block)
+                scratch_block = target_index.blocks.get(scratch_block["next"])
+                continue
+
+            if inplace_blocks:
+                block = add_block(kOpcodeRunInplace, inplace_blocks[0], level, link)
                 block.set_inplace_blocks(
-                    scratch_json,
-                    scratch_target,
+                    target_index,
                     helpers_count_obj,
                     all_variables_and_cache,
                     inplace_blocks,
                 )
-                block.block_name = f"{extract_sprite_name(scratch_target)}_inplace{str(len(all_blocks))}"
-                all_blocks.append(block)
+                link = (block, "next_block_name")
+                inplace_blocks = []
+
+            known_op_code = to_known_op_codes(scratch_block["opcode"])
+            block = add_block(known_op_code, scratch_block, level, link)
+            link = (block, "next_block_name")
 
-                result = extract_targets_blocks_and_variables_r(
-                    scratch_json,
-                    scratch_target,
+            helpers = []
+            if known_op_code == "kScratchControlWait":
+                extract_inputs_r(
+                    target_index,
+                    scratch_block["inputs"]["DURATION"],
+                    helpers,
                     helpers_count_obj,
-                    scratch_cur_block,
-                    level,
-                    all_targets,
-                    all_blocks,
-                    all_variables_and_cache,
                 )
-                if result is not None:
-                    block.next_block_name = result.block_name
-
-                    max_level = max(block.max_level, result.max_level)
-                    block.max_level = max_level
-                    result.max_level = max_level
-
-                return block
-            else:
-                known_op_code = to_known_op_codes(scratch_cur_block["opcode"])
-                block = Block(
-                    all_targets[-1],
-                    known_op_code,
-                    scratch_cur_block["topLevel"],
-                    level,
+                set_helpers_scratch_block(helpers, scratch_block)
+            elif known_op_code == "kScratchWhenBroadcastReceived":
+                block.broadcast = access_broadcast(
+                    target_index, scratch_block["fields"]["BROADCAST_OPTION"][0]
                 )
-                block.max_level = level
-                op_code = scratch_cur_block["opcode"]
-                block.block_name = f"{extract_sprite_name(scratch_target)}_{op_code}{str(len(all_blocks))}"
-                all_blocks.append(block)
-
-                helpers = []
-                if known_op_code == "kScratchControlWait":
-                    extract_inputs_r(
-                        scratch_json,
-                        scratch_target,
-                        scratch_cur_block["inputs"]["DURATION"],
-                        helpers,
-                        helpers_count_obj,
-                    )
-                block.scratch_input_helpers.append(helpers)
-
-                if has_substack(scratch_cur_block):
-                    substack_id = scratch_cur_block["inputs"]["SUBSTACK"][1]
-                    substack_result = extract_targets_blocks_and_variables_r(
-                        scratch_json,
-                        scratch_target,
-                        helpers_count_obj,
-                        scratch_target["blocks"][substack_id],
+            elif known_op_code == "kScratchBroadcastAndWait":
+                block.broadcast = extract_broadcast_input(target_index, scratch_block)
+            block.scratch_input_helpers.append(helpers)
+
+            if has_substack(scratch_block):
+                # Walk the substack first and the rest of this chain after it.
+                substack_id = scratch_block["inputs"]["SUBSTACK"][1]
+                pending_chains.append(
+                    (target_index.blocks.get(scratch_block["next"]), level, link)
+                )
+                pending_chains.append(
+                    (
+                        target_index.blocks[substack_id],
                         level + 1,
-                        all_targets,
-                        all_blocks,
-                        all_variables_and_cache,
+                        (block, "substack_block_name"),
                     )
-
-                    if substack_result:
-                        block.substack_block_name = substack_result.block_name
-
-                        max_level = max(block.max_level, substack_result.max_level)
-                        block.max_level = max_level
-                        substack_result.max_level = max_level
-
-                result = extract_targets_blocks_and_variables_r(
-                    scratch_json,
-                    scratch_target,
-                    helpers_count_obj,
-                    scratch_next_block,
-                    level,
-                    all_targets,
-                    all_blocks,
-                    all_variables_and_cache,
                 )
-                if result is not None:
-                    block.next_block_name = result.block_name
-
-                    max_level = max(block.max_level, result.max_level)
-                    block.max_level = max_level
-                    result.max_level = max_level
+                break
 
-                return block
+            scratch_block = target_index.blocks.get(scratch_block["next"])
 
-    if len(inplace_blocks) > 0:
-        block = Block(
-            all_targets[-1], kOpcodeRunInplace, scratch_cur_block["topLevel"], level
-        )
-        block.max_level = level
-        block.set_inplace_blocks(
-            scratch_json,
-            scratch_target,
-            helpers_count_obj,
-            all_variables_and_cache,
-            inplace_blocks,
-        )
-        block.block_name = (
-            f"{extract_sprite_name(scratch_target)}_inplace{str(len(all_blocks))}"
-        )
-        all_blocks.append(block)
-
-        return block
+        if inplace_blocks:
+            block = add_block(kOpcodeRunInplace, inplace_blocks[0], level, link)
+            block.set_inplace_blocks(
+                target_index,
+                helpers_count_obj,
+                all_variables_and_cache,
+                inplace_blocks,
+            )
 
-    return block
+    # Blocks of a chain and of a substack are extracted after the block linking them, so the
+    # deepest level reachable from every block is known once they are visited in reverse.
+    script_blocks = all_blocks[first_block_index:]
+    blocks_by_name = {b.block_name: b for b in script_blocks}
+    for block in reversed(script_blocks):
+        block.max_level = block.level
+        for name in (block.next_block_name, block.substack_block_name):
+            if name:
+                block.max_level = max(block.max_level, blocks_by_name[name].max_level)
 
 
 def extract_targets_blocks_and_variables(scratch_json):
     all_targets = []
     all_blocks = []
     all_variables_and_cache = {"all_variables": [], "cache": {}}
-    for scratch_target in scratch_json["targets"]:
-        sprite_name = extract_sprite_name(scratch_target)
-        target = Target(sprite_name)
+    # All the lists, used by blocks or not: hosts may read them and they have initial items.
+    all_lists = {}
+    all_broadcasts = {}
+    for target_index in index_scratch_program(scratch_json, all_broadcasts):
+        target = Target(target_index.sprite_name, target_index.scratch_target["name"])
+        extract_target_properties(target, target_index.scratch_target)
         all_targets.append(target)
-
-        top_level_block_ids = []
-        for scratch_block_id, scratch_block in scratch_target["blocks"].items():
-            if scratch_block["topLevel"]:
-                top_level_block_ids.append(scratch_block_id)
+        for scratch_list in target_index.lists.values():
+            all_lists.setdefault(scratch_list.list_name, scratch_list)
 
         helpers_count_obj = {"count": 0}
-        for scratch_top_level_block_id in top_level_block_ids:
-            extract_targets_blocks_and_variables_r(
-                scratch_json,
-                scratch_target,
+        blocks_count_obj = {"count": 0}
+        for scratch_top_level_block_id in target_index.top_level_block_ids:
+            extract_script_blocks(
+                target_index,
+                target,
                 helpers_count_obj,
-                scratch_target["blocks"][scratch_top_level_block_id],
-                0,
-                all_targets,
+                blocks_count_obj,
+                target_index.blocks[scratch_top_level_block_id],
                 all_blocks,
                 all_variables_and_cache,
             )
 
-    return all_targets, all_blocks, all_variables_and_cache["all_variables"]
+    return (
+        all_targets,
+        all_blocks,
+        all_variables_and_cache["all_variables"],
+        list(all_lists.values()),
+        assign_broadcast_ids(all_broadcasts),
+    )
+
 
+def assign_broadcast_ids(broadcasts) -> list:
+    """Gives broadcasts dense IDs in the order of their names. Returns broadcasts by ID."""
+    result = [broadcasts[key] for key in sorted(broadcasts)]
+    for broadcast_id, broadcast in enumerate(result):
+        broadcast.id = broadcast_id
+    return result
+
+
+kHashOffsetBasis = 2166136261
+kHashPrime = 16777619
+
+
+def variable_name_hash(sprite_name: str, variable_name: str, seed: int) -> int:
+    """32-bit FNV-1a of "<sprite>\\0<variable>" starting from a seeded basis.
+
+    Must match Scratch_HashVariableName in the C template.
+    """
+    value = (kHashOffsetBasis ^ seed) & 0xFFFFFFFF
+    for c in sprite_name.encode("utf-8") + b"\0" + variable_name.encode("utf-8"):
+        value = ((value ^ c) * kHashPrime) & 0xFFFFFFFF
+    return value ^ (value >> 16)
+
+
+class VariablePerfectHash:
+    """Minimal perfect hash of (sprite, variable) names, built with hash and displace.
+
+    Keys are put to buckets by the hash with seed 0. Starting from the largest bucket, every bucket gets the
+    smallest seed for which the hashes of all its keys land in free slots. A lookup is two hashes and a
+    single comparison of names.
+    """
+
+    def __init__(self, variables):
+        size = len(variables)
+        self.seeds = [0] * size
+        self.slots = [0] * size
+
+        buckets = [[] for _ in range(size)]
+        for index, variable in enumerate(variables):
+            key = (variable.scratch_target_name, variable.scratch_variable_name)
+            buckets[variable_name_hash(*key, 0) % size].append((index, key))
+
+        taken = [False] * size
+        for bucket_index in sorted(range(size), key=lambda b: -len(buckets[b])):
+            bucket = buckets[bucket_index]
+            if not bucket:
+                break
+            seed = 1
+            while True:
+                slots = [variable_name_hash(*key, seed) % size for _, key in bucket]
+                if len(set(slots)) == len(slots) and not any(taken[s] for s in slots):
+                    break
+                seed += 1
+            self.seeds[bucket_index] = seed
+            for (index, _), slot in zip(bucket, slots):
+                taken[slot] = True
+                self.slots[slot] = index
+
+
+def intern_string_constants(blocks, variables, lists=()) -> StringConstants:
+    string_constants = StringConstants()
+    for variable in variables:
+        if variable.is_string:
+            variable.string_constant = string_constants.intern(variable.value)
+    for scratch_list in lists:
+        for item in scratch_list.items:
+            if item["is_string"]:
+                item["string_constant"] = string_constants.intern(item["value"])
+    for block in blocks:
+        for helpers in block.scratch_input_helpers:
+            for helper in helpers:
+                if (
+                    helper.op_code == "read_value_string"
+                    and helper.emit != kEmitInlined
+                ):
+                    helper.string_constant = string_constants.intern(
+                        helper.arguments[0]
+                    )
+    return string_constants
 
-def compile_scratch_program(scratch_json, output_stem: str):
-    header_file_path = f"{output_stem}.h"
-    c_file_path = f"{output_stem}.c"
 
-    with open(header_file_path, "w") as header_file:
-        with open(c_file_path, "w") as c_file:
-            env = Environment(
-                loader=PackageLoader("scratch-transpiler"),
-                autoescape=select_autoescape(),
-                trim_blocks=True,
-                lstrip_blocks=True,
+class OptimizationSummary:
+    def __init__(self):
+        self.folded_expressions = 0
+        self.removed_blocks = 0
+        self.removed_variable_writes = 0
+
+    def __str__(self):
+        return (
+            f"Optimized: folded {self.folded_expressions} constant expressions, "
+            f"removed {self.removed_blocks} unreachable blocks, "
+            f"removed {self.removed_variable_writes} writes to unread variables"
+        )
+
+
+def constant_helper_value(helper):
+    if helper.op_code == "read_value_number":
+        try:
+            return float(helper.arguments[0])
+        except (TypeError, ValueError):
+            return 0.0
+    if helper.op_code == "read_value_string":
+        return str(helper.arguments[0])
+    return None
+
+
+def to_scratch_number_text(number: float) -> str:
+    """Formats |number| the way Scratch (JavaScript) converts numbers to strings.
+
+    Must match Scratch_CacheNumberAsString of the runtime: the shortest digits reading back as the same number,
+    fixed notation for 1e-6 <= |number| < 1e21 and the exponent form outside.
+    """
+    if math.isnan(number):
+        return "NaN"
+    if math.isinf(number):
+        return "Infinity" if number > 0 else "-Infinity"
+    if number.is_integer() and abs(number) < 2**53:
+        return str(int(number))
+
+    # repr has the shortest digits, only its notation differs from JavaScript.
+    _, digit_values, last_exponent = decimal.Decimal(repr(abs(number))).normalize().as_tuple()
+    digits = "".join(str(d) for d in digit_values)
+    # The decimal exponent of the first significant digit.
+    exponent = last_exponent + len(digits) - 1
+
+    sign = "-" if number < 0 else ""
+    if 0 <= exponent < 21:
+        if len(digits) <= exponent + 1:
+            return sign + digits + "0" * (exponent + 1 - len(digits))
+        return sign + digits[: exponent + 1] + "." + digits[exponent + 1 :]
+    if -6 <= exponent < 0:
+        return sign + "0." + "0" * (-exponent - 1) + digits
+    text = digits[0] + ("." + digits[1:] if len(digits) > 1 else "")
+    return f"{sign}{text}e{'-' if exponent < 0 else '+'}{abs(exponent)}"
+
+
+def constant_helper_text(helper):
+    """Returns literal text of a constant helper as operator_join sees it."""
+    if helper.op_code in ("read_value_number", "read_value_string"):
+        return str(helper.arguments[0])
+    return None
+
+
+def evaluate_constant_helper(helper):
+    """Returns (op_code, value) of the literal replacing |helper| or None if it can't be folded."""
+    if helper.op_code == "operator_join":
+        texts = [constant_helper_text(h) for h in helper.inputs]
+        if None in texts:
+            return None
+        return "read_value_string", "".join(texts)
+
+    numbers = [constant_helper_value(h) for h in helper.inputs]
+    if not numbers or None in numbers:
+        return None
+    if not all(h.op_code == "read_value_number" for h in helper.inputs):
+        # Strings read as numbers are left to the runtime.
+        return None
+
+    try:
+        if helper.op_code == "operator_add":
+            return "read_value_number", numbers[0] + numbers[1]
+        if helper.op_code == "operator_multiply":
+            return "read_value_number", numbers[0] * numbers[1]
+        if helper.op_code == "operator_divide":
+            return "read_value_number", numbers[0] / numbers[1]
+        if helper.op_code in kMathOpFunctions:
+            function = {
+                "abs": abs,
+                "floor": math.floor,
+                "ceiling": math.ceil,
+                "sqrt": math.sqrt,
+                "ln": math.log,
+                "log": math.log10,
+                "e ^": math.exp,
+            }[helper.op_code]
+            return "read_value_number", float(function(numbers[0]))
+    except (ArithmeticError, ValueError):
+        # Division by zero, sqrt of a negative number, etc. keep the runtime IEEE semantics.
+        return None
+    return None
+
+
+def fold_constant_helpers(helpers, summary) -> list:
+    """Folds constant subtrees of one block's helpers. Returns the remaining helpers in post-order."""
+    if not helpers:
+        return helpers
+
+    def fold(helper):
+        for input_helper in helper.inputs:
+            fold(input_helper)
+
+        folded = evaluate_constant_helper(helper)
+        if folded is None:
+            return
+        helper.op_code, value = folded
+        if helper.op_code == "read_value_number":
+            value = to_scratch_number_text(value)
+        helper.arguments = [value]
+        helper.inputs = []
+        summary.folded_expressions += 1
+
+    def collect(helper, result):
+        for input_helper in helper.inputs:
+            collect(input_helper, result)
+        result.append(helper)
+        return result
+
+    fold(helpers[-1])
+    return collect(helpers[-1], [])
+
+
+def remove_unreachable_blocks(blocks, summary) -> list:
+    """Removes blocks after control_forever and scripts that aren't started by any hat block."""
+    blocks_by_name = {b.block_name: b for b in blocks}
+
+    for block in blocks:
+        if block.op_code == "kScratchControlForever":
+            block.next_block_name = ""
+
+    reachable = set()
+    pending = [b for b in blocks if b.op_code in kHatOpCodes]
+    while pending:
+        block = pending.pop()
+        if block.block_name in reachable:
+            continue
+        reachable.add(block.block_name)
+        for name in (block.next_block_name, block.substack_block_name):
+            if name:
+                pending.append(blocks_by_name[name])
+
+    summary.removed_blocks += len(blocks) - len(reachable)
+    return [b for b in blocks if b.block_name in reachable]
+
+
+def remove_unread_variable_writes(blocks, summary) -> list:
+    """Removes set_variable helpers writing variables no expression reads.
+
+    Inplace blocks left without helpers are unlinked from their scripts.
+    """
+    read_variables = set()
+    for block in blocks:
+        for helpers in block.scratch_input_helpers:
+            for helper in helpers:
+                if helper.op_code == "read_variable":
+                    read_variables.add(helper.arguments[0])
+
+    removed_blocks = {}
+    for block in blocks:
+        if block.op_code != kOpcodeRunInplace:
+            continue
+
+        kept = [
+            i
+            for i, helpers in enumerate(block.scratch_input_helpers)
+            if not (
+                helpers[-1].op_code == "set_variable"
+                and helpers[-1].arguments[1] not in read_variables
             )
+        ]
+        summary.removed_variable_writes += len(block.scratch_input_helpers) - len(kept)
+        block.scratch_input_helpers = [block.scratch_input_helpers[i] for i in kept]
+        block.scratch_functions = [block.scratch_functions[i] for i in kept]
+        block.scratch_inplace_blocks_op_codes = [
+            block.scratch_inplace_blocks_op_codes[i] for i in kept
+        ]
+        if not block.scratch_functions:
+            removed_blocks[block.block_name] = block
+
+    def skip_removed(name):
+        while name in removed_blocks:
+            name = removed_blocks[name].next_block_name
+        return name
+
+    for block in blocks:
+        block.next_block_name = skip_removed(block.next_block_name)
+        block.substack_block_name = skip_removed(block.substack_block_name)
+
+    return [b for b in blocks if b.block_name not in removed_blocks]
+
+
+def optimize_program(blocks, drop_unread_variables: bool):
+    """Runs the optimization passes over extracted blocks. Returns optimized blocks and a summary.
+
+    Writes to unread variables are dropped only when asked, because hosts may read any variable
+    with Scratch_FindVariable.
+    """
+    summary = OptimizationSummary()
+
+    blocks = remove_unreachable_blocks(blocks, summary)
+    for block in blocks:
+        block.scratch_input_helpers = [
+            fold_constant_helpers(helpers, summary)
+            for helpers in block.scratch_input_helpers
+        ]
+    if drop_unread_variables:
+        # Removing a write can leave another variable unread, repeat until nothing changes.
+        removed_variable_writes = -1
+        while removed_variable_writes != summary.removed_variable_writes:
+            removed_variable_writes = summary.removed_variable_writes
+            blocks = remove_unread_variable_writes(blocks, summary)
+
+    return blocks, summary
+
+
+class CloneScript:
+    """A "when I start as a clone" script, run for every new clone of its sprite."""
+
+    def __init__(self, hat_block, blocks):
+        self.hat_block = hat_block
+        self.target = hat_block.target
+        self.name = hat_block.block_name
+        self.blocks = blocks
+        # Scripts of motion blocks only are run block by block with column kernels over all new clones. Any
+        # other block may depend on state changed by the script for a previous clone, such scripts run clone
+        # by clone.
+        self.use_kernels = all(
+            helpers[-1].op_code in kMotionBlocks
+            for block in blocks
+            for helpers in block.scratch_input_helpers
+        )
+
+
+def extract_clone_scripts(blocks):
+    """Moves blocks of "when I start as a clone" scripts out of |blocks|.
+
+    Clone scripts run to completion when a clone starts, only inplace blocks are supported in them.
+    Returns remaining blocks and clone scripts.
+    """
+    blocks_by_name = {b.block_name: b for b in blocks}
+    clone_scripts = []
+    moved = set()
+    for hat_block in blocks:
+        if hat_block.op_code != "kScratchWhenStartAsClone":
+            continue
+
+        script_blocks = []
+        block = blocks_by_name.get(hat_block.next_block_name)
+        while block:
+            if block.op_code != kOpcodeRunInplace:
+                print(
+                    f"Warning: {block.block_name} isn't supported in clone scripts, "
+                    f"the rest of {hat_block.block_name} is ignored"
+                )
+                break
+            script_blocks.append(block)
+            block = blocks_by_name.get(block.next_block_name)
+
+        moved.add(hat_block.block_name)
+        moved.update(b.block_name for b in script_blocks)
+        clone_scripts.append(CloneScript(hat_block, script_blocks))
+
+    return [b for b in blocks if b.block_name not in moved], clone_scripts
+
+
+def state_layout_hash(
+    targets, variables, lists, broadcasts, blocks, hat_blocks, scheduler
+) -> int:
+    """64-bit FNV-1a of everything the layout of a saved state depends on.
+
+    Scratch_LoadState rejects states saved by programs with another hash.
+    """
+    parts = [scheduler]
+    parts += [t.variable_name for t in targets]
+    parts += [v.variable_name for v in variables]
+    parts += [l.list_name for l in lists]
+    parts += [b.name for b in broadcasts]
+    parts += [f"{b.block_name}:{b.op_code}" for b in blocks]
+    if scheduler == "threaded":
+        parts += [f"{b.block_name}:{len(b.program_blocks)}" for b in hat_blocks]
+    else:
+        parts += [f"{b.block_name}:{b.max_level}" for b in hat_blocks]
+
+    value = 14695981039346656037
+    for c in "\0".join(parts).encode("utf-8"):
+        value = ((value ^ c) * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+class ProfileSite:
+    """A generated function counted by the profiler, an entry of kScratchProfileSites."""
+
+    def __init__(self, block_id, block_op_code, target, function_name):
+        self.block_id = to_c_string_literal(block_id)
+        self.block_op_code = to_c_string_literal(block_op_code)
+        self.sprite_name = to_c_string_literal(target.scratch_name)
+        self.function_name = to_c_string_literal(function_name)
+
+
+def assign_profile_sites(targets) -> list:
+    """Gives every generated block function and helper an index in profile counters.
+
+    Sites of a target are consecutive, starting at Target.profile_sites_begin.
+    """
+    sites = []
+
+    def add_helpers(block):
+        for helpers in block.scratch_input_helpers:
+            for helper in helpers:
+                helper.profile_return_type = helper_c_return_type(helper)
+                if helper.profile_return_type:
+                    helper.profile_index = len(sites)
+                    sites.append(
+                        ProfileSite(
+                            helper.scratch_block_id,
+                            helper.scratch_op_code,
+                            block.target,
+                            helper.function_name,
+                        )
+                    )
 
-            header_template = env.get_template("scratch-transpiler-main-template.h")
-            header_file.write(header_template.render())
+    for target in targets:
+        target.profile_sites_begin = len(sites)
+
+        for block in target.blocks:
+            add_helpers(block)
+            block.profile_index = len(sites)
+            sites.append(
+                ProfileSite(
+                    block.scratch_block_id,
+                    block.scratch_op_code,
+                    block.target,
+                    f"{block.block_name}_function",
+                )
+            )
 
-            targets, blocks, variables = extract_targets_blocks_and_variables(
-                scratch_json
+        for script in target.clone_scripts:
+            for block in script.blocks:
+                add_helpers(block)
+            script.profile_index = len(sites)
+            sites.append(
+                ProfileSite(
+                    script.hat_block.scratch_block_id,
+                    script.hat_block.scratch_op_code,
+                    script.target,
+                    f"{script.name}_clones_function",
+                )
             )
 
-            when_flag_clicked_blocks = [
-                b for b in blocks if b.op_code == "kScratchWhenFlagClicked"
-            ]
-
-            c_template = env.get_template("scratch-transpiler-main-template.c")
-            c_file.write(
-                c_template.render(
-                    main_header_file=header_file_path,
-                    targets=targets,
-                    blocks=blocks,
-                    variables=variables,
-                    when_flag_clicked_blocks=when_flag_clicked_blocks,
+    return sites
+
+
+def collect_program_blocks(blocks, hat_blocks):
+    """Lists blocks of every script in execution order for the threaded scheduler."""
+    blocks_by_name = {b.block_name: b for b in blocks}
+    for block in hat_blocks:
+        block.program_blocks = []
+        program_block = block
+        while program_block:
+            block.program_blocks.append(program_block)
+            program_block = blocks_by_name.get(program_block.next_block_name)
+
+
+def assign_program_indices(blocks, hat_blocks):
+    """Numbers programs like kScratchPrograms and links broadcasts with the programs using them.
+
+    Every hat block gets the blocks with runtime state reachable from it, restarting the program resets
+    them. A program with `broadcast and wait` is a waiter of the broadcast, it's woken up by the last of
+    its receivers to finish.
+    """
+    blocks_by_name = {b.block_name: b for b in blocks}
+    for program_index, hat_block in enumerate(hat_blocks):
+        hat_block.program_index = program_index
+        if hat_block.op_code == "kScratchWhenBroadcastReceived":
+            hat_block.broadcast.receivers.append(program_index)
+
+        hat_block.runtime_blocks = []
+        pending = [hat_block]
+        while pending:
+            block = pending.pop()
+            if block.op_code in kRuntimeOpCodes:
+                hat_block.runtime_blocks.append(block)
+            if block.op_code == "kScratchBroadcastAndWait":
+                if program_index not in block.broadcast.waiters:
+                    block.broadcast.waiters.append(program_index)
+            for name in (block.next_block_name, block.substack_block_name):
+                if name:
+                    pending.append(blocks_by_name[name])
+
+
+class BroadcastTables:
+    """Receivers and waiters of all the broadcasts flattened into the arrays of the generated dispatch tables.
+
+    Programs of broadcast b are at [begin[b], begin[b + 1]). Arrays are never empty, C has no empty arrays.
+    """
+
+    def __init__(self, broadcasts):
+        self.receivers_begin = []
+        self.receivers = []
+        self.waiters_begin = []
+        self.waiters = []
+        for broadcast in broadcasts:
+            self.receivers_begin.append(len(self.receivers))
+            self.receivers += broadcast.receivers
+            self.waiters_begin.append(len(self.waiters))
+            self.waiters += broadcast.waiters
+        self.receivers_begin.append(len(self.receivers))
+        self.waiters_begin.append(len(self.waiters))
+        self.receivers = self.receivers or [-1]
+        self.waiters = self.waiters or [-1]
+
+
+def start_program_words(hat_blocks) -> list:
+    """Words of the program set of "when flag clicked" programs, which are runnable after Scratch_Init."""
+    words = [0] * ((len(hat_blocks) + 63) // 64)
+    for block in hat_blocks:
+        if block.op_code == "kScratchWhenFlagClicked":
+            words[block.program_index // 64] |= 1 << (block.program_index % 64)
+    return [f"{hex(word)}ull" for word in words]
+
+
+kPngSignature = b"\x89PNG\r\n\x1a\n"
+
+# Channels of PNG color types: gray, RGB, palette, gray + alpha, RGBA.
+kPngChannels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+
+
+def unfilter_png_row(filter_type: int, row: bytearray, previous: bytearray, channels: int):
+    """Undoes the PNG filter of |row| in place, |previous| is the unfiltered row above."""
+    if filter_type == 1:
+        for i in range(channels, len(row)):
+            row[i] = (row[i] + row[i - channels]) & 0xFF
+    elif filter_type == 2:
+        for i in range(len(row)):
+            row[i] = (row[i] + previous[i]) & 0xFF
+    elif filter_type == 3:
+        for i in range(len(row)):
+            left = row[i - channels] if i >= channels else 0
+            row[i] = (row[i] + ((left + previous[i]) >> 1)) & 0xFF
+    elif filter_type == 4:
+        for i in range(len(row)):
+            left = row[i - channels] if i >= channels else 0
+            up = previous[i]
+            up_left = previous[i - channels] if i >= channels else 0
+            estimate = left + up - up_left
+            distance_left = abs(estimate - left)
+            distance_up = abs(estimate - up)
+            distance_up_left = abs(estimate - up_left)
+            if distance_left <= distance_up and distance_left <= distance_up_left:
+                predictor = left
+            elif distance_up <= distance_up_left:
+                predictor = up
+            else:
+                predictor = up_left
+            row[i] = (row[i] + predictor) & 0xFF
+
+
+def decode_png(data: bytes):
+    """Decodes a non-interlaced PNG of 8-bit channels. Returns (width, height, RGBA bytes) or None."""
+    if not data.startswith(kPngSignature):
+        return None
+    header = None
+    palette = b""
+    transparency = b""
+    compressed = []
+    position = len(kPngSignature)
+    while position + 8 <= len(data):
+        length, kind = struct.unpack(">I4s", data[position : position + 8])
+        chunk = data[position + 8 : position + 8 + length]
+        position += length + 12
+        if kind == b"IHDR":
+            header = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"PLTE":
+            palette = chunk
+        elif kind == b"tRNS":
+            transparency = chunk
+        elif kind == b"IDAT":
+            compressed.append(chunk)
+        elif kind == b"IEND":
+            break
+    if header is None:
+        return None
+    width, height, depth, color_type, _, _, interlace = header
+    if depth != 8 or interlace or color_type not in kPngChannels:
+        return None
+    channels = kPngChannels[color_type]
+    try:
+        raw = zlib.decompress(b"".join(compressed))
+    except zlib.error:
+        return None
+    stride = width * channels
+    if len(raw) < (stride + 1) * height:
+        return None
+
+    pixels = bytearray()
+    previous = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        row = bytearray(raw[start + 1 : start + 1 + stride])
+        unfilter_png_row(raw[start], row, previous, channels)
+        previous = row
+        pixels += row
+
+    if color_type == 6:
+        return width, height, bytes(pixels)
+    opaque = b"\xff" * (width * height)
+    rgba = bytearray(width * height * 4)
+    if color_type == 2:
+        for channel in range(3):
+            rgba[channel::4] = pixels[channel::3]
+        rgba[3::4] = opaque
+    elif color_type in (0, 4):
+        for channel in range(3):
+            rgba[channel::4] = pixels[::channels]
+        rgba[3::4] = pixels[1::2] if color_type == 4 else opaque
+    else:
+        colors = [
+            palette[i * 3 : i * 3 + 3]
+            + bytes([transparency[i] if i < len(transparency) else 255])
+            for i in range(len(palette) // 3)
+        ]
+        for i, index in enumerate(pixels):
+            if index < len(colors):
+                rgba[i * 4 : i * 4 + 4] = colors[index]
+    return width, height, bytes(rgba)
+
+
+def svg_size(data: bytes):
+    """Width and height of the root <svg> element, from its attributes or its viewBox. None if unknown."""
+    match = re.search(rb"<svg\b[^>]*>", data)
+    if not match:
+        return None
+    attributes = dict(re.findall(rb'([\w:-]+)\s*=\s*"([^"]*)"', match.group(0)))
+    try:
+        return (
+            float(re.match(rb"[\d.]+", attributes[b"width"]).group(0)),
+            float(re.match(rb"[\d.]+", attributes[b"height"]).group(0)),
+        )
+    except (KeyError, AttributeError, ValueError):
+        pass
+    try:
+        _, _, width, height = (float(v) for v in attributes[b"viewBox"].split())
+        return width, height
+    except (KeyError, ValueError):
+        return None
+
+
+# Vector costumes are not rasterized, they are drawn as boxes of their size, at most this many pixels a side.
+kMaxPlaceholderSize = 1024
+
+
+def placeholder_pixels(width: int, height: int, name: str) -> bytes:
+    """RGBA of a translucent box with an opaque border, colored by |name|."""
+    color = zlib.crc32(name.encode("utf-8"))
+    fill = bytes([color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, 0x80])
+    border = bytes([fill[0] // 2, fill[1] // 2, fill[2] // 2, 0xFF])
+    edge_row = border * width
+    if width <= 2 or height <= 2:
+        return edge_row * height
+    inner_row = border + fill * (width - 2) + border
+    return edge_row + inner_row * (height - 2) + edge_row
+
+
+class AtlasImage:
+    """Pixels of a costume file, the position in the atlas is assigned by pack_atlas."""
+
+    def __init__(self, width: int, height: int, pixels: bytes):
+        self.width = width
+        self.height = height
+        self.pixels = pixels
+        self.atlas_x = 0
+        self.atlas_y = 0
+
+
+class Costume:
+    """A costume of a target: its image in the atlas and the rotation center in pixels of the image."""
+
+    def __init__(self, name, image, rotation_center_x, rotation_center_y, resolution):
+        self.name = name
+        self.image = image
+        self.rotation_center_x = rotation_center_x
+        self.rotation_center_y = rotation_center_y
+        # Pixels of the image per stage unit, e.g. 2 for Scratch bitmaps.
+        self.resolution = resolution
+
+
+def rasterize_costume(scratch_costume, data) -> AtlasImage:
+    """Decodes PNG costumes, anything else becomes a placeholder box of the costume size."""
+    decoded = decode_png(data) if data else None
+    if decoded:
+        return AtlasImage(*decoded)
+
+    size = svg_size(data) if data and scratch_costume.get("dataFormat") == "svg" else None
+    if size is None:
+        # Without a readable file the rotation center is usually in the middle of the costume.
+        size = (
+            2 * float(scratch_costume.get("rotationCenterX", 16)),
+            2 * float(scratch_costume.get("rotationCenterY", 16)),
+        )
+    resolution = float(scratch_costume.get("bitmapResolution", 1))
+    width = min(max(int(math.ceil(size[0] * resolution)), 1), kMaxPlaceholderSize)
+    height = min(max(int(math.ceil(size[1] * resolution)), 1), kMaxPlaceholderSize)
+    return AtlasImage(
+        width, height, placeholder_pixels(width, height, scratch_costume["name"])
+    )
+
+
+def pack_atlas(images) -> tuple:
+    """Shelf packing: images from the tallest one are put left to right into rows of a power of two width.
+
+    A pixel of padding keeps filtering from bleeding between neighbours. Returns the atlas size, both
+    powers of two.
+    """
+    kPadding = 1
+    if not images:
+        return 1, 1
+    area = sum((i.width + kPadding) * (i.height + kPadding) for i in images)
+    width = 1
+    while width < max(max(i.width for i in images) + kPadding, math.sqrt(area)):
+        width *= 2
+
+    x = 0
+    y = 0
+    shelf_height = 0
+    for image in sorted(images, key=lambda i: (-i.height, -i.width)):
+        if x + image.width > width:
+            x = 0
+            y += shelf_height
+            shelf_height = 0
+        image.atlas_x = x
+        image.atlas_y = y
+        x += image.width + kPadding
+        shelf_height = max(shelf_height, image.height + kPadding)
+    height = 1
+    while height < y + shelf_height:
+        height *= 2
+    return width, height
+
+
+class Atlas:
+    """Costumes of every target packed into a single image, see pack_costumes."""
+
+    def __init__(self, costumes, images, width, height):
+        self.costumes = costumes
+        self.images = images
+        self.width = width
+        self.height = height
+
+
+def pack_costumes(scratch_json, targets, assets) -> Atlas:
+    """Packs costumes of every target, images of costume files shared by costumes are packed once.
+
+    Sets Target.costume to the index of the current costume of the target.
+    """
+    targets_by_name = {t.scratch_name: t for t in targets}
+    images = {}
+    costumes = []
+    for scratch_target in scratch_json["targets"]:
+        target = targets_by_name[scratch_target["name"]]
+        for index, scratch_costume in enumerate(scratch_target.get("costumes", [])):
+            asset_name = scratch_costume.get("md5ext") or scratch_costume["name"]
+            if asset_name not in images:
+                images[asset_name] = rasterize_costume(
+                    scratch_costume, assets.get(asset_name)
+                )
+            if index == scratch_target.get("currentCostume", 0):
+                target.costume = len(costumes)
+            costumes.append(
+                Costume(
+                    scratch_costume["name"],
+                    images[asset_name],
+                    float(scratch_costume.get("rotationCenterX", 0)),
+                    float(scratch_costume.get("rotationCenterY", 0)),
+                    float(scratch_costume.get("bitmapResolution", 1)),
                 )
             )
+    width, height = pack_atlas(list(images.values()))
+    return Atlas(costumes, list(images.values()), width, height)
+
+
+def atlas_bmp(atlas: Atlas) -> bytes:
+    """A top-down 32-bit BMP with alpha, which SDL_LoadBMP reads without any image library."""
+    pixels = bytearray(atlas.width * atlas.height * 4)
+    for image in atlas.images:
+        # RGBA to the BGRA of the channel masks below.
+        bgra = bytearray(image.pixels)
+        bgra[0::4] = image.pixels[2::4]
+        bgra[2::4] = image.pixels[0::4]
+        row_size = image.width * 4
+        for row in range(image.height):
+            offset = ((image.atlas_y + row) * atlas.width + image.atlas_x) * 4
+            pixels[offset : offset + row_size] = bgra[row * row_size : (row + 1) * row_size]
+
+    kFileHeaderSize = 14
+    kInfoHeaderSize = 108
+    kBitFields = 3
+    file_header = struct.pack(
+        "<2sIHHI",
+        b"BM",
+        kFileHeaderSize + kInfoHeaderSize + len(pixels),
+        0,
+        0,
+        kFileHeaderSize + kInfoHeaderSize,
+    )
+    # BITMAPV4HEADER: negative height for top-down rows, masks of R, G, B and A, sRGB.
+    info_header = struct.pack(
+        "<IiiHHIIiiIIIIII4s36sIII",
+        kInfoHeaderSize,
+        atlas.width,
+        -atlas.height,
+        1,
+        32,
+        kBitFields,
+        len(pixels),
+        2835,
+        2835,
+        0,
+        0,
+        0x00FF0000,
+        0x0000FF00,
+        0x000000FF,
+        0xFF000000,
+        b"BGRs",
+        bytes(36),
+        0,
+        0,
+        0,
+    )
+    return file_header + info_header + bytes(pixels)
+
+
+def atlas_file_name(stem_name: str) -> str:
+    return f"{stem_name}_atlas.bmp"
+
+
+def output_file_names(scratch_json, output_stem: str, atlas: bool = False) -> list:
+    """Names of the files compile_scratch_program generates: the runtime, headers, a unit per target and
+    the atlas with |atlas|."""
+    stem_name = os.path.basename(output_stem)
+    return (
+        [f"{stem_name}.c", f"{stem_name}.h", f"{stem_name}_internal.h"]
+        + [f"{stem_name}_{extract_sprite_name(t)}.c" for t in scratch_json["targets"]]
+        + ([atlas_file_name(stem_name)] if atlas else [])
+    )
+
+
+def write_if_changed(file_path: str, content):
+    """Keeps unchanged files untouched, so that the build system doesn't recompile them.
+
+    |content| is either text or bytes.
+    """
+    mode = "b" if isinstance(content, bytes) else ""
+    if os.path.exists(file_path):
+        with open(file_path, "r" + mode) as file:
+            if file.read() == content:
+                return
+    with open(file_path, "w" + mode) as file:
+        file.write(content)
+
+
+# Bump on changes of what unit cache keys cover.
+kUnitCacheFormat = 1
+
+
+def transpiler_digest() -> str:
+    """Digest of the transpiler and its templates, generated code depends on both."""
+    digest = hashlib.sha256()
+    directory = os.path.dirname(os.path.abspath(__file__))
+    templates_directory = os.path.join(directory, "templates")
+    for file_path in [os.path.abspath(__file__)] + [
+        os.path.join(templates_directory, name)
+        for name in sorted(os.listdir(templates_directory))
+    ]:
+        with open(file_path, "rb") as file:
+            digest.update(file.read())
+    return digest.hexdigest()
+
+
+class UnitCache:
+    """Content keys of generated target units, stored next to them in <stem>.cache.json.
+
+    A unit is rendered again only if its key changed or the file is missing.
+    """
+
+    def __init__(self, output_stem: str):
+        self.file_path = f"{output_stem}.cache.json"
+        self.keys = {}
+        try:
+            with open(self.file_path) as file:
+                self.keys = json.load(file)
+        except (OSError, ValueError):
+            # A missing or broken cache only means that every unit is rendered.
+            pass
+
+    def is_fresh(self, file_path: str, key: str) -> bool:
+        name = os.path.basename(file_path)
+        return self.keys.get(name) == key and os.path.exists(file_path)
+
+    def update(self, file_path: str, key: str):
+        self.keys[os.path.basename(file_path)] = key
+
+    def save(self):
+        with open(self.file_path, "w") as file:
+            json.dump(self.keys, file, indent=1, sort_keys=True)
+
+
+def target_unit_cache_key(scratch_target, scratch_stage_target, target, global_inputs) -> str:
+    """Key of everything the unit of |target| is generated from.
+
+    The unit depends on the blocks and variables of the target, names of stage variables and
+    |global_inputs|: the transpiler, its options and results of whole program passes.
+    """
+    digest = hashlib.sha256()
+    digest.update(
+        json.dumps(
+            [
+                global_inputs,
+                target.profile_sites_begin,
+                scratch_target["name"],
+                scratch_target["blocks"],
+                scratch_target["variables"],
+                scratch_target.get("lists", {}),
+                scratch_stage_target["variables"] if scratch_stage_target else {},
+                scratch_stage_target.get("lists", {}) if scratch_stage_target else {},
+            ],
+            sort_keys=True,
+        ).encode("utf-8")
+    )
+    return digest.hexdigest()
+
+
+def compile_scratch_program(
+    scratch_json,
+    output_stem: str,
+    scheduler: str = kSchedulerRecursive,
+    drop_unread_variables: bool = False,
+    profile: bool = False,
+    costume_assets=None,
+):
+    """Generates the public header, the internal header, the runtime unit and a unit per target.
+
+    With |costume_assets|, files of costumes by their names in the *.sb3, costumes are packed into
+    <stem>_atlas.bmp too.
+
+    Units of targets whose inputs didn't change since the previous run are neither rendered nor
+    written, see UnitCache. Other files are written only if their content changed.
+    """
+    stem_name = os.path.basename(output_stem)
+    header_file_name = f"{stem_name}.h"
+    internal_header_file_name = f"{stem_name}_internal.h"
+
+    env = Environment(
+        loader=PackageLoader("scratch-transpiler"),
+        autoescape=select_autoescape(),
+        trim_blocks=True,
+        lstrip_blocks=True,
+    )
+    env.filters["c_string"] = to_c_string_literal
+
+    header_template = env.get_template("scratch-transpiler-main-template.h")
+    write_if_changed(
+        f"{output_stem}.h",
+        header_template.render(
+            profile=profile,
+            atlas_file=atlas_file_name(stem_name) if costume_assets is not None else None,
+        ),
+    )
+
+    targets, blocks, variables, lists, broadcasts = (
+        extract_targets_blocks_and_variables(scratch_json)
+    )
+
+    blocks, summary = optimize_program(blocks, drop_unread_variables)
+    print(summary)
+
+    blocks, clone_scripts = extract_clone_scripts(blocks)
+    clone_script_blocks = [b for c in clone_scripts for b in c.blocks]
+    for target in targets:
+        target.clone_scripts = [c for c in clone_scripts if c.target is target]
+        target.blocks = [b for b in blocks if b.target is target]
+
+    lower_helpers(blocks + clone_script_blocks)
+
+    hat_blocks = [b for b in blocks if b.op_code in kProgramHatOpCodes]
+    collect_program_blocks(blocks, hat_blocks)
+    assign_program_indices(blocks, hat_blocks)
+    for target in targets:
+        target.hat_blocks = [b for b in hat_blocks if b.target is target]
+
+    profile_sites = assign_profile_sites(targets) if profile else []
+
+    atlas = Atlas([], [], 0, 0)
+    if costume_assets is not None:
+        atlas = pack_costumes(scratch_json, targets, costume_assets)
+        write_if_changed(f"{output_stem}_atlas.bmp", atlas_bmp(atlas))
+
+    # Broadcasts nobody receives compile to nothing, without any received the scheduler has nothing to dispatch.
+    dispatched_broadcasts = (
+        broadcasts if any(b.receivers for b in broadcasts) else []
+    )
+
+    internal_header_template = env.get_template(
+        "scratch-transpiler-internal-template.h"
+    )
+    write_if_changed(
+        f"{output_stem}_internal.h",
+        internal_header_template.render(
+            main_header_file=header_file_name,
+            targets=targets,
+            variables=variables,
+            lists=lists,
+            broadcasts=dispatched_broadcasts,
+            hat_blocks=hat_blocks,
+            blocks=blocks,
+            scheduler=scheduler,
+            profile_sites=profile_sites,
+        ),
+    )
+
+    # Every target unit depends on these, besides its own blocks. IDs of broadcasts depend on all the
+    # broadcast names, sending a broadcast depends on receivers in any target.
+    global_inputs = [
+        kUnitCacheFormat,
+        transpiler_digest(),
+        internal_header_file_name,
+        scheduler,
+        profile,
+        [[b.name, bool(b.receivers)] for b in broadcasts],
+    ]
+    if drop_unread_variables:
+        # Writes are dropped depending on reads in all the targets.
+        global_inputs.append(
+            sorted(
+                {
+                    helper.arguments[0]
+                    for block in blocks + clone_script_blocks
+                    for helpers in block.scratch_input_helpers
+                    for helper in helpers
+                    if helper.op_code == "read_variable"
+                }
+            )
+        )
+
+    scratch_targets = {t["name"]: t for t in scratch_json["targets"]}
+    scratch_stage_target = next(
+        (t for t in scratch_json["targets"] if t["isStage"]), None
+    )
+    cache = UnitCache(output_stem)
+    target_template = env.get_template("scratch-transpiler-target-template.c")
+    for target in targets:
+        target_file_path = f"{output_stem}_{target.sprite_name}.c"
+        key = target_unit_cache_key(
+            scratch_targets[target.scratch_name],
+            scratch_stage_target,
+            target,
+            global_inputs,
+        )
+        if cache.is_fresh(target_file_path, key):
+            continue
+
+        string_constants = intern_string_constants(
+            target.blocks + [b for c in target.clone_scripts for b in c.blocks], []
+        )
+        write_if_changed(
+            target_file_path,
+            target_template.render(
+                internal_header_file=internal_header_file_name,
+                target=target,
+                string_constants=string_constants.constants,
+                scheduler=scheduler,
+                profile=profile,
+            ),
+        )
+        cache.update(target_file_path, key)
+
+    string_constants = intern_string_constants([], variables, lists)
+    c_template = env.get_template("scratch-transpiler-main-template.c")
+    write_if_changed(
+        f"{output_stem}.c",
+        c_template.render(
+            internal_header_file=internal_header_file_name,
+            targets=targets,
+            blocks=blocks,
+            variables=variables,
+            lists=lists,
+            broadcasts=dispatched_broadcasts,
+            broadcast_tables=BroadcastTables(dispatched_broadcasts),
+            start_program_words=start_program_words(hat_blocks),
+            atlas=atlas,
+            render_targets=sorted(targets, key=lambda t: t.layer_order),
+            variable_hash=VariablePerfectHash(variables),
+            string_constants=string_constants.constants,
+            hat_blocks=hat_blocks,
+            scheduler=scheduler,
+            profile=profile,
+            profile_sites=profile_sites,
+            state_hash=hex(
+                state_layout_hash(
+                    targets,
+                    variables,
+                    lists,
+                    broadcasts,
+                    blocks,
+                    hat_blocks,
+                    scheduler,
+                )
+            ),
+        ),
+    )
+    cache.save()
 
 
 def main():
     args = parse_arguments()
+    # The transpiler is short-lived and allocates many objects, cyclic garbage collection would only
+    # rescan the loaded project again and again.
+    gc.disable()
     scratch_json = read_scratch_program(args.input)
-    compile_scratch_program(scratch_json, args.output)
+    if args.list_outputs:
+        print("\n".join(output_file_names(scratch_json, args.output, args.atlas)))
+        return
+    compile_scratch_program(
+        scratch_json,
+        args.output,
+        scheduler=args.scheduler,
+        drop_unread_variables=args.drop_unread_variables,
+        profile=args.profile,
+        costume_assets=(
+            read_scratch_costume_assets(args.input, scratch_json) if args.atlas else None
+        ),
+    )
 
 
 if __name__ == "__main__":
@@ -0,0 +1,616 @@
+#!/usr/bin/env python3
+
+import argparse
+import hashlib
+import json
+import struct
+import zipfile
+import zlib
+
+
+def parse_arguments() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Generates synthetic Scratch programs (*.sb3) for benchmarks"
+    )
+
+    parser.add_argument(
+        "--kind",
+        choices=list(kProjectGenerators.keys()),
+        required=True,
+        help="Kind of the generated program.",
+    )
+    parser.add_argument(
+        "--size", type=int, default=1000, help="Size of the generated program."
+    )
+    parser.add_argument("-o", "--output", required=True, help="Output *.sb3 file.")
+
+    return parser.parse_args()
+
+
+def png_file(width, height, rgba):
+    """A minimal RGBA PNG without filtering."""
+
+    def chunk(kind, data):
+        return (
+            struct.pack(">I", len(data))
+            + kind
+            + data
+            + struct.pack(">I", zlib.crc32(kind + data))
+        )
+
+    stride = width * 4
+    rows = b"".join(
+        b"\0" + rgba[y * stride : (y + 1) * stride] for y in range(height)
+    )
+    return (
+        b"\x89PNG\r\n\x1a\n"
+        + chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 6, 0, 0, 0))
+        + chunk(b"IDAT", zlib.compress(rows))
+        + chunk(b"IEND", b"")
+    )
+
+
+def sprite_costume():
+    """A 16x16 arrow pointing right, as a Scratch bitmap of 2 pixels per stage unit. Returns the costume
+    and its file."""
+    kSize = 32
+    rgba = bytearray(kSize * kSize * 4)
+    for y in range(kSize):
+        for x in range(kSize):
+            if abs(y - kSize // 2) <= (kSize - x) // 2:
+                rgba[(y * kSize + x) * 4 : (y * kSize + x + 1) * 4] = bytes(
+                    [0x4C, 0x97, 0xFF, 0xFF]
+                )
+    data = png_file(kSize, kSize, bytes(rgba))
+    md5 = hashlib.md5(data).hexdigest()
+    costume = {
+        "name": "arrow",
+        "assetId": md5,
+        "md5ext": f"{md5}.png",
+        "dataFormat": "png",
+        "bitmapResolution": 2,
+        "rotationCenterX": kSize // 2,
+        "rotationCenterY": kSize // 2,
+    }
+    return costume, data
+
+
+class ProjectBuilder:
+    """Builds project.json with a stage and a single sprite holding all the scripts."""
+
+    def __init__(self):
+        self.blocks = {}
+        self.variables = {}
+        self.lists = {}
+        self.broadcasts = {}
+        self.block_count = 0
+        self.costume, self.costume_file = sprite_costume()
+
+    def add_variable(self, name, value):
+        variable_id = f"variable_{len(self.variables)}"
+        self.variables[variable_id] = [name, value]
+        return [name, variable_id]
+
+    def add_list(self, name, items):
+        list_id = f"list_{len(self.lists)}"
+        self.lists[list_id] = [name, items]
+        return [name, list_id]
+
+    def add_broadcast(self, name):
+        broadcast_id = f"broadcast_{len(self.broadcasts)}"
+        self.broadcasts[broadcast_id] = name
+        return [name, broadcast_id]
+
+    def add_block(self, opcode, inputs=None, fields=None, top_level=False):
+        block_id = f"block_{self.block_count}"
+        self.block_count += 1
+        self.blocks[block_id] = {
+            "opcode": opcode,
+            "next": None,
+            "parent": None,
+            "inputs": inputs or {},
+            "fields": fields or {},
+            "shadow": False,
+            "topLevel": top_level,
+        }
+        return block_id
+
+    def add_script(self, block_ids):
+        """Chains |block_ids| with next/parent links."""
+        for parent_id, block_id in zip(block_ids, block_ids[1:]):
+            self.blocks[parent_id]["next"] = block_id
+            self.blocks[block_id]["parent"] = parent_id
+
+    def to_json(self):
+        return {
+            "targets": [
+                {
+                    "isStage": True,
+                    "name": "Stage",
+                    "variables": self.variables,
+                    "lists": self.lists,
+                    "broadcasts": self.broadcasts,
+                    "blocks": {},
+                },
+                {
+                    "isStage": False,
+                    "name": "Sprite1",
+                    "variables": {},
+                    "lists": {},
+                    "broadcasts": {},
+                    "blocks": self.blocks,
+                    "costumes": [self.costume],
+                    "currentCostume": 0,
+                },
+            ],
+            "meta": {"semver": "3.0.0"},
+        }
+
+
+def number_input(value):
+    return [1, [4, str(value)]]
+
+
+def variable_input(variable):
+    return [3, [12, variable[0], variable[1]], [4, "0"]]
+
+
+def block_input(block_id):
+    return [3, block_id, [4, "0"]]
+
+
+def generate_long_script(builder: ProjectBuilder, size: int):
+    """A single script of |size| `change counter by 1` + `wait 0` pairs, which all run in one tick."""
+    counter = builder.add_variable("Counter", 0)
+
+    script = [builder.add_block("event_whenflagclicked", top_level=True)]
+    for _ in range(size):
+        add = builder.add_block(
+            "operator_add",
+            inputs={"NUM1": variable_input(counter), "NUM2": number_input(1)},
+        )
+        script.append(
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": block_input(add)},
+                fields={"VARIABLE": counter},
+            )
+        )
+        script.append(
+            builder.add_block("control_wait", inputs={"DURATION": number_input(0)})
+        )
+    builder.add_script(script)
+
+
+def generate_sleeping_scripts(builder: ProjectBuilder, size: int):
+    """|size| scripts sleeping in `wait` for a long time, each then changes counter by 1."""
+    counter = builder.add_variable("Counter", 0)
+
+    for i in range(size):
+        add = builder.add_block(
+            "operator_add",
+            inputs={"NUM1": variable_input(counter), "NUM2": number_input(1)},
+        )
+        builder.add_script(
+            [
+                builder.add_block("event_whenflagclicked", top_level=True),
+                builder.add_block(
+                    "control_wait", inputs={"DURATION": number_input(1000 + i)}
+                ),
+                builder.add_block(
+                    "data_setvariableto",
+                    inputs={"VALUE": block_input(add)},
+                    fields={"VARIABLE": counter},
+                ),
+            ]
+        )
+
+
+def generate_clones(builder: ProjectBuilder, size: int):
+    """A single script creating |size| clones of the sprite, then setting counter to |size|.
+
+    Every clone starts with `change x by 10` + `set y to (counter)`, which only moves it, and with
+    `change started by 1` + `change y by 1`.
+    """
+    counter = builder.add_variable("Counter", 0)
+    started = builder.add_variable("Started", 0)
+
+    script = [
+        builder.add_block("event_whenflagclicked", top_level=True),
+        builder.add_block("motion_setx", inputs={"X": number_input(7)}),
+    ]
+    for _ in range(size):
+        menu = builder.add_block(
+            "control_create_clone_of_menu", fields={"CLONE_OPTION": ["_myself_", None]}
+        )
+        builder.blocks[menu]["shadow"] = True
+        script.append(
+            builder.add_block(
+                "control_create_clone_of", inputs={"CLONE_OPTION": [1, menu]}
+            )
+        )
+    script.append(
+        builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": number_input(size)},
+            fields={"VARIABLE": counter},
+        )
+    )
+    builder.add_script(script)
+
+    builder.add_script(
+        [
+            builder.add_block("control_start_as_clone", top_level=True),
+            builder.add_block("motion_changexby", inputs={"DX": number_input(10)}),
+            builder.add_block("motion_sety", inputs={"Y": variable_input(counter)}),
+        ]
+    )
+
+    add = builder.add_block(
+        "operator_add",
+        inputs={"NUM1": variable_input(started), "NUM2": number_input(1)},
+    )
+    builder.add_script(
+        [
+            builder.add_block("control_start_as_clone", top_level=True),
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": block_input(add)},
+                fields={"VARIABLE": started},
+            ),
+            builder.add_block("motion_changeyby", inputs={"DY": number_input(1)}),
+        ]
+    )
+
+
+def string_input(value):
+    return [1, [10, str(value)]]
+
+
+def broadcast_input(broadcast):
+    return [1, [11, broadcast[0], broadcast[1]]]
+
+
+def generate_deep_expressions(builder: ProjectBuilder, size: int):
+    """Scripts setting counter to a chain of |size| alternating `+ 1` and `* 1`, 10 times each.
+
+    Every operation reads the counter, so nothing is folded at compile time.
+    """
+    counter = builder.add_variable("Counter", 0)
+
+    script = [builder.add_block("event_whenflagclicked", top_level=True)]
+    for _ in range(10):
+        expression = variable_input(counter)
+        for i in range(size):
+            opcode = "operator_add" if i % 2 == 0 else "operator_multiply"
+            operation = builder.add_block(
+                opcode, inputs={"NUM1": expression, "NUM2": number_input(1)}
+            )
+            expression = block_input(operation)
+        script.append(
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": expression},
+                fields={"VARIABLE": counter},
+            )
+        )
+    builder.add_script(script)
+
+
+def generate_parallel_scripts(builder: ProjectBuilder, size: int):
+    """|size| scripts changing counter by 1, waiting for two ticks and changing counter by 1 again."""
+    counter = builder.add_variable("Counter", 0)
+
+    for _ in range(size):
+        script = [builder.add_block("event_whenflagclicked", top_level=True)]
+        for j in range(2):
+            if j > 0:
+                script.append(
+                    builder.add_block(
+                        "control_wait", inputs={"DURATION": number_input(0.05)}
+                    )
+                )
+            add = builder.add_block(
+                "operator_add",
+                inputs={"NUM1": variable_input(counter), "NUM2": number_input(1)},
+            )
+            script.append(
+                builder.add_block(
+                    "data_setvariableto",
+                    inputs={"VALUE": block_input(add)},
+                    fields={"VARIABLE": counter},
+                )
+            )
+        builder.add_script(script)
+
+
+def generate_string_joins(builder: ProjectBuilder, size: int):
+    """A single script of |size| `set text to (join ... (join (word) "-") ... (word))` chains of 16 joins.
+
+    Results are too long for inline strings, so every join allocates.
+    """
+    counter = builder.add_variable("Counter", 0)
+    word = builder.add_variable("Word", "banana")
+    text = builder.add_variable("Text", "")
+
+    # The transpiler only declares variables some block sets.
+    script = [
+        builder.add_block("event_whenflagclicked", top_level=True),
+        builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": string_input("banana")},
+            fields={"VARIABLE": word},
+        ),
+    ]
+    for _ in range(size):
+        expression = variable_input(word)
+        for i in range(16):
+            operand = variable_input(word) if i % 2 else string_input("-")
+            join = builder.add_block(
+                "operator_join", inputs={"STRING1": expression, "STRING2": operand}
+            )
+            expression = block_input(join)
+        script.append(
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": expression},
+                fields={"VARIABLE": text},
+            )
+        )
+    script.append(
+        builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": number_input(size)},
+            fields={"VARIABLE": counter},
+        )
+    )
+    builder.add_script(script)
+
+
+# Quotients between 1e-7 and 1e-4, around where JavaScript switches from fixed notation to the exponent form.
+kNumberTextFractions = [
+    (1, 10**7),
+    (15, 10**8),
+    (1, 10**6),
+    (12, 10**6),
+    (1, 10**5),
+    (123, 10**7),
+    (99, 10**6),
+    (1, 10**4),
+]
+
+
+def generate_number_texts(builder: ProjectBuilder, size: int):
+    """A single script printing the first |size| quotients of kNumberTextFractions twice.
+
+    Folded<i> is set to `join "a" ((a) / (b))`, which the transpiler folds into a string. Joined<i> is set to
+    `join "a" (Quotient<i>)` of a variable set to the same quotient, which the runtime converts.
+    """
+    script = [builder.add_block("event_whenflagclicked", top_level=True)]
+    for i in range(size):
+        numerator, denominator = kNumberTextFractions[i % len(kNumberTextFractions)]
+        quotient = builder.add_variable(f"Quotient{i}", 0)
+        folded = builder.add_variable(f"Folded{i}", "")
+        joined = builder.add_variable(f"Joined{i}", "")
+
+        def divide():
+            return block_input(
+                builder.add_block(
+                    "operator_divide",
+                    inputs={
+                        "NUM1": number_input(numerator),
+                        "NUM2": number_input(denominator),
+                    },
+                )
+            )
+
+        folded_join = builder.add_block(
+            "operator_join",
+            inputs={"STRING1": string_input("a"), "STRING2": divide()},
+        )
+        joined_join = builder.add_block(
+            "operator_join",
+            inputs={"STRING1": string_input("a"), "STRING2": variable_input(quotient)},
+        )
+        script += [
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": divide()},
+                fields={"VARIABLE": quotient},
+            ),
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": block_input(folded_join)},
+                fields={"VARIABLE": folded},
+            ),
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": block_input(joined_join)},
+                fields={"VARIABLE": joined},
+            ),
+        ]
+    builder.add_script(script)
+
+
+def generate_lists(builder: ProjectBuilder, size: int):
+    """A single script adding |size| numbers and a word to a list holding 1 and "two", then looking up every
+    number, replacing the first item with the length of the list and deleting the last one.
+
+    Counter ends as the sum of the indices of the numbers, Found as the index of the word found in another case
+    and Last as the word.
+    """
+    counter = builder.add_variable("Counter", 0)
+    found = builder.add_variable("Found", 0)
+    last = builder.add_variable("Last", "")
+    items = builder.add_list("Items", ["1", "two"])
+
+    script = [builder.add_block("event_whenflagclicked", top_level=True)]
+    for i in range(size):
+        script.append(
+            builder.add_block(
+                "data_addtolist",
+                inputs={"ITEM": string_input(i)},
+                fields={"LIST": items},
+            )
+        )
+    script.append(
+        builder.add_block(
+            "data_addtolist",
+            inputs={"ITEM": string_input("Apple")},
+            fields={"LIST": items},
+        )
+    )
+    for i in range(size):
+        item_number = builder.add_block(
+            "data_itemnumoflist",
+            inputs={"ITEM": string_input(i)},
+            fields={"LIST": items},
+        )
+        add = builder.add_block(
+            "operator_add",
+            inputs={"NUM1": variable_input(counter), "NUM2": block_input(item_number)},
+        )
+        script.append(
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": block_input(add)},
+                fields={"VARIABLE": counter},
+            )
+        )
+    item_number = builder.add_block(
+        "data_itemnumoflist",
+        inputs={"ITEM": string_input("APPLE")},
+        fields={"LIST": items},
+    )
+    length = builder.add_block("data_lengthoflist", fields={"LIST": items})
+    item = builder.add_block(
+        "data_itemoflist",
+        inputs={"INDEX": [1, [7, "last"]]},
+        fields={"LIST": items},
+    )
+    script += [
+        builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": block_input(item_number)},
+            fields={"VARIABLE": found},
+        ),
+        builder.add_block(
+            "data_replaceitemoflist",
+            inputs={"INDEX": number_input(1), "ITEM": block_input(length)},
+            fields={"LIST": items},
+        ),
+        builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": block_input(item)},
+            fields={"VARIABLE": last},
+        ),
+        builder.add_block(
+            "data_deleteoflist",
+            inputs={"INDEX": [1, [7, "last"]]},
+            fields={"LIST": items},
+        ),
+    ]
+    builder.add_script(script)
+
+
+def generate_broadcasts(builder: ProjectBuilder, size: int):
+    """|size| scripts receiving "tick" and changing counter by 1, restarted by a script broadcasting "tick" and
+    itself every tick.
+
+    The flag script waits for the first "tick" and sets waited to counter, then starts "loop". Every "loop"
+    changes loops by 1 and restarts a script sleeping in `wait 1` before changing naps by 1, so naps stays 0.
+    """
+    counter = builder.add_variable("Counter", 0)
+    waited = builder.add_variable("Waited", 0)
+    loops = builder.add_variable("Loops", 0)
+    naps = builder.add_variable("Naps", 0)
+    tick = builder.add_broadcast("tick")
+    loop = builder.add_broadcast("loop")
+    nap = builder.add_broadcast("nap")
+
+    def change_by_1(variable):
+        add = builder.add_block(
+            "operator_add",
+            inputs={"NUM1": variable_input(variable), "NUM2": number_input(1)},
+        )
+        return builder.add_block(
+            "data_setvariableto",
+            inputs={"VALUE": block_input(add)},
+            fields={"VARIABLE": variable},
+        )
+
+    def when_received(broadcast):
+        return builder.add_block(
+            "event_whenbroadcastreceived",
+            fields={"BROADCAST_OPTION": broadcast},
+            top_level=True,
+        )
+
+    builder.add_script(
+        [
+            builder.add_block("event_whenflagclicked", top_level=True),
+            builder.add_block(
+                "event_broadcastandwait", inputs={"BROADCAST_INPUT": broadcast_input(tick)}
+            ),
+            builder.add_block(
+                "data_setvariableto",
+                inputs={"VALUE": variable_input(counter)},
+                fields={"VARIABLE": waited},
+            ),
+            builder.add_block(
+                "event_broadcast", inputs={"BROADCAST_INPUT": broadcast_input(loop)}
+            ),
+        ]
+    )
+    builder.add_script(
+        [
+            when_received(loop),
+            builder.add_block(
+                "event_broadcast", inputs={"BROADCAST_INPUT": broadcast_input(tick)}
+            ),
+            builder.add_block(
+                "event_broadcast", inputs={"BROADCAST_INPUT": broadcast_input(nap)}
+            ),
+            change_by_1(loops),
+            builder.add_block(
+                "event_broadcast", inputs={"BROADCAST_INPUT": broadcast_input(loop)}
+            ),
+        ]
+    )
+    builder.add_script(
+        [
+            when_received(nap),
+            builder.add_block("control_wait", inputs={"DURATION": number_input(1)}),
+            change_by_1(naps),
+        ]
+    )
+    for _ in range(size):
+        builder.add_script([when_received(tick), change_by_1(counter)])
+
+
+kProjectGenerators = {
+    "long-script": generate_long_script,
+    "sleeping-scripts": generate_sleeping_scripts,
+    "clones": generate_clones,
+    "deep-expressions": generate_deep_expressions,
+    "parallel-scripts": generate_parallel_scripts,
+    "string-joins": generate_string_joins,
+    "lists": generate_lists,
+    "broadcasts": generate_broadcasts,
+    "number-texts": generate_number_texts,
+}
+
+
+def main():
+    args = parse_arguments()
+
+    builder = ProjectBuilder()
+    kProjectGenerators[args.kind](builder, args.size)
+
+    with zipfile.ZipFile(args.output, "w", zipfile.ZIP_DEFLATED) as file:
+        file.writestr("project.json", json.dumps(builder.to_json()))
+        file.writestr(builder.costume["md5ext"], builder.costume_file)
+
+
+if __name__ == "__main__":
+    main()
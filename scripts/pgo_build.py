@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+
+def parse_arguments() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Builds a generated program with profile-guided optimization and reports the speedup"
+    )
+
+    parser.add_argument("--source-dir", required=True, help="Root of the repository.")
+    parser.add_argument(
+        "--build-dir",
+        required=True,
+        help="Build directory of the PGO builds, configured by this script.",
+    )
+    parser.add_argument(
+        "--target", required=True, help="Batch runner executable of the program."
+    )
+    parser.add_argument(
+        "--compiler-id", default="gcc", help="Meson id of the C compiler, gcc or clang."
+    )
+    parser.add_argument(
+        "--instances", type=int, default=1000, help="Instances advanced by the runs."
+    )
+    parser.add_argument(
+        "--ticks", type=int, default=300, help="Ticks every instance is advanced by."
+    )
+    parser.add_argument(
+        "--repetitions",
+        type=int,
+        default=5,
+        help="The best of this many runs of the baseline and the optimized build is reported.",
+    )
+    parser.add_argument(
+        "meson_options",
+        nargs="*",
+        help="Options of the builds, e.g. -Dscheduler=threaded.",
+    )
+
+    return parser.parse_args()
+
+
+def configure(args: argparse.Namespace, pgo: str):
+    # Profiles make GCC warn about functions which never ran, they are not errors here.
+    options = [
+        "-Dbuildtype=release",
+        "-Dfrontend=[]",
+        "-Dwerror=false",
+        "-Db_pgo=" + pgo,
+    ] + args.meson_options
+    if os.path.exists(os.path.join(args.build_dir, "build.ninja")):
+        command = ["meson", "setup", "--reconfigure"]
+    else:
+        command = ["meson", "setup"]
+    subprocess.check_call(command + options + [args.build_dir, args.source_dir])
+    subprocess.check_call(["meson", "compile", "-C", args.build_dir, args.target])
+
+
+def run(args: argparse.Namespace, executable: str, env=None) -> float:
+    # A single thread keeps the profile and the measurement free of scheduling noise.
+    output = subprocess.check_output(
+        [
+            executable,
+            str(args.instances),
+            str(args.ticks),
+            "1",
+        ],
+        env=env,
+        text=True,
+    )
+    match = re.search(r"^ticks/s: (\S+)$", output, re.MULTILINE)
+    if not match:
+        raise RuntimeError("No ticks/s in the output of " + args.target + ":\n" + output)
+    return float(match.group(1))
+
+
+def measure(args: argparse.Namespace, baseline: str, optimized: str):
+    # Runs alternate, so a slowdown of the machine affects both binaries alike.
+    baseline_runs = []
+    optimized_runs = []
+    for _ in range(args.repetitions):
+        baseline_runs.append(run(args, baseline))
+        optimized_runs.append(run(args, optimized))
+    return max(baseline_runs), max(optimized_runs)
+
+
+def remove_profiles(build_dir: str):
+    for pattern in ["**/*.gcda", "*.profraw", "default.profdata"]:
+        for path in glob.glob(os.path.join(build_dir, pattern), recursive=True):
+            os.remove(path)
+
+
+def collect_profile(args: argparse.Namespace):
+    remove_profiles(args.build_dir)
+    env = dict(os.environ)
+    if args.compiler_id == "clang":
+        env["LLVM_PROFILE_FILE"] = os.path.join(args.build_dir, "pgo-%p.profraw")
+    run(args, os.path.join(args.build_dir, args.target), env)
+
+    # GCC writes .gcda files next to the objects. Clang needs its raw profiles merged into default.profdata,
+    # which is where -fprofile-use looks for them.
+    if args.compiler_id == "clang":
+        profdata = shutil.which("llvm-profdata")
+        if not profdata:
+            raise RuntimeError("llvm-profdata is required for Clang PGO")
+        subprocess.check_call(
+            [profdata, "merge", "-output=" + os.path.join(args.build_dir, "default.profdata")]
+            + glob.glob(os.path.join(args.build_dir, "*.profraw"))
+        )
+
+
+def main():
+    args = parse_arguments()
+    os.makedirs(args.build_dir, exist_ok=True)
+
+    executable = os.path.join(args.build_dir, args.target)
+    baseline_executable = executable + "-baseline"
+
+    print("==> baseline", flush=True)
+    configure(args, "off")
+    shutil.copy2(executable, baseline_executable)
+
+    print("==> instrumented", flush=True)
+    configure(args, "generate")
+    collect_profile(args)
+
+    print("==> optimized", flush=True)
+    configure(args, "use")
+
+    baseline, optimized = measure(args, baseline_executable, executable)
+    print(f"baseline ticks/s: {baseline:.6g}")
+    print(f"optimized ticks/s: {optimized:.6g}")
+    print(f"speedup: {optimized / baseline:.3f}x")
+    print("optimized binary: " + executable)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
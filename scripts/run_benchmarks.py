@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+import argparse
+import subprocess
+import sys
+
+
+def parse_arguments() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Runs Google Benchmark executables one after another"
+    )
+
+    parser.add_argument(
+        "--benchmark-args",
+        default="",
+        help="Space separated arguments passed to every executable, e.g. --benchmark_filter=BM_Tick.",
+    )
+    parser.add_argument("executables", nargs="+", help="Benchmark executables.")
+
+    return parser.parse_args()
+
+
+def main():
+    args = parse_arguments()
+
+    failed = []
+    for executable in args.executables:
+        print(f"==> {executable}", flush=True)
+        if subprocess.call([executable] + args.benchmark_args.split()) != 0:
+            failed.append(executable)
+
+    for executable in failed:
+        print(f"FAILED: {executable}", file=sys.stderr)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,196 @@
+// Declarations shared by the translation units of the program: the runtime, the layout of ScratchContext
+// and the functions units call in each other. The public API is in {{ main_header_file }}.
+// Only headers of the runtime are here, its functions are linked from scratch_vm_lib.
+#pragma once
+
+// All includes should be below these defines
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE
+
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+{% include 'scratch-vm-types.h' with context %}
+
+{% include 'scratch-vm-arena.h' with context %}
+
+{% include 'scratch-vm-variables-public.h' with context %}
+
+{% include 'scratch-vm-variables-internal.h' with context %}
+
+{% include 'scratch-vm-timers.h' with context %}
+
+{% include 'scratch-vm-clones.h' with context %}
+
+{% include 'scratch-vm-lists.h' with context %}
+
+{% include 'scratch-vm-columns.h' with context %}
+
+{% include 'scratch-vm-state.h' with context %}
+
+{% include 'scratch-vm-profile.h' with context %}
+
+{% include 'scratch-vm-render.h' with context %}
+
+{% include 'scratch-vm-blocks.h' with context %}
+
+{# Fields of ScratchSprite, target structs start with them. #}
+{% set sprite_base %}
+  ScratchNumber x;
+  ScratchNumber y;
+  ScratchNumber direction_x;
+  ScratchNumber direction_y;
+{%- endset %}
+
+// Reads a boxed expression result consumed as a number.
+static inline ScratchNumber Scratch_ToNumber(ScratchVariable variable) {
+  return Scratch_ReadNumberVariable(&variable);
+}
+
+// =====
+// Targets
+// =====
+{% for target in targets %}
+typedef struct {{ target.c_struct_name }} {
+{{ sprite_base }}
+  ScratchClonePool clones;
+} {{ target.c_struct_name }};
+{% endfor %}
+
+// =====
+// Programs: "when flag clicked" and "when I receive" scripts
+// =====
+{% for block in hat_blocks %}
+{% if scheduler == "threaded" %}
+typedef struct {
+  // Index of the block to run next in |program_blocks|, equals to their count when finished.
+  int pc;
+} {{ block.block_name }}_program_t;
+{% else %}
+typedef struct {
+  int is_running;
+  const ScratchBlock* stack[{{ block.max_level + 1 }}];
+  int cur_stack_index;
+  int is_in_sub_stack;
+} {{ block.block_name }}_program_t;
+{% endif %}
+{% endfor %}
+
+// =====
+// Context
+// =====
+// All the state of a single instance of the program.
+struct ScratchContext {
+  ScratchClock clock;
+
+  // Expression temporaries never own memory: their strings are inline, interned, borrowed from a variable
+  // or allocated from this arena, which is reset at the end of every Scratch_Advance.
+  // Only set_variable copies a value to long-lived storage.
+  ScratchArena temporary_arena;
+
+  // Targets
+{% for target in targets %}
+  {{ target.c_struct_name }} {{ target.variable_name }};
+{% endfor %}
+
+  // Variables
+{% for variable in variables %}
+  ScratchVariable {{ variable.variable_name }};
+{% endfor %}
+
+  // Lists
+{% for list in lists %}
+  ScratchList {{ list.list_name }};
+{% endfor %}
+
+  // Programs
+{% for block in hat_blocks %}
+  {{ block.block_name }}_program_t {{ block.block_name }}_program;
+{% endfor %}
+{% if hat_blocks %}
+  // Programs advanced on the next tick, sleeping, waiting and finished programs are not there.
+  uint64_t runnable_programs[SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }})];
+  // Min-heap of wake up times of sleeping programs.
+  ScratchTimer sleeping_programs[{{ hat_blocks | length }}];
+  int sleeping_programs_count;
+{% endif %}
+{% if broadcasts %}
+  // Receivers started by a broadcast and not finished yet.
+  uint64_t active_programs[SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }})];
+  // Programs started over from their hat block when they are advanced next.
+  uint64_t restarted_programs[SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }})];
+  // Broadcast every waiting program waits for, -1 for the rest.
+  int awaited_broadcasts[{{ hat_blocks | length }}];
+  // Active receivers of every broadcast.
+  int active_receivers[{{ broadcasts | length }}];
+  // Set by a block returning kScratchBlockFunctionResultWaitForBroadcast.
+  int awaited_broadcast;
+{% endif %}
+
+  // Blocks runtime
+{% for block in blocks %}
+{% if block.op_code == "kScratchControlWait" %}
+  // TODO(truvorskameikin): Move runtime block to target and clone.
+  ScratchControlWaitRuntime {{ block.block_name }}_runtime;
+{% elif block.op_code == "kScratchBroadcastAndWait" %}
+  ScratchBroadcastAndWaitRuntime {{ block.block_name }}_runtime;
+{% endif %}
+{% endfor %}
+{% if profile_sites %}
+
+  // Indexed like kScratchProfileSites.
+  ScratchProfileCounter profile[{{ profile_sites | length }}];
+{% endif %}
+};
+
+// =====
+// Scratch state and functions
+// =====
+static inline ScratchNumber Scratch_sensing_timer(ScratchContext* ctx, struct ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  return ctx->clock.current_time;
+}
+
+{% if broadcasts %}
+// =====
+// Broadcasts, dispatched by the scheduler
+// =====
+// Broadcasts are sent by their IDs, resolved by the transpiler.
+// Restarts receivers of the broadcast, which run in this tick if they come after the current program.
+void Scratch_StartBroadcast(ScratchContext* ctx, int broadcast);
+// Starts the broadcast and waits until its receivers finish.
+ScratchBlockFunctionResult Scratch_AdvanceBroadcastAndWait(
+    ScratchContext* ctx, int broadcast, ScratchBroadcastAndWaitRuntime* runtime);
+
+{% endif %}
+// =====
+// Defined in the units of targets
+// =====
+{% for target in targets %}
+// {{ target.sprite_name }}
+{% if scheduler != "threaded" and target.blocks %}
+// Blocks by ScratchBlock::index, stacks of programs are saved as indices.
+extern const ScratchBlock* const {{ target.variable_name }}_blocks[{{ target.blocks | length }}];
+{% endif %}
+{% for block in target.hat_blocks %}
+{% if scheduler != "threaded" %}
+extern const ScratchBlock {{ block.block_name }};
+{% endif %}
+ScratchProgramState Scratch_Advance_{{ block.block_name }}_program(ScratchContext* ctx, ScratchNumber dt);
+{% endfor %}
+{% for script in target.clone_scripts %}
+// Runs the script for clones [begin, end) of {{ target.sprite_name }}.
+void {{ script.name }}_clones_function(
+    ScratchContext* ctx, ScratchClonePool* clones, int begin, int end, ScratchNumber dt);
+{% endfor %}
+
+{% endfor %}
+// Need two new lines in the end.
+
@@ -1,389 +1,779 @@
-// All includes should be below these defines
-#define _POSIX_C_SOURCE 200809L
-#define _XOPEN_SOURCE
-
-#include <math.h>
-#include <stdlib.h>
-#include <string.h>
-
-{% include 'scratch-vm-types.h' with context %}
-
-{% include 'scratch-vm-variables-public.h' with context %}
-
-{% include 'scratch-vm-variables.c' with context %}
-
-{% set sprite_base %}
-  ScratchNumber x;
-  ScratchNumber y;
-  ScratchNumber direction_x;
-  ScratchNumber direction_y;
-{%- endset %}
-
-typedef struct ScratchSprite {
-{{ sprite_base }}
-} ScratchSprite;
-
-typedef enum ScratchOpCode {
-kScratchWhenFlagClicked = 1,
-kScratchInPlace = 2,
-kScratchControlForever = 3,
-kScratchControlIf = 4,
-kScratchControlWait = 5,
-} ScratchOpCode;
-
-typedef enum ScratchBlockFunctionResult {
-kScratchBlockFunctionResultContinue = 1,
-kScratchBlockFunctionResultWait = 2,
-} ScratchBlockFunctionResult;
-
-typedef void (*ImplaceBlockFunction)(ScratchNumber dt);
-typedef ScratchBlockFunctionResult (*BlockFunction)(ScratchNumber dt);
-typedef ScratchVariable (*ExpressionFunction)(ScratchSprite* sprite, ScratchNumber dt);
-
-typedef struct ScratchBlock {
-  struct ScratchBlock* next;
-  struct ScratchBlock* substack;
-  ScratchOpCode op_code;
-  union {
-    ImplaceBlockFunction inplace_function;
-    BlockFunction block_function;
-  };
-} ScratchBlock;
-
-typedef struct ScratchControlWaitRuntime {
-  int is_running;
-  ScratchNumber currentWaitTime;
-  ScratchNumber timeout;
-} ScratchControlWaitRuntime;
-
-ScratchBlockFunctionResult Scratch_AdvanceControlWaitRuntime(
-    ScratchNumber dt,
-    ScratchSprite* sprite,
-    ExpressionFunction duration_expression,
-    ScratchControlWaitRuntime* runtime) {
-  
-  if (!runtime->is_running) {
-    ScratchVariable duration = duration_expression(sprite, dt);
-    runtime->timeout = Scratch_ReadNumberVariable(&duration);
-    Scratch_FreeVariable(&duration);
+// Functions of the public API, scripts of every target are in units of their own.
+// The runtime is not here, programs are linked with scratch_vm_lib.
+#include "{{ internal_header_file }}"
 
-    runtime->is_running = 1;
-  }
+// =====
+// Interned strings
+// =====
+{% for name, literal in string_constants %}
+static const char {{ name }}[] = {{ literal }};
+{% endfor %}
 
-  runtime->currentWaitTime += dt;
-  if (runtime->currentWaitTime > runtime->timeout) {
-    runtime->currentWaitTime = runtime->timeout;
-  }
-  if (runtime->currentWaitTime == runtime->timeout) {
-    runtime->is_running = 0;
-    return kScratchBlockFunctionResultContinue;
-  }
-  return kScratchBlockFunctionResultWait;
+{% if hat_blocks %}
+// Indexed by program indices in ScratchContext::runnable_programs and ScratchTimer::program.
+static const ProgramFunction kScratchPrograms[{{ hat_blocks | length }}] = {
+{% for block in hat_blocks %}
+  Scratch_Advance_{{ block.block_name }}_program,
+{% endfor %}
+};
+{% endif %}
+
+{% if broadcasts %}
+// Puts the program back to its hat block and stops the waits it's in.
+{% for block in hat_blocks %}
+static void Scratch_Reset_{{ block.block_name }}_program(ScratchContext* ctx) {
+{% if scheduler == "threaded" %}
+  ctx->{{ block.block_name }}_program.pc = 0;
+{% else %}
+  ctx->{{ block.block_name }}_program.is_running = 0;
+  ctx->{{ block.block_name }}_program.stack[0] = &{{ block.block_name }};
+  ctx->{{ block.block_name }}_program.cur_stack_index = 0;
+  ctx->{{ block.block_name }}_program.is_in_sub_stack = 0;
+{% endif %}
+{% for runtime_block in block.runtime_blocks %}
+  ctx->{{ runtime_block.block_name }}_runtime.is_running = 0;
+{% endfor %}
 }
+{% endfor %}
 
-void Scratch_AdvanceSingleProgram(ScratchNumber dt, ScratchBlock* stack[], int* cur_stack_index, int is_in_sub_stack) {
-  if (*cur_stack_index < 0) {
-    return;
-  }
+typedef void (*ProgramResetFunction)(ScratchContext* ctx);
 
-  if (stack[*cur_stack_index] == 0) {
-    if (is_in_sub_stack) {
-      return;
-    }
+// Indexed like kScratchPrograms.
+static const ProgramResetFunction kScratchProgramResets[{{ hat_blocks | length }}] = {
+{% for block in hat_blocks %}
+  Scratch_Reset_{{ block.block_name }}_program,
+{% endfor %}
+};
+// Broadcast received by every program, -1 for "when flag clicked" ones.
+static const int kScratchProgramBroadcasts[{{ hat_blocks | length }}] = {
+{% for block in hat_blocks %}
+  {{ block.broadcast.id if block.broadcast else -1 }},
+{% endfor %}
+};
 
-    --(*cur_stack_index);
-  }
+{% macro int_table(name, values) %}
+static const int {{ name }}[{{ values | length }}] = {
+{% for value in values %}
+  {{ value }},
+{% endfor %}
+};
+{% endmacro %}
+// Dispatch tables of broadcasts by ID: programs receiving broadcast b are
+// kScratchBroadcastReceivers[kScratchBroadcastReceiversBegin[b] .. kScratchBroadcastReceiversBegin[b + 1]),
+// programs with `broadcast (b) and wait` are in kScratchBroadcastWaiters the same way.
+{{ int_table("kScratchBroadcastReceiversBegin", broadcast_tables.receivers_begin) }}
+{{ int_table("kScratchBroadcastReceivers", broadcast_tables.receivers) }}
+{{ int_table("kScratchBroadcastWaitersBegin", broadcast_tables.waiters_begin) }}
+{{ int_table("kScratchBroadcastWaiters", broadcast_tables.waiters) | trim }}
+{% endif %}
 
-  if (*cur_stack_index < 0) {
-    return;
-  }
+{% for list in lists if list.items %}
+// Initial items of {{ list.list_name }}: strings where there is one, numbers elsewhere.
+static const char* const {{ list.list_name }}_strings[{{ list.items | length }}] = {
+{% for item in list.items %}
+  {{ item.string_constant if item.is_string else 0 }},
+{% endfor %}
+};
+static const ScratchNumber {{ list.list_name }}_numbers[{{ list.items | length }}] = {
+{% for item in list.items %}
+  {{ 0 if item.is_string else item.value }},
+{% endfor %}
+};
+{% endfor %}
 
-  ScratchBlock* cur_block = stack[*cur_stack_index];
-  if (cur_block->op_code == kScratchInPlace) {
-    cur_block->inplace_function(dt);
-  } else {
-    ScratchBlockFunctionResult result = cur_block->block_function(dt);
-    if (result == kScratchBlockFunctionResultWait) {
-      return;
+// =====
+// Init
+// =====
+size_t Scratch_GetContextSize(void) {
+  return sizeof(ScratchContext);
+}
+
+// Everything Scratch_Init sets but list items, in read-only data: variables have their initial values and
+// programs are at their hat blocks. Zero initialized clocks, arenas, clone pools and lists are valid empty ones.
+static const ScratchContext kScratchInitialContext = {
+  .clock = { 0 },
+
+  // Targets
+{% for target in targets %}
+  .{{ target.variable_name }} = {
+    .x = {{ target.x }},
+    .y = {{ target.y }},
+    .direction_x = {{ target.direction_x }},
+    .direction_y = {{ target.direction_y }},
+  },
+{% endfor %}
+
+  // Variables
+{% for variable in variables %}
+{% if variable.is_string %}
+  .{{ variable.variable_name }} = SCRATCH_VM_CONST_STRING_VARIABLE_INIT({{ variable.string_constant }}),
+{% else %}
+  .{{ variable.variable_name }} = SCRATCH_VM_NUMBER_VARIABLE_INIT({{ variable.value }}),
+{% endif %}
+{% endfor %}
+
+  // Lists
+{% for list in lists if list.is_indexed %}
+  .{{ list.list_name }} = { .index = { .is_enabled = 1 } },
+{% endfor %}
+
+  // Programs
+{% if scheduler != "threaded" %}
+{% for block in hat_blocks %}
+  .{{ block.block_name }}_program = { .stack = { &{{ block.block_name }} } },
+{% endfor %}
+{% endif %}
+{% if hat_blocks %}
+  // "When flag clicked" programs.
+  .runnable_programs = {
+{% for word in start_program_words %}
+    {{ word }},
+{% endfor %}
+  },
+{% endif %}
+{% if broadcasts %}
+  .awaited_broadcasts = {
+{% for block in hat_blocks %}
+    -1,
+{% endfor %}
+  },
+  .awaited_broadcast = -1,
+{% endif %}
+};
+
+{% if lists | selectattr("items") | list %}
+static void Scratch_AddInitialListItems(
+    ScratchList* list, const char* const* strings, const ScratchNumber* numbers, int count) {
+  for (int i = 0; i < count; ++i) {
+    if (strings[i]) {
+      ScratchVariable item;
+      Scratch_InitStringVariable(&item, strings[i], /*is_const_str_value=*/ 1);
+      Scratch_AddToList(list, &item);
+    } else {
+      Scratch_AddNumberToList(list, numbers[i]);
     }
   }
+}
 
-  stack[*cur_stack_index] = stack[*cur_stack_index]->next;
-  Scratch_AdvanceSingleProgram(dt, stack, cur_stack_index, is_in_sub_stack);
+{% endif %}
+
+void Scratch_Init(ScratchContext* ctx) {
+  memcpy(ctx, &kScratchInitialContext, sizeof(ScratchContext));
+{% for list in lists if list.items %}
+  Scratch_AddInitialListItems(
+      &ctx->{{ list.list_name }}, {{ list.list_name }}_strings, {{ list.list_name }}_numbers, {{ list.items | length }});
+{% endfor %}
 }
 
-// =====
-// Targets
-// =====
+void Scratch_Free(ScratchContext* ctx) {
 {% for target in targets %}
-typedef struct {{ target.clone_c_struct_name }} {
-{{ sprite_base }}
-  struct {{ target.clone_c_struct_name }}* next;
-} {{ target.clone_c_struct_name }};
-typedef struct {{ target.c_struct_name }} {
-{{ sprite_base }}
-  {{ target.clone_c_struct_name }}* clones;
-} {{ target.c_struct_name }};
-{{ target.c_struct_name }} {{ target.variable_name }};
+  Scratch_FreeClonePool(&ctx->{{ target.variable_name }}.clones);
+{% endfor %}
+{% for variable in variables %}
+  Scratch_FreeVariable(&ctx->{{ variable.variable_name }});
+{% endfor %}
+{% for list in lists %}
+  Scratch_FreeList(&ctx->{{ list.list_name }});
 {% endfor %}
+  Scratch_FreeArena(&ctx->temporary_arena);
+}
+
+ScratchContext* Scratch_NewContext(void) {
+  ScratchContext* ctx = malloc(sizeof(ScratchContext));
+  Scratch_Init(ctx);
+  return ctx;
+}
+
+void Scratch_DeleteContext(ScratchContext* ctx) {
+  Scratch_Free(ctx);
+  free(ctx);
+}
 
 // =====
-// Variables
+// State
 // =====
+// Hash of everything the layout of the saved state depends on: targets, variables, scripts and the scheduler.
+#define SCRATCH_PROGRAM_STATE_HASH {{ state_hash }}ull
+
+static void Scratch_WriteState(ScratchContext* ctx, ScratchStateWriter* writer) {
+  Scratch_WriteStateNumber(writer, ctx->clock.tick_start_time);
+  Scratch_WriteStateNumber(writer, ctx->clock.current_time);
+  Scratch_WriteStateNumber(writer, ctx->clock.wake_up_time);
+
+  // Variables
 {% for variable in variables %}
-static ScratchVariable {{ variable.variable_name }};
+  Scratch_WriteStateVariable(writer, &ctx->{{ variable.variable_name }});
 {% endfor %}
 
-// =====
-// Blocks
-// =====
+  // Lists
+{% for list in lists %}
+  Scratch_WriteStateList(writer, &ctx->{{ list.list_name }});
+{% endfor %}
+
+  // Targets
+{% for target in targets %}
+  Scratch_WriteStateNumber(writer, ctx->{{ target.variable_name }}.x);
+  Scratch_WriteStateNumber(writer, ctx->{{ target.variable_name }}.y);
+  Scratch_WriteStateNumber(writer, ctx->{{ target.variable_name }}.direction_x);
+  Scratch_WriteStateNumber(writer, ctx->{{ target.variable_name }}.direction_y);
+  Scratch_WriteStateClonePool(writer, &ctx->{{ target.variable_name }}.clones);
+  Scratch_WriteStateInt(writer, ctx->{{ target.variable_name }}.clones.started_count);
+{% endfor %}
+
+  // Blocks runtime
 {% for block in blocks %}
-static ScratchBlock {{ block.block_name }};
+{% if block.op_code == "kScratchControlWait" %}
+  Scratch_WriteStateInt(writer, ctx->{{ block.block_name }}_runtime.is_running);
+  Scratch_WriteStateNumber(writer, ctx->{{ block.block_name }}_runtime.deadline);
+{% elif block.op_code == "kScratchBroadcastAndWait" %}
+  Scratch_WriteStateInt(writer, ctx->{{ block.block_name }}_runtime.is_running);
+{% endif %}
 {% endfor %}
 
-// =====
-// kScratchWhenFlagClicked programs
-// =====
-{% for block in when_flag_clicked_blocks %}
-typedef struct {
-  int is_running;
-  ScratchBlock* stack[{{ block.max_level + 1 }}];
-  int cur_stack_index;
-  int is_in_sub_stack;
-} {{ block.block_name }}_program_t;
-{{ block.block_name }}_program_t {{ block.block_name }}_program;
-void Scratch_Advance_{{ block.block_name }}_program(ScratchNumber dt) {
-  Scratch_AdvanceSingleProgram(dt, {{ block.block_name }}_program.stack, &{{ block.block_name }}_program.cur_stack_index, {{ block.block_name }}_program.is_in_sub_stack);
+  // Programs
+{% for block in hat_blocks %}
+{% if scheduler == "threaded" %}
+  Scratch_WriteStateInt(writer, ctx->{{ block.block_name }}_program.pc);
+{% else %}
+  {
+    {{ block.block_name }}_program_t* program = &ctx->{{ block.block_name }}_program;
+    Scratch_WriteStateInt(writer, program->is_running);
+    Scratch_WriteStateInt(writer, program->is_in_sub_stack);
+    Scratch_WriteStateInt(writer, program->cur_stack_index);
+    for (int i = 0; i <= program->cur_stack_index; ++i) {
+      Scratch_WriteStateInt(writer, program->stack[i] ? program->stack[i]->index : -1);
+    }
+  }
+{% endif %}
+{% endfor %}
+{% if hat_blocks %}
+  for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+    Scratch_WriteStateWord(writer, ctx->runnable_programs[word]);
+  }
+  Scratch_WriteStateInt(writer, ctx->sleeping_programs_count);
+  for (int i = 0; i < ctx->sleeping_programs_count; ++i) {
+    Scratch_WriteStateNumber(writer, ctx->sleeping_programs[i].deadline);
+    Scratch_WriteStateInt(writer, ctx->sleeping_programs[i].program);
+  }
+{% endif %}
+{% if broadcasts %}
+  // Active receivers of broadcasts are counted again from active programs on load.
+  for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+    Scratch_WriteStateWord(writer, ctx->active_programs[word]);
+    Scratch_WriteStateWord(writer, ctx->restarted_programs[word]);
+  }
+  for (int i = 0; i < {{ hat_blocks | length }}; ++i) {
+    Scratch_WriteStateInt(writer, ctx->awaited_broadcasts[i]);
+  }
+{% endif %}
 }
+
+// Mirrors Scratch_WriteState.
+static void Scratch_ReadState(ScratchContext* ctx, ScratchStateReader* reader) {
+  ctx->clock.tick_start_time = Scratch_ReadStateNumber(reader);
+  ctx->clock.current_time = Scratch_ReadStateNumber(reader);
+  ctx->clock.wake_up_time = Scratch_ReadStateNumber(reader);
+
+  // Variables
+{% for variable in variables %}
+  Scratch_ReadStateVariable(reader, &ctx->{{ variable.variable_name }});
 {% endfor %}
 
-// =====
-// Inplace blocks functions
-// =====
+  // Lists
+{% for list in lists %}
+  Scratch_ReadStateList(reader, &ctx->{{ list.list_name }});
+{% endfor %}
+
+  // Targets
+{% for target in targets %}
+  ctx->{{ target.variable_name }}.x = Scratch_ReadStateNumber(reader);
+  ctx->{{ target.variable_name }}.y = Scratch_ReadStateNumber(reader);
+  ctx->{{ target.variable_name }}.direction_x = Scratch_ReadStateNumber(reader);
+  ctx->{{ target.variable_name }}.direction_y = Scratch_ReadStateNumber(reader);
+  Scratch_ReadStateClonePool(reader, &ctx->{{ target.variable_name }}.clones);
+  ctx->{{ target.variable_name }}.clones.started_count =
+      Scratch_ReadStateInt(reader, 0, ctx->{{ target.variable_name }}.clones.count);
+{% endfor %}
+
+  // Blocks runtime
 {% for block in blocks %}
-{% for helpers in block.scratch_input_helpers %}
-// Inplace block helper:
-{% for helper in helpers %}
-{% if helper.op_code == "read_value_number" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable result;
-  Scratch_InitNumberVariable(&result, {{ helper.arguments[0] }});
-  return result;
-}
+{% if block.op_code == "kScratchControlWait" %}
+  ctx->{{ block.block_name }}_runtime.is_running = Scratch_ReadStateInt(reader, 0, 1);
+  ctx->{{ block.block_name }}_runtime.deadline = Scratch_ReadStateNumber(reader);
+{% elif block.op_code == "kScratchBroadcastAndWait" %}
+  ctx->{{ block.block_name }}_runtime.is_running = Scratch_ReadStateInt(reader, 0, 1);
 {% endif %}
-{% if helper.op_code == "read_value_string" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable result;
-  Scratch_InitStringVariable(&result, "{{ helper.arguments[0] }}", /*is_const_str_value=*/ 1);
-  return result;
-}
+{% endfor %}
+
+  // Programs
+{% for block in hat_blocks %}
+{% if scheduler == "threaded" %}
+  ctx->{{ block.block_name }}_program.pc = Scratch_ReadStateInt(reader, 0, {{ block.program_blocks | length }});
+{% else %}
+  {
+    {{ block.block_name }}_program_t* program = &ctx->{{ block.block_name }}_program;
+    program->is_running = Scratch_ReadStateInt(reader, 0, 1);
+    program->is_in_sub_stack = Scratch_ReadStateInt(reader, 0, 1);
+    program->cur_stack_index = Scratch_ReadStateInt(reader, -1, {{ block.max_level }});
+    for (int i = 0; i <= program->cur_stack_index; ++i) {
+      int index = Scratch_ReadStateInt(reader, -1, {{ block.target.blocks | length }} - 1);
+      program->stack[i] = index >= 0 ? {{ block.target.variable_name }}_blocks[index] : 0;
+    }
+  }
 {% endif %}
-{% if helper.op_code == "read_variable" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable result;
-  Scratch_InitVariable(&result);
-  Scratch_AssignVariable(&result, &{{ helper.arguments[0] }});
-  return result;
-}
+{% endfor %}
+{% if hat_blocks %}
+  // Sets of programs are indices into kScratchPrograms, bits of programs past its end are rejected.
+  for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+    ctx->runnable_programs[word] =
+        Scratch_ReadStateBits(reader, SCRATCH_VM_PROGRAM_SET_WORD_MASK({{ hat_blocks | length }}, word));
+  }
+  // A sleeping program has a single timer and isn't runnable, timers are in the heap order.
+  uint64_t sleeping_programs[SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }})] = {0};
+  ctx->sleeping_programs_count = Scratch_ReadStateInt(reader, 0, {{ hat_blocks | length }});
+  for (int i = 0; i < ctx->sleeping_programs_count; ++i) {
+    ScratchTimer* timer = &ctx->sleeping_programs[i];
+    timer->deadline = Scratch_ReadStateNumber(reader);
+    timer->program = Scratch_ReadStateInt(reader, 0, {{ hat_blocks | length }} - 1);
+    if (reader->failed) {
+      return;
+    }
+    if (Scratch_IsInProgramSet(ctx->runnable_programs, timer->program) ||
+        Scratch_IsInProgramSet(sleeping_programs, timer->program) ||
+        (i > 0 && timer->deadline < ctx->sleeping_programs[(i - 1) / 2].deadline)) {
+      reader->failed = 1;
+      return;
+    }
+    Scratch_AddToProgramSet(sleeping_programs, timer->program);
+  }
 {% endif %}
-{% if helper.op_code == "set_variable" %}
-static inline void {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num = {{ helper.arguments[0] }}(sprite, dt);
-  Scratch_AssignVariable(&{{ helper.arguments[1] }}, &num);
-
-  Scratch_FreeVariable(&num);
-}
+{% if broadcasts %}
+  for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+    uint64_t valid_bits = SCRATCH_VM_PROGRAM_SET_WORD_MASK({{ hat_blocks | length }}, word);
+    ctx->active_programs[word] = Scratch_ReadStateBits(reader, valid_bits);
+    ctx->restarted_programs[word] = Scratch_ReadStateBits(reader, valid_bits);
+  }
+  for (int i = 0; i < {{ hat_blocks | length }}; ++i) {
+    ctx->awaited_broadcasts[i] = Scratch_ReadStateInt(reader, -1, {{ broadcasts | length }} - 1);
+  }
+  memset(ctx->active_receivers, 0, sizeof(ctx->active_receivers));
+  for (int i = 0; i < {{ hat_blocks | length }}; ++i) {
+    if (Scratch_IsInProgramSet(ctx->active_programs, i)) {
+      // Only receivers are active.
+      if (kScratchProgramBroadcasts[i] < 0) {
+        reader->failed = 1;
+        return;
+      }
+      ++ctx->active_receivers[kScratchProgramBroadcasts[i]];
+    }
+  }
 {% endif %}
-{% if helper.op_code == "operator_add" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num1 = {{ helper.arguments[0] }}(sprite, dt);
-  ScratchVariable num2 = {{ helper.arguments[1] }}(sprite, dt);
-  
-  ScratchVariable result;
-  Scratch_InitNumberVariable(&result, Scratch_ReadNumberVariable(&num1) + Scratch_ReadNumberVariable(&num2));
-  
-  Scratch_FreeVariable(&num1);
-  Scratch_FreeVariable(&num2);
-  
-  return result;
 }
-{% endif %}
-{% if helper.op_code == "operator_multiply" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num1 = {{ helper.arguments[0] }}(sprite, dt);
-  ScratchVariable num2 = {{ helper.arguments[1] }}(sprite, dt);
-  
-  ScratchVariable result;
-  Scratch_InitNumberVariable(&result, Scratch_ReadNumberVariable(&num1) * Scratch_ReadNumberVariable(&num2));
-  
-  Scratch_FreeVariable(&num1);
-  Scratch_FreeVariable(&num2);
-  
-  return result;
+
+size_t Scratch_SaveState(ScratchContext* ctx, void* buffer, size_t buffer_size) {
+  // The header is written last, when the size is known.
+  ScratchStateWriter writer = {(unsigned char*) buffer, buffer_size, sizeof(ScratchStateHeader)};
+  Scratch_WriteState(ctx, &writer);
+
+  ScratchStateHeader header;
+  header.magic = SCRATCH_VM_STATE_MAGIC;
+  header.version = SCRATCH_VM_STATE_FORMAT_VERSION;
+  header.program_hash = SCRATCH_PROGRAM_STATE_HASH;
+  header.size = writer.size;
+  if (writer.size <= buffer_size) {
+    memcpy(buffer, &header, sizeof(header));
+  }
+  return writer.size;
 }
-{% endif %}
-{% if helper.op_code == "operator_divide" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num1 = {{ helper.arguments[0] }}(sprite, dt);
-  ScratchVariable num2 = {{ helper.arguments[1] }}(sprite, dt);
-  
-  ScratchVariable result;
-  Scratch_InitNumberVariable(&result, Scratch_ReadNumberVariable(&num1) / Scratch_ReadNumberVariable(&num2));
-  
-  Scratch_FreeVariable(&num1);
-  Scratch_FreeVariable(&num2);
-  
-  return result;
+
+ScratchLoadStateResult Scratch_LoadState(ScratchContext* ctx, const void* buffer, size_t buffer_size) {
+  ScratchStateHeader header;
+  if (buffer_size < sizeof(header)) {
+    return kScratchLoadStateInvalid;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if (header.magic != SCRATCH_VM_STATE_MAGIC) {
+    return kScratchLoadStateInvalid;
+  }
+  if (header.version != SCRATCH_VM_STATE_FORMAT_VERSION) {
+    return kScratchLoadStateUnsupportedVersion;
+  }
+  if (header.program_hash != SCRATCH_PROGRAM_STATE_HASH) {
+    return kScratchLoadStateOtherProgram;
+  }
+  if (header.size < sizeof(header) || header.size > buffer_size) {
+    return kScratchLoadStateInvalid;
+  }
+
+  ScratchStateReader reader = {(const unsigned char*) buffer, (size_t) header.size, sizeof(header), 0};
+  Scratch_ReadState(ctx, &reader);
+  if (reader.failed || reader.offset != reader.size) {
+    // Drops the partially loaded state.
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    return kScratchLoadStateInvalid;
+  }
+  return kScratchLoadStateOk;
 }
+
+// =====
+// Profile
+// =====
+{% if profile_sites %}
+static const ScratchProfileSite kScratchProfileSites[] = {
+{% for site in profile_sites %}
+  {{ '{' }}{{ site.block_id }}, {{ site.block_op_code }}, {{ site.sprite_name }}, {{ site.function_name }}{{ '}' }},
+{% endfor %}
+};
 {% endif %}
-{% if helper.op_code == "operator_join" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num1 = {{ helper.arguments[0] }}(sprite, dt);
-  ScratchVariable num2 = {{ helper.arguments[1] }}(sprite, dt);
-  
-  ScratchVariable result = Scratch_JoinStringVariables(&num1, &num2);
-
-  Scratch_FreeVariable(&num1);
-  Scratch_FreeVariable(&num2);
-
-  return result;
-}
+
+void Scratch_DumpProfile(ScratchContext* ctx, FILE* file, ScratchProfileFormat format) {
+{% if profile_sites %}
+  Scratch_WriteProfile(file, format, kScratchProfileSites, ctx->profile, {{ profile_sites | length }});
+{% else %}
+  (void) ctx;
+  Scratch_WriteProfile(file, format, 0, 0, 0);
 {% endif %}
-{% if helper.op_code == "sqrt" %}
-static inline ScratchVariable {{ helper.function_name }}(ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  ScratchVariable num = {{ helper.arguments[0] }}(sprite, dt);
-  
-  ScratchVariable result;
-  Scratch_InitNumberVariable(&result, sqrt(Scratch_ReadNumberVariable(&num)));
-
-  Scratch_FreeVariable(&num);
-
-  return result;
 }
+
+void Scratch_ResetProfile(ScratchContext* ctx) {
+{% if profile_sites %}
+  memset(ctx->profile, 0, sizeof(ctx->profile));
+{% else %}
+  (void) ctx;
 {% endif %}
+}
+
+// =====
+// Variables lookup
+// =====
+// Must match variable_name_hash in the transpiler.
+static uint32_t Scratch_HashVariableName(const char* sprite_name, const char* variable_name, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (const unsigned char* c = (const unsigned char*) sprite_name; *c; ++c) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  hash = hash * 16777619u;
+  for (const unsigned char* c = (const unsigned char*) variable_name; *c; ++c) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  // Low bits of FNV-1a only depend on low bits of the seed, fold the high bits in for tables of 2^n slots.
+  return hash ^ (hash >> 16);
+}
+
+{% if variables %}
+typedef struct ScratchVariableInfo {
+  const char* sprite_name;
+  const char* variable_name;
+  size_t offset;
+} ScratchVariableInfo;
+
+// Indexed by variable handles.
+static const ScratchVariableInfo kScratchVariables[{{ variables | length }}] = {
+{% for variable in variables %}
+  {{ '{' }}{{ variable.scratch_target_name | c_string }}, {{ variable.scratch_variable_name | c_string }}, offsetof(ScratchContext, {{ variable.variable_name }}){{ '}' }},
 {% endfor %}
+};
+
+// Minimal perfect hash built by the transpiler: the bucket seed gives the slot, the slot gives the handle.
+static const uint32_t kScratchVariableSeeds[{{ variables | length }}] = {
+{% for seed in variable_hash.seeds %}
+  {{ seed }}u,
 {% endfor %}
-{% if block.op_code == "kScratchInPlace" %}
-// Will not be inlined because pointer to this function will be used as inline block function.
-void {{ block.block_name }}_function(ScratchNumber dt) {
-{% for function in block.scratch_functions %}
-  {{ function }}((ScratchSprite*) &{{ block.target.variable_name }}, dt);
+};
+static const ScratchVariableHandle kScratchVariableSlots[{{ variables | length }}] = {
+{% for slot in variable_hash.slots %}
+  {{ slot }},
 {% endfor %}
-}
-{% elif block.op_code == "kScratchControlWait" %}
-// TODO(truvorskameikin): Move runtime block to target and clone.
-ScratchControlWaitRuntime {{ block.block_name }}_runtime;
-ScratchBlockFunctionResult {{ block.block_name }}_function(ScratchNumber dt) {
-  return Scratch_AdvanceControlWaitRuntime(
-      dt,
-      (ScratchSprite*) &{{ block.target.variable_name }},
-      {{ block.scratch_input_helpers[0][-1].function_name }},
-      &{{ block.block_name }}_runtime);
-}
+};
+{% endif %}
+
+ScratchVariableHandle Scratch_ResolveVariable(const char* sprite_name, const char* variable_name) {
+{% if variables %}
+  const uint32_t size = {{ variables | length }}u;
+  uint32_t seed = kScratchVariableSeeds[Scratch_HashVariableName(sprite_name, variable_name, 0) % size];
+  ScratchVariableHandle handle = kScratchVariableSlots[Scratch_HashVariableName(sprite_name, variable_name, seed) % size];
+  const ScratchVariableInfo* info = &kScratchVariables[handle];
+  if (strcmp(info->sprite_name, sprite_name) == 0 && strcmp(info->variable_name, variable_name) == 0) {
+    return handle;
+  }
 {% else %}
-ScratchBlockFunctionResult {{ block.block_name }}_function(ScratchNumber dt) {
-  (void) dt;
-  return kScratchBlockFunctionResultContinue;
+  (void) Scratch_HashVariableName;
+  (void) sprite_name;
+  (void) variable_name;
+{% endif %}
+  return SCRATCH_VM_INVALID_VARIABLE_HANDLE;
 }
+
+ScratchVariable* Scratch_GetVariable(ScratchContext* ctx, ScratchVariableHandle handle) {
+{% if variables %}
+  return (ScratchVariable*) ((char*) ctx + kScratchVariables[handle].offset);
+{% else %}
+  (void) ctx;
+  (void) handle;
+  return 0;
 {% endif %}
+}
+
+ScratchVariable* Scratch_FindVariable(ScratchContext* ctx, const char* sprite_name, const char* variable_name) {
+  ScratchVariableHandle handle = Scratch_ResolveVariable(sprite_name, variable_name);
+  if (handle == SCRATCH_VM_INVALID_VARIABLE_HANDLE) {
+    return 0;
+  }
+  return Scratch_GetVariable(ctx, handle);
+}
+
+ScratchClonePool* Scratch_GetClonePool(ScratchContext* ctx, const char* sprite_name) {
+{% for target in targets %}
+  if (strcmp({{ target.scratch_name | c_string }}, sprite_name) == 0) {
+    return &ctx->{{ target.variable_name }}.clones;
+  }
 {% endfor %}
+  return 0;
+}
+
+ScratchList* Scratch_FindList(ScratchContext* ctx, const char* sprite_name, const char* list_name) {
+{% for list in lists %}
+  if (strcmp({{ list.scratch_target_name | c_string }}, sprite_name) == 0 &&
+      strcmp({{ list.scratch_list_name | c_string }}, list_name) == 0) {
+    return &ctx->{{ list.list_name }};
+  }
+{% else %}
+  (void) ctx;
+  (void) sprite_name;
+  (void) list_name;
+{% endfor %}
+  return 0;
+}
 
 // =====
-// Scratch state and functions
+// Rendering
 // =====
-static ScratchNumber current_time = 0.0f;
+{% if atlas.costumes %}
+static const ScratchCostume kScratchCostumes[{{ atlas.costumes | length }}] = {
+{% for costume in atlas.costumes %}
+  {
+    .name = {{ costume.name | c_string }},
+    .x = {{ costume.image.atlas_x }},
+    .y = {{ costume.image.atlas_y }},
+    .width = {{ costume.image.width }},
+    .height = {{ costume.image.height }},
+    .rotation_center_x = {{ costume.rotation_center_x }},
+    .rotation_center_y = {{ costume.rotation_center_y }},
+    .resolution = {{ costume.resolution }},
+  },
+{% endfor %}
+};
 
-static inline ScratchNumber Scratch_sensing_timer(struct ScratchSprite* sprite, ScratchNumber dt) {
-  (void) sprite;
-  (void) dt;
-  return current_time;
+{% endif %}
+static const ScratchAtlas kScratchAtlas = {
+  .width = {{ atlas.width }},
+  .height = {{ atlas.height }},
+  .costumes = {{ "kScratchCostumes" if atlas.costumes else 0 }},
+  .costume_count = {{ atlas.costumes | length }},
+};
+
+const ScratchAtlas* Scratch_GetAtlas(void) {
+  return &kScratchAtlas;
+}
+
+int Scratch_GetRenderTargets(ScratchContext* ctx, ScratchRenderTarget* targets, int capacity) {
+  const ScratchRenderTarget render_targets[{{ render_targets | length }}] = {
+{% for target in render_targets %}
+    {
+      .x = &ctx->{{ target.variable_name }}.x,
+      .y = &ctx->{{ target.variable_name }}.y,
+      .direction_x = &ctx->{{ target.variable_name }}.direction_x,
+      .direction_y = &ctx->{{ target.variable_name }}.direction_y,
+      .clones = {{ 0 if target.is_stage else "&ctx->" ~ target.variable_name ~ ".clones" }},
+      .costume = {{ target.costume }},
+      .scale = {{ target.scale }},
+      .is_visible = {{ 1 if target.is_visible else 0 }},
+    },
+{% endfor %}
+  };
+  for (int i = 0; i < capacity && i < {{ render_targets | length }}; ++i) {
+    targets[i] = render_targets[i];
+  }
+  return {{ render_targets | length }};
 }
 
+{% if broadcasts %}
 // =====
-// Init
+// Broadcasts
 // =====
-void Scratch_Init(void) {
-  // Variables
-{% for variable in variables %}
-{% if variable.is_string %}
-  Scratch_InitStringVariable(&{{ variable.variable_name }}, "{{ variable.value }}", /*is_const_str_value=*/ 1);
-{% else %}
-  Scratch_InitNumberVariable(&{{ variable.variable_name }}, {{ variable.value }});
-{% endif %}
-{% endfor %}
+// Receivers are restarted lazily: they are marked restarted and runnable here and reset once the scheduler
+// reaches them. So a receiver restarting itself finishes its current run like in Scratch.
+void Scratch_StartBroadcast(ScratchContext* ctx, int broadcast) {
+  for (int i = kScratchBroadcastReceiversBegin[broadcast]; i < kScratchBroadcastReceiversBegin[broadcast + 1]; ++i) {
+    int program = kScratchBroadcastReceivers[i];
+    if (!Scratch_IsInProgramSet(ctx->active_programs, program)) {
+      Scratch_AddToProgramSet(ctx->active_programs, program);
+      ++ctx->active_receivers[broadcast];
+    } else if (!Scratch_IsInProgramSet(ctx->runnable_programs, program)) {
+      // Active but not runnable: it waits for a broadcast or sleeps.
+      if (ctx->awaited_broadcasts[program] >= 0) {
+        ctx->awaited_broadcasts[program] = -1;
+      } else {
+        Scratch_RemoveTimer(ctx->sleeping_programs, &ctx->sleeping_programs_count, program);
+      }
+    }
+    Scratch_AddToProgramSet(ctx->runnable_programs, program);
+    Scratch_AddToProgramSet(ctx->restarted_programs, program);
+  }
+}
 
-  // Targets
-{% for target in targets %}
-  {{target.variable_name}}.x = 0;
-  {{target.variable_name}}.y = 0;
-  {{target.variable_name}}.direction_x = 0;
-  {{target.variable_name}}.direction_y = 0;
-  {{target.variable_name}}.clones = 0;
-{% endfor %}
+// Like in Scratch, a broadcast nobody receives doesn't wait at all, otherwise the program waits at least until the
+// next tick.
+ScratchBlockFunctionResult Scratch_AdvanceBroadcastAndWait(
+    ScratchContext* ctx, int broadcast, ScratchBroadcastAndWaitRuntime* runtime) {
+  if (!runtime->is_running) {
+    Scratch_StartBroadcast(ctx, broadcast);
+    runtime->is_running = 1;
+  }
+  // Receivers restarted by other broadcasts meanwhile are waited for too.
+  if (ctx->active_receivers[broadcast] == 0) {
+    runtime->is_running = 0;
+    return kScratchBlockFunctionResultContinue;
+  }
+  ctx->awaited_broadcast = broadcast;
+  return kScratchBlockFunctionResultWaitForBroadcast;
+}
+
+// The last receiver of a broadcast to finish makes programs waiting for it runnable.
+static void Scratch_FinishProgram(ScratchContext* ctx, int program) {
+  int broadcast = kScratchProgramBroadcasts[program];
+  if (broadcast < 0) {
+    return;
+  }
+  Scratch_RemoveFromProgramSet(ctx->active_programs, program);
+  if (--ctx->active_receivers[broadcast] > 0) {
+    return;
+  }
+  for (int i = kScratchBroadcastWaitersBegin[broadcast]; i < kScratchBroadcastWaitersBegin[broadcast + 1]; ++i) {
+    int waiter = kScratchBroadcastWaiters[i];
+    if (ctx->awaited_broadcasts[waiter] == broadcast) {
+      ctx->awaited_broadcasts[waiter] = -1;
+      Scratch_AddToProgramSet(ctx->runnable_programs, waiter);
+    }
+  }
+}
 
-  // Blocks
-{% for block in blocks %}
-  {{ block.block_name }}.op_code = {{ block.op_code }};
-{% if block.next_block_name %}
-  {{ block.block_name }}.next = &{{ block.next_block_name }};
-{% else %}
-  {{ block.block_name }}.next = 0;
 {% endif %}
-{% if block.substack_block_name %}
-  {{ block.block_name }}.substack = &{{ block.substack_block_name }};
+void Scratch_Advance(ScratchContext* ctx, ScratchNumber dt) {
+  ctx->clock.tick_start_time = ctx->clock.current_time;
+  ctx->clock.current_time += dt;
+
+{% if hat_blocks %}
+  while (ctx->sleeping_programs_count > 0 && ctx->sleeping_programs[0].deadline <= ctx->clock.current_time) {
+    ScratchTimer timer = Scratch_PopTimer(ctx->sleeping_programs, &ctx->sleeping_programs_count);
+    Scratch_AddToProgramSet(ctx->runnable_programs, timer.program);
+  }
+
+  // Only runnable programs are visited, in the order of scripts.
+  for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+    uint64_t programs = ctx->runnable_programs[word];
+    while (programs) {
+{% if broadcasts %}
+      int bit = Scratch_LowestProgramInWord(programs);
+      int program = word * 64 + bit;
+      if (Scratch_IsInProgramSet(ctx->restarted_programs, program)) {
+        Scratch_RemoveFromProgramSet(ctx->restarted_programs, program);
+        kScratchProgramResets[program](ctx);
+      }
 {% else %}
-  {{ block.block_name }}.substack = 0;
+      int program = word * 64 + Scratch_LowestProgramInWord(programs);
+      programs &= programs - 1;
 {% endif %}
-{% if block.op_code == "kScratchInPlace" %}
-  {{ block.block_name }}.inplace_function = {{ block.block_name }}_function;
+
+      ScratchProgramState state = kScratchPrograms[program](ctx, dt);
+{% if broadcasts %}
+      if (Scratch_IsInProgramSet(ctx->restarted_programs, program)) {
+        // Restarted by its own broadcast, it starts over on the next tick instead of sleeping or finishing.
+      } else if (state == kScratchProgramWaiting) {
+        Scratch_RemoveFromProgramSet(ctx->runnable_programs, program);
+        ctx->awaited_broadcasts[program] = ctx->awaited_broadcast;
+      } else if (state == kScratchProgramSleeping) {
 {% else %}
-{% if block.op_code == "kScratchControlWait" %}
-  {{ block.block_name }}_runtime.is_running = 0;
-  {{ block.block_name }}_runtime.currentWaitTime = 0;
-  {{ block.block_name }}_runtime.timeout = 0;
+      if (state == kScratchProgramSleeping) {
 {% endif %}
-  {{ block.block_name }}.block_function = {{ block.block_name }}_function;
+        Scratch_RemoveFromProgramSet(ctx->runnable_programs, program);
+        ScratchTimer timer = {ctx->clock.wake_up_time, program};
+        Scratch_PushTimer(ctx->sleeping_programs, &ctx->sleeping_programs_count, timer);
+      } else if (state == kScratchProgramFinished) {
+        Scratch_RemoveFromProgramSet(ctx->runnable_programs, program);
+{% if broadcasts %}
+        Scratch_FinishProgram(ctx, program);
+{% endif %}
+      }
+{% if broadcasts %}
+      // Programs started by this one run in this tick if they come after it, the rest on the next tick.
+      programs = ctx->runnable_programs[word] & ~(((uint64_t) 2 << bit) - 1);
+{% endif %}
+    }
+  }
 {% endif %}
-{% endfor %}
 
-{% for block in when_flag_clicked_blocks %}
-  {{ block.block_name }}_program.stack[0] = &{{ block.block_name }};
-  {{ block.block_name }}_program.cur_stack_index = 0;
+  // Clones created during the tick, by scripts or by the host, start in the end of the tick.
+{% for target in targets if target.clone_scripts %}
+  {
+    ScratchClonePool* clones = &ctx->{{ target.variable_name }}.clones;
+    int begin = clones->started_count;
+    int end = clones->count;
+    // Clones created by clone scripts start on the next tick.
+    clones->started_count = end;
+{% for script in target.clone_scripts %}
+    {{ script.name }}_clones_function(ctx, clones, begin, end, dt);
 {% endfor %}
-}
-
-ScratchVariable* Scratch_FindVariable(const char* sprite_name, const char* variable_name) {
-{% for variable in variables %}
-  if (strcmp("{{ variable.scratch_target_name }}", sprite_name) == 0 && strcmp("{{ variable.scratch_variable_name }}", variable_name) == 0) {
-    return &{{ variable.variable_name }};
   }
 {% endfor %}
-  return 0;
+
+  Scratch_ResetArena(&ctx->temporary_arena);
 }
 
-void Scratch_Advance(ScratchNumber dt) {
-{% for block in when_flag_clicked_blocks %}
-  Scratch_Advance_{{ block.block_name }}_program(dt);
+// A tick without runnable programs ending before the next wake up time changes nothing but the clock.
+// Such ticks only advance the clock, with the same additions Scratch_Advance makes, so the state stays
+// identical to stepping through them.
+size_t Scratch_AdvanceUntil(ScratchContext* ctx, ScratchNumber target_time, ScratchNumber dt) {
+  size_t skipped_ticks = 0;
+  if (!(dt > 0)) {
+    return skipped_ticks;
+  }
+
+  while (ctx->clock.current_time + dt <= target_time) {
+    int has_runnable_programs = 0;
+    ScratchNumber wake_up_time = INFINITY;
+{% if hat_blocks %}
+    for (int word = 0; word < SCRATCH_VM_PROGRAM_SET_WORDS({{ hat_blocks | length }}); ++word) {
+      has_runnable_programs |= ctx->runnable_programs[word] != 0;
+    }
+    if (ctx->sleeping_programs_count > 0) {
+      wake_up_time = ctx->sleeping_programs[0].deadline;
+    }
+{% endif %}
+{% for target in targets if target.clone_scripts %}
+    // Clones created by the host start in the next tick.
+    has_runnable_programs |= ctx->{{ target.variable_name }}.clones.started_count < ctx->{{ target.variable_name }}.clones.count;
 {% endfor %}
+
+    if (has_runnable_programs) {
+      Scratch_Advance(ctx, dt);
+      continue;
+    }
+
+    ScratchNumber tick_end_time = ctx->clock.current_time + dt;
+    if (tick_end_time >= wake_up_time) {
+      Scratch_Advance(ctx, dt);
+      continue;
+    }
+    while (tick_end_time < wake_up_time && tick_end_time <= target_time) {
+      ctx->clock.tick_start_time = ctx->clock.current_time;
+      ctx->clock.current_time = tick_end_time;
+      ++skipped_ticks;
+      tick_end_time = ctx->clock.current_time + dt;
+    }
+  }
+  return skipped_ticks;
 }
 
 // Need two new lines in the end.
-
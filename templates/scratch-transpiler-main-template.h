@@ -1,15 +1,80 @@
 #pragma once
 
+#include <stddef.h>
+
 {% include 'scratch-vm-types.h' with context %}
 
 {% include 'scratch-vm-variables-public.h' with context %}
 
+{% include 'scratch-vm-clones.h' with context %}
+
+{% include 'scratch-vm-lists.h' with context %}
+
+{% include 'scratch-vm-state.h' with context %}
+
+{% include 'scratch-vm-profile.h' with context %}
+
+{% include 'scratch-vm-render.h' with context %}
+
+// 1 if the program was transpiled with --profile.
+#define SCRATCH_PROGRAM_PROFILE {{ 1 if profile else 0 }}
+{% if atlas_file %}
+
+// Costumes packed by the transpiler with --atlas, next to the generated files. Regions of costumes in it are in
+// Scratch_GetAtlas.
+#define SCRATCH_PROGRAM_ATLAS_FILE {{ atlas_file | c_string }}
+{% endif %}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void Scratch_Init(void);
-void Scratch_Advance(ScratchNumber dt);
+// Size of ScratchContext, contexts can be allocated by the host, e.g. densely packed in a single array.
+size_t Scratch_GetContextSize(void);
+
+// Initializes a context in uninitialized memory.
+void Scratch_Init(ScratchContext* ctx);
+// Releases memory owned by the context, but not the context itself.
+void Scratch_Free(ScratchContext* ctx);
+
+// Allocates and initializes a context, delete it with Scratch_DeleteContext.
+ScratchContext* Scratch_NewContext(void);
+void Scratch_DeleteContext(ScratchContext* ctx);
+
+void Scratch_Advance(ScratchContext* ctx, ScratchNumber dt);
+
+// Writes the whole state of |ctx| to a versioned blob, see ScratchStateHeader. Returns the size of the blob,
+// |buffer| holds it only if the size doesn't exceed |buffer_size|: call with a zero |buffer_size| to measure.
+// Must be called between ticks.
+size_t Scratch_SaveState(ScratchContext* ctx, void* buffer, size_t buffer_size);
+// Replaces the state of the initialized |ctx| with a blob saved by Scratch_SaveState of the same program.
+// |buffer| isn't referenced after the call and may be a read only mapping of a file. A context may be loaded
+// from the same blob any number of times, e.g. to fork many instances from a warmed up state.
+// Blobs from other programs or versions are rejected without changes to |ctx|, on a corrupted blob |ctx| is
+// reinitialized.
+ScratchLoadStateResult Scratch_LoadState(ScratchContext* ctx, const void* buffer, size_t buffer_size);
+
+// Writes calls and cycles of every generated block function and helper counted in |ctx| since Scratch_Init
+// or Scratch_ResetProfile. Writes no functions unless SCRATCH_PROGRAM_PROFILE is 1.
+void Scratch_DumpProfile(ScratchContext* ctx, FILE* file, ScratchProfileFormat format);
+void Scratch_ResetProfile(ScratchContext* ctx);
+
+// Clones of a sprite, 0 for unknown sprites. Hosts may create, delete and move clones directly.
+ScratchClonePool* Scratch_GetClonePool(ScratchContext* ctx, const char* sprite_name);
+
+// A list of a sprite or of the stage, 0 for unknown lists.
+ScratchList* Scratch_FindList(ScratchContext* ctx, const char* sprite_name, const char* list_name);
+
+// Costumes of every target, the atlas is empty unless the program was transpiled with --atlas.
+const ScratchAtlas* Scratch_GetAtlas(void);
+// Writes at most |capacity| targets in the order they are drawn in, the stage first, and returns the number of
+// targets. Pointers in them stay valid until the context is freed.
+int Scratch_GetRenderTargets(ScratchContext* ctx, ScratchRenderTarget* targets, int capacity);
+
+// Calls Scratch_Advance(ctx, dt) while the tick ends not later than |target_time|, but jumps over the ticks in
+// which every program is sleeping in a wait or finished. The result is identical to stepping through every tick.
+// Returns the number of skipped ticks.
+size_t Scratch_AdvanceUntil(ScratchContext* ctx, ScratchNumber target_time, ScratchNumber dt);
 
 #ifdef __cplusplus
 }
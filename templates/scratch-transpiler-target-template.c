@@ -0,0 +1,341 @@
+// Scripts of {{ target.sprite_name }}.
+#include "{{ internal_header_file }}"
+
+// =====
+// Interned strings
+// =====
+{% for name, literal in string_constants %}
+static const char {{ name }}[] = {{ literal }};
+{% endfor %}
+
+// Profiled functions are renamed to *_unprofiled and called by a counting wrapper with the original name.
+{% macro profiled(linkage, return_type, function_name, profile_index, parameters, arguments) %}
+{{ linkage }}{{ return_type }} {{ function_name }}({{ parameters }}) {
+  uint64_t start_cycles = Scratch_ReadCycleCounter();
+{% if return_type == "void" %}
+  {{ function_name }}_unprofiled({{ arguments }});
+  Scratch_CountProfileSample(&ctx->profile[{{ profile_index }}], start_cycles);
+{% else %}
+  {{ return_type }} result = {{ function_name }}_unprofiled({{ arguments }});
+  Scratch_CountProfileSample(&ctx->profile[{{ profile_index }}], start_cycles);
+  return result;
+{% endif %}
+}
+{% endmacro %}
+
+{% macro emit_helpers(block) %}
+{% for helpers in block.scratch_input_helpers %}
+// Inplace block helper:
+{% for helper in helpers %}
+{% if helper.emit == "inlined" %}
+{% elif helper.emit == "boxed_number" %}
+static inline ScratchVariable {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) ctx;
+  (void) sprite;
+  (void) dt;
+  ScratchVariable result;
+  Scratch_InitNumberVariable(&result, {{ helper.c_expression }});
+  return result;
+}
+{% elif helper.op_code == "read_value_string" %}
+static inline ScratchVariable {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) ctx;
+  (void) sprite;
+  (void) dt;
+  ScratchVariable result;
+  Scratch_InitStringVariable(&result, {{ helper.string_constant }}, /*is_const_str_value=*/ 1);
+  return result;
+}
+{% elif helper.op_code == "read_variable" %}
+static inline ScratchVariable {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  ScratchVariable result;
+  Scratch_BorrowVariable(&result, &ctx->{{ helper.arguments[0] }});
+  return result;
+}
+{% elif helper.op_code == "set_variable" and helper.c_expression %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  Scratch_AssignNumberVariable(&ctx->{{ helper.arguments[1] }}, {{ helper.c_expression }});
+}
+{% elif helper.op_code == "set_variable" %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  ScratchVariable num = {{ helper.arguments[0] }}(ctx, sprite, dt);
+  Scratch_AssignVariable(&ctx->{{ helper.arguments[1] }}, &num);
+}
+{% elif helper.op_code == "create_clone" %}
+// The clone starts where the original sprite is.
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  {{ helper.arguments[0] }}_t* original = &ctx->{{ helper.arguments[0] }};
+  Scratch_CreateClone(&original->clones, original->x, original->y, original->direction_x, original->direction_y);
+}
+{% elif helper.motion_updates %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) ctx;
+  (void) dt;
+{% for update in helper.motion_updates %}
+  const ScratchNumber value{{ loop.index0 }} = {{ update.c_expression }};
+{% endfor %}
+{% for update in helper.motion_updates %}
+  sprite->{{ update.field }} {{ "=" if update.kind == "set" else "+=" }} value{{ loop.index0 }};
+{% endfor %}
+}
+{% elif helper.op_code == "data_addtolist" %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+{% if helper.c_expression %}
+  Scratch_AddNumberToList(&ctx->{{ helper.arguments[0] }}, {{ helper.c_expression }});
+{% else %}
+  ScratchVariable item = {{ helper.arguments[1] }}(ctx, sprite, dt);
+  Scratch_AddToList(&ctx->{{ helper.arguments[0] }}, &item);
+{% endif %}
+}
+{% elif helper.op_code == "data_deleteoflist" %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  Scratch_DeleteListItem(&ctx->{{ helper.arguments[0] }}, {{ helper.index_c_expression }});
+}
+{% elif helper.op_code == "data_deletealloflist" %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  Scratch_DeleteAllOfList(&ctx->{{ helper.arguments[0] }});
+}
+{% elif helper.op_code == "data_replaceitemoflist" %}
+// The index is read before the item, like in Scratch.
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  const int index = {{ helper.index_c_expression }};
+{% if helper.c_expression %}
+  Scratch_ReplaceListItemWithNumber(&ctx->{{ helper.arguments[0] }}, index, {{ helper.c_expression }});
+{% else %}
+  ScratchVariable item = {{ helper.arguments[2] }}(ctx, sprite, dt);
+  Scratch_ReplaceListItem(&ctx->{{ helper.arguments[0] }}, index, &item);
+{% endif %}
+}
+{% elif helper.op_code == "data_itemoflist" %}
+static inline ScratchVariable {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+  return Scratch_GetListItem(&ctx->{{ helper.arguments[0] }}, {{ helper.index_c_expression }});
+}
+{% elif helper.op_code == "broadcast" %}
+static inline void {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) sprite;
+  (void) dt;
+{% if helper.broadcast.receivers %}
+  Scratch_StartBroadcast(ctx, {{ helper.broadcast.id }});
+{% else %}
+  // Nothing receives {{ helper.broadcast.name | c_string }}.
+  (void) ctx;
+{% endif %}
+}
+{% elif helper.op_code == "operator_join" %}
+static inline ScratchVariable {{ helper.function_name }}{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  ScratchVariable num1 = {{ helper.arguments[0] }}(ctx, sprite, dt);
+  ScratchVariable num2 = {{ helper.arguments[1] }}(ctx, sprite, dt);
+
+  return Scratch_JoinStringVariables(&ctx->temporary_arena, &num1, &num2);
+}
+{% endif %}
+{% if profile and helper.profile_index >= 0 %}
+{{ profiled("static inline ", helper.profile_return_type, helper.function_name, helper.profile_index, "ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt", "ctx, sprite, dt") }}
+{% endif %}
+{% endfor %}
+{% endfor %}
+{% endmacro %}
+
+// =====
+// Inplace blocks functions
+// =====
+{% for block in target.blocks %}
+{{ emit_helpers(block) }}
+{% if block.op_code == "kScratchInPlace" %}
+// Will not be inlined because pointer to this function will be used as inline block function.
+static {{ "inline " if profile }}void {{ block.block_name }}_function{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchNumber dt) {
+{% for function in block.scratch_functions %}
+  {{ function }}(ctx, (ScratchSprite*) &ctx->{{ block.target.variable_name }}, dt);
+{% endfor %}
+}
+{% elif block.op_code == "kScratchControlWait" %}
+static ScratchNumber {{ block.block_name }}_duration(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt) {
+  (void) ctx;
+  (void) sprite;
+  (void) dt;
+  return {{ block.duration_c_expression }};
+}
+static {{ "inline " if profile }}ScratchBlockFunctionResult {{ block.block_name }}_function{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchNumber dt) {
+  return Scratch_AdvanceControlWaitRuntime(
+      ctx,
+      dt,
+      (ScratchSprite*) &ctx->{{ block.target.variable_name }},
+      {{ block.block_name }}_duration,
+      &ctx->{{ block.block_name }}_runtime,
+      &ctx->clock);
+}
+{% elif block.op_code == "kScratchBroadcastAndWait" %}
+static {{ "inline " if profile }}ScratchBlockFunctionResult {{ block.block_name }}_function{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchNumber dt) {
+  (void) dt;
+{% if block.broadcast.receivers %}
+  return Scratch_AdvanceBroadcastAndWait(ctx, {{ block.broadcast.id }}, &ctx->{{ block.block_name }}_runtime);
+{% else %}
+  // Nothing receives {{ block.broadcast.name | c_string }}, nothing to wait for.
+  (void) ctx;
+  return kScratchBlockFunctionResultContinue;
+{% endif %}
+}
+{% else %}
+static {{ "inline " if profile }}ScratchBlockFunctionResult {{ block.block_name }}_function{{ "_unprofiled" if profile }}(ScratchContext* ctx, ScratchNumber dt) {
+  (void) ctx;
+  (void) dt;
+  return kScratchBlockFunctionResultContinue;
+}
+{% endif %}
+{% if profile %}
+{{ profiled("static ", "void" if block.op_code == "kScratchInPlace" else "ScratchBlockFunctionResult", block.block_name ~ "_function", block.profile_index, "ScratchContext* ctx, ScratchNumber dt", "ctx, dt") }}
+{% endif %}
+{% endfor %}
+
+// =====
+// "When I start as a clone" scripts
+// =====
+{% for script in target.clone_scripts %}
+{% for block in script.blocks %}
+{{ emit_helpers(block) }}
+{% endfor %}
+// Runs the script for clones [begin, end) of {{ script.target.sprite_name }}.
+{{ "static " if profile }}void {{ script.name }}_clones_function{{ "_unprofiled" if profile }}(
+    ScratchContext* ctx, ScratchClonePool* clones, int begin, int end, ScratchNumber dt) {
+  ScratchSprite* sprite = (ScratchSprite*) &ctx->{{ script.target.variable_name }};
+  (void) sprite;
+  (void) dt;
+{% if script.use_kernels %}
+  // Motion blocks only, so every block runs for all the clones at once.
+{% for block in script.blocks %}
+{% for helpers in block.scratch_input_helpers %}
+  {
+{% for update in helpers[-1].motion_updates %}
+    const ScratchNumber value{{ loop.index0 }} = {{ update.c_expression }};
+{% endfor %}
+{% for update in helpers[-1].motion_updates %}
+    Scratch_{{ "FillColumn" if update.kind == "set" else "AddToColumn" }}(clones->{{ update.field }} + begin, end - begin, value{{ loop.index0 }});
+{% endfor %}
+  }
+{% endfor %}
+{% endfor %}
+{% else %}
+  for (int i = begin; i < end; ++i) {
+{% for block in script.blocks %}
+{% for helpers in block.scratch_input_helpers %}
+{% if helpers[-1].motion_updates %}
+    {
+{% for update in helpers[-1].motion_updates %}
+      const ScratchNumber value{{ loop.index0 }} = {{ update.c_expression }};
+{% endfor %}
+{% for update in helpers[-1].motion_updates %}
+      clones->{{ update.field }}[i] {{ "=" if update.kind == "set" else "+=" }} value{{ loop.index0 }};
+{% endfor %}
+    }
+{% else %}
+    {{ helpers[-1].function_name }}(ctx, sprite, dt);
+{% endif %}
+{% endfor %}
+{% endfor %}
+  }
+{% endif %}
+}
+{% if profile %}
+{{ profiled("", "void", script.name ~ "_clones_function", script.profile_index, "ScratchContext* ctx, ScratchClonePool* clones, int begin, int end, ScratchNumber dt", "ctx, clones, begin, end, dt") }}
+{% endif %}
+
+{% endfor %}
+{% if scheduler != "threaded" %}
+// =====
+// Blocks
+// =====
+// Defined in reverse order, so that every block is defined before blocks referencing it.
+// The threaded scheduler calls block functions directly and doesn't need them.
+{% for block in target.blocks | reverse %}
+{{ "static " if block.op_code not in ("kScratchWhenFlagClicked", "kScratchWhenBroadcastReceived") }}const ScratchBlock {{ block.block_name }} = {
+{% if block.next_block_name %}
+  .next = &{{ block.next_block_name }},
+{% else %}
+  .next = 0,
+{% endif %}
+{% if block.substack_block_name %}
+  .substack = &{{ block.substack_block_name }},
+{% else %}
+  .substack = 0,
+{% endif %}
+  .op_code = {{ block.op_code }},
+  .index = {{ loop.revindex0 }},
+{% if block.op_code == "kScratchInPlace" %}
+  .inplace_function = {{ block.block_name }}_function,
+{% else %}
+  .block_function = {{ block.block_name }}_function,
+{% endif %}
+};
+{% endfor %}
+
+{% if target.blocks %}
+const ScratchBlock* const {{ target.variable_name }}_blocks[{{ target.blocks | length }}] = {
+{% for block in target.blocks %}
+  &{{ block.block_name }},
+{% endfor %}
+};
+{% endif %}
+{% endif %}
+
+// =====
+// Programs: "when flag clicked" and "when I receive" scripts
+// =====
+{% for block in target.hat_blocks %}
+{% if scheduler == "threaded" %}
+// Runs blocks one after another in a single switch without recursion or calls through function pointers.
+// Yields on kScratchBlockFunctionResultWait and resumes from the same block on the next call.
+ScratchProgramState Scratch_Advance_{{ block.block_name }}_program(ScratchContext* ctx, ScratchNumber dt) {
+  switch (ctx->{{ block.block_name }}_program.pc) {
+{% for program_block in block.program_blocks %}
+    case {{ loop.index0 }}:
+{% if program_block.op_code == "kScratchInPlace" %}
+      {{ program_block.block_name }}_function(ctx, dt);
+{% elif program_block.op_code == "kScratchBroadcastAndWait" %}
+      if ({{ program_block.block_name }}_function(ctx, dt) == kScratchBlockFunctionResultWaitForBroadcast) {
+        ctx->{{ block.block_name }}_program.pc = {{ loop.index0 }};
+        return kScratchProgramWaiting;
+      }
+{% else %}
+      if ({{ program_block.block_name }}_function(ctx, dt) == kScratchBlockFunctionResultWait) {
+        ctx->{{ block.block_name }}_program.pc = {{ loop.index0 }};
+        return kScratchProgramSleeping;
+      }
+{% endif %}
+      // fallthrough
+{% endfor %}
+    default:
+      ctx->{{ block.block_name }}_program.pc = {{ block.program_blocks | length }};
+  }
+  return kScratchProgramFinished;
+}
+{% else %}
+ScratchProgramState Scratch_Advance_{{ block.block_name }}_program(ScratchContext* ctx, ScratchNumber dt) {
+  return Scratch_AdvanceSingleProgram(
+      ctx,
+      dt,
+      ctx->{{ block.block_name }}_program.stack,
+      &ctx->{{ block.block_name }}_program.cur_stack_index,
+      ctx->{{ block.block_name }}_program.is_in_sub_stack);
+}
+{% endif %}
+{% endfor %}
+
+
+// Need two new lines in the end.
+
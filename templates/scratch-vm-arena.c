@@ -0,0 +1,82 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-arena.h"
+
+#include <stdlib.h>
+#endif
+
+// Every allocation is aligned to this value.
+#define SCRATCH_VM_ARENA_ALIGNMENT 16
+#define SCRATCH_VM_ARENA_ALIGN(size) (((size) + SCRATCH_VM_ARENA_ALIGNMENT - 1) & ~(size_t)(SCRATCH_VM_ARENA_ALIGNMENT - 1))
+
+static char* Scratch_ArenaBlockData(ScratchArenaBlock* block) {
+  return (char*)block + SCRATCH_VM_ARENA_ALIGN(sizeof(ScratchArenaBlock));
+}
+
+static ScratchArenaBlock* Scratch_NewArenaBlock(size_t size) {
+  if (size < SCRATCH_VM_ARENA_BLOCK_SIZE) {
+    size = SCRATCH_VM_ARENA_BLOCK_SIZE;
+  }
+
+  ScratchArenaBlock* block = malloc(SCRATCH_VM_ARENA_ALIGN(sizeof(ScratchArenaBlock)) + size);
+  block->next = 0;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+void Scratch_InitArena(ScratchArena* arena) {
+  arena->first = 0;
+  arena->current = 0;
+}
+
+void* Scratch_AllocateFromArena(ScratchArena* arena, size_t size) {
+  size = SCRATCH_VM_ARENA_ALIGN(size);
+
+  ScratchArenaBlock* block = arena->current;
+  if (block && block->size - block->used >= size) {
+    void* result = Scratch_ArenaBlockData(block) + block->used;
+    block->used += size;
+    return result;
+  }
+
+  // Reuse blocks left after the last reset before allocating new ones.
+  ScratchArenaBlock* prev = block;
+  block = block ? block->next : arena->first;
+  while (block && block->size < size) {
+    prev = block;
+    block = block->next;
+  }
+
+  if (!block) {
+    block = Scratch_NewArenaBlock(size);
+    if (prev) {
+      block->next = prev->next;
+      prev->next = block;
+    } else {
+      arena->first = block;
+    }
+  }
+
+  block->used = size;
+  arena->current = block;
+  return Scratch_ArenaBlockData(block);
+}
+
+void Scratch_ResetArena(ScratchArena* arena) {
+  for (ScratchArenaBlock* block = arena->first; block; block = block->next) {
+    block->used = 0;
+  }
+  arena->current = arena->first;
+}
+
+void Scratch_FreeArena(ScratchArena* arena) {
+  ScratchArenaBlock* block = arena->first;
+  while (block) {
+    ScratchArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+
+  arena->first = 0;
+  arena->current = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SCRATCH_VM_INCLUDE_ARENA_H_
+#define SCRATCH_VM_INCLUDE_ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimal size of a single arena block. Larger allocations get a block of their own.
+#define SCRATCH_VM_ARENA_BLOCK_SIZE 4096
+
+typedef struct ScratchArenaBlock {
+  struct ScratchArenaBlock* next;
+  size_t size;
+  size_t used;
+} ScratchArenaBlock;
+
+// Bump allocator for values that live no longer than a single Scratch_Advance call.
+// Blocks are kept on reset, so after the first few ticks allocation never reaches malloc.
+// Zero initialized arena is a valid empty arena.
+typedef struct ScratchArena {
+  ScratchArenaBlock* first;
+  ScratchArenaBlock* current;
+} ScratchArena;
+
+extern void Scratch_InitArena(ScratchArena* arena);
+extern void* Scratch_AllocateFromArena(ScratchArena* arena, size_t size);
+extern void Scratch_ResetArena(ScratchArena* arena);
+extern void Scratch_FreeArena(ScratchArena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_ARENA_H_
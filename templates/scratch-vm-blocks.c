@@ -0,0 +1,67 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-variables-public.h"
+#include "scratch-vm-blocks.h"
+
+#include <math.h>
+#endif
+
+ScratchBlockFunctionResult Scratch_AdvanceControlWaitRuntime(
+    ScratchContext* ctx,
+    ScratchNumber dt,
+    ScratchSprite* sprite,
+    NumberExpressionFunction duration_expression,
+    ScratchControlWaitRuntime* runtime,
+    ScratchClock* clock) {
+  if (!runtime->is_running) {
+    runtime->deadline = clock->tick_start_time + duration_expression(ctx, sprite, dt);
+    // Such a wait never ends, keeps deadlines ordered in the timers heap.
+    if (isnan(runtime->deadline)) {
+      runtime->deadline = INFINITY;
+    }
+
+    runtime->is_running = 1;
+  }
+
+  if (clock->current_time >= runtime->deadline) {
+    runtime->is_running = 0;
+    return kScratchBlockFunctionResultContinue;
+  }
+  clock->wake_up_time = runtime->deadline;
+  return kScratchBlockFunctionResultWait;
+}
+
+ScratchProgramState Scratch_AdvanceSingleProgram(
+    ScratchContext* ctx, ScratchNumber dt, const ScratchBlock* stack[], int* cur_stack_index, int is_in_sub_stack) {
+  if (*cur_stack_index < 0) {
+    return kScratchProgramFinished;
+  }
+
+  if (stack[*cur_stack_index] == 0) {
+    if (is_in_sub_stack) {
+      return kScratchProgramRunnable;
+    }
+
+    --(*cur_stack_index);
+  }
+
+  if (*cur_stack_index < 0) {
+    return kScratchProgramFinished;
+  }
+
+  const ScratchBlock* cur_block = stack[*cur_stack_index];
+  if (cur_block->op_code == kScratchInPlace) {
+    cur_block->inplace_function(ctx, dt);
+  } else {
+    ScratchBlockFunctionResult result = cur_block->block_function(ctx, dt);
+    if (result == kScratchBlockFunctionResultWait) {
+      return kScratchProgramSleeping;
+    }
+    if (result == kScratchBlockFunctionResultWaitForBroadcast) {
+      return kScratchProgramWaiting;
+    }
+  }
+
+  stack[*cur_stack_index] = stack[*cur_stack_index]->next;
+  return Scratch_AdvanceSingleProgram(ctx, dt, stack, cur_stack_index, is_in_sub_stack);
+}
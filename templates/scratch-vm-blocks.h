@@ -0,0 +1,104 @@
+#ifndef SCRATCH_VM_INCLUDE_BLOCKS_H_
+#define SCRATCH_VM_INCLUDE_BLOCKS_H_
+
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-variables-public.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Common part of all targets: generated target structs start with the same fields.
+typedef struct ScratchSprite {
+  ScratchNumber x;
+  ScratchNumber y;
+  ScratchNumber direction_x;
+  ScratchNumber direction_y;
+} ScratchSprite;
+
+typedef enum ScratchOpCode {
+  kScratchWhenFlagClicked = 1,
+  kScratchInPlace = 2,
+  kScratchControlForever = 3,
+  kScratchControlIf = 4,
+  kScratchControlWait = 5,
+  kScratchWhenStartAsClone = 6,
+  kScratchWhenBroadcastReceived = 7,
+  kScratchBroadcastAndWait = 8,
+} ScratchOpCode;
+
+typedef enum ScratchBlockFunctionResult {
+  kScratchBlockFunctionResultContinue = 1,
+  kScratchBlockFunctionResultWait = 2,
+  // Waits until receivers of a broadcast finish, see ScratchBroadcastAndWaitRuntime.
+  kScratchBlockFunctionResultWaitForBroadcast = 3,
+} ScratchBlockFunctionResult;
+
+typedef enum ScratchProgramState {
+  kScratchProgramRunnable = 1,
+  // Sleeps until ScratchClock::wake_up_time.
+  kScratchProgramSleeping = 2,
+  kScratchProgramFinished = 3,
+  // Neither advanced nor sleeping until the last receiver of the broadcast it waits for finishes.
+  kScratchProgramWaiting = 4,
+} ScratchProgramState;
+
+typedef void (*ImplaceBlockFunction)(ScratchContext* ctx, ScratchNumber dt);
+typedef ScratchBlockFunctionResult (*BlockFunction)(ScratchContext* ctx, ScratchNumber dt);
+typedef ScratchVariable (*ExpressionFunction)(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt);
+typedef ScratchNumber (*NumberExpressionFunction)(ScratchContext* ctx, ScratchSprite* sprite, ScratchNumber dt);
+typedef ScratchProgramState (*ProgramFunction)(ScratchContext* ctx, ScratchNumber dt);
+
+// Blocks are immutable and shared by all contexts, per instance state lives in ScratchContext.
+typedef struct ScratchBlock {
+  const struct ScratchBlock* next;
+  const struct ScratchBlock* substack;
+  ScratchOpCode op_code;
+  // Position in the blocks table of its target, e.g. Sprite1_blocks.
+  int index;
+  union {
+    ImplaceBlockFunction inplace_function;
+    BlockFunction block_function;
+  };
+} ScratchBlock;
+
+typedef struct ScratchClock {
+  // Time at the beginning and at the end of the current tick.
+  ScratchNumber tick_start_time;
+  ScratchNumber current_time;
+  // Set by a block returning kScratchBlockFunctionResultWait, the program sleeps until this time.
+  ScratchNumber wake_up_time;
+} ScratchClock;
+
+typedef struct ScratchControlWaitRuntime {
+  int is_running;
+  ScratchNumber deadline;
+} ScratchControlWaitRuntime;
+
+typedef struct ScratchBroadcastAndWaitRuntime {
+  // Set once the broadcast is sent, until its receivers finish.
+  int is_running;
+} ScratchBroadcastAndWaitRuntime;
+
+// The wait started in a tick ends in the first tick ending at or after `tick start + duration`.
+// Until then the program is not advanced at all.
+extern ScratchBlockFunctionResult Scratch_AdvanceControlWaitRuntime(
+    ScratchContext* ctx,
+    ScratchNumber dt,
+    ScratchSprite* sprite,
+    NumberExpressionFunction duration_expression,
+    ScratchControlWaitRuntime* runtime,
+    ScratchClock* clock);
+
+// Runs blocks of the program from the top of |stack| until it sleeps or finishes, or until the end of the
+// substack when |is_in_sub_stack| is set.
+extern ScratchProgramState Scratch_AdvanceSingleProgram(
+    ScratchContext* ctx, ScratchNumber dt, const ScratchBlock* stack[], int* cur_stack_index, int is_in_sub_stack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_BLOCKS_H_
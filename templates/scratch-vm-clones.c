@@ -0,0 +1,121 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-clones.h"
+
+#include <stdlib.h>
+#endif
+
+// Capacity of a pool after the first clone is created.
+#define SCRATCH_VM_CLONE_POOL_MIN_CAPACITY 16
+
+void Scratch_InitClonePool(ScratchClonePool* pool) {
+  pool->x = 0;
+  pool->y = 0;
+  pool->direction_x = 0;
+  pool->direction_y = 0;
+  pool->ids = 0;
+  pool->indices = 0;
+  pool->free_ids = 0;
+  pool->free_ids_count = 0;
+  pool->ids_count = 0;
+  pool->count = 0;
+  pool->capacity = 0;
+  pool->started_count = 0;
+}
+
+void Scratch_FreeClonePool(ScratchClonePool* pool) {
+  free(pool->x);
+  free(pool->y);
+  free(pool->direction_x);
+  free(pool->direction_y);
+  free(pool->ids);
+  free(pool->indices);
+  free(pool->free_ids);
+  Scratch_InitClonePool(pool);
+}
+
+// Every id indexes |indices| and may end up in |free_ids|, so both grow together with columns:
+// the number of ids never exceeds the maximal number of live clones.
+static void Scratch_GrowClonePool(ScratchClonePool* pool) {
+  int capacity = pool->capacity ? pool->capacity * 2 : SCRATCH_VM_CLONE_POOL_MIN_CAPACITY;
+  size_t number_size = sizeof(ScratchNumber) * (size_t)capacity;
+  size_t id_size = sizeof(ScratchCloneId) * (size_t)capacity;
+
+  pool->x = realloc(pool->x, number_size);
+  pool->y = realloc(pool->y, number_size);
+  pool->direction_x = realloc(pool->direction_x, number_size);
+  pool->direction_y = realloc(pool->direction_y, number_size);
+  pool->ids = realloc(pool->ids, id_size);
+  pool->indices = realloc(pool->indices, sizeof(int) * (size_t)capacity);
+  pool->free_ids = realloc(pool->free_ids, id_size);
+  pool->capacity = capacity;
+}
+
+void Scratch_ReserveClonePool(ScratchClonePool* pool, int capacity) {
+  while (pool->capacity < capacity) {
+    Scratch_GrowClonePool(pool);
+  }
+}
+
+ScratchCloneId Scratch_CreateClone(
+    ScratchClonePool* pool,
+    ScratchNumber x,
+    ScratchNumber y,
+    ScratchNumber direction_x,
+    ScratchNumber direction_y) {
+  if (pool->count == pool->capacity) {
+    Scratch_GrowClonePool(pool);
+  }
+
+  ScratchCloneId id;
+  if (pool->free_ids_count > 0) {
+    id = pool->free_ids[--pool->free_ids_count];
+  } else {
+    id = pool->ids_count++;
+  }
+
+  int index = pool->count++;
+  pool->x[index] = x;
+  pool->y[index] = y;
+  pool->direction_x[index] = direction_x;
+  pool->direction_y[index] = direction_y;
+  pool->ids[index] = id;
+  pool->indices[id] = index;
+
+  return id;
+}
+
+static void Scratch_MoveClone(ScratchClonePool* pool, int from, int to) {
+  pool->x[to] = pool->x[from];
+  pool->y[to] = pool->y[from];
+  pool->direction_x[to] = pool->direction_x[from];
+  pool->direction_y[to] = pool->direction_y[from];
+  pool->ids[to] = pool->ids[from];
+  pool->indices[pool->ids[to]] = to;
+}
+
+void Scratch_DeleteClone(ScratchClonePool* pool, ScratchCloneId id) {
+  int index = pool->indices[id];
+  if (index < pool->started_count) {
+    // The last started clone fills the hole, the hole moves to the first clone that hasn't started.
+    int last_started = --pool->started_count;
+    if (index != last_started) {
+      Scratch_MoveClone(pool, last_started, index);
+    }
+    index = last_started;
+  }
+  int last = --pool->count;
+  if (index != last) {
+    Scratch_MoveClone(pool, last, index);
+  }
+
+  pool->indices[id] = -1;
+  pool->free_ids[pool->free_ids_count++] = id;
+}
+
+void Scratch_DeleteAllClones(ScratchClonePool* pool) {
+  pool->count = 0;
+  pool->started_count = 0;
+  pool->free_ids_count = 0;
+  pool->ids_count = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef SCRATCH_VM_INCLUDE_CLONES_H_
+#define SCRATCH_VM_INCLUDE_CLONES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stable identifier of a clone, valid until the clone is deleted. Ids of deleted clones are reused.
+typedef int ScratchCloneId;
+
+// Clones of a single sprite stored as structure-of-arrays columns.
+//
+// Columns are dense: clones occupy indices [0, count), so per-clone code iterates over them linearly,
+// e.g. `for (int i = 0; i < pool->count; ++i) pool->x[i] += dx;`.
+// Deleting a clone moves the last clone into its place, so the order of clones changes on delete and column
+// indices are not stable. Use ScratchCloneId to refer to a particular clone.
+//
+// Started clones, which ran their "when I start as a clone" scripts, come before the ones created since, and
+// deleting a clone keeps them so.
+//
+// Zero initialized pool is a valid empty pool.
+typedef struct ScratchClonePool {
+  // Columns, indexed by clone index.
+  ScratchNumber* x;
+  ScratchNumber* y;
+  ScratchNumber* direction_x;
+  ScratchNumber* direction_y;
+  ScratchCloneId* ids;
+
+  // Indexed by ScratchCloneId, index of the clone in columns.
+  int* indices;
+  // Stack of ids of deleted clones.
+  ScratchCloneId* free_ids;
+  int free_ids_count;
+  // Number of ids ever handed out.
+  int ids_count;
+
+  int count;
+  int capacity;
+  // Clones [started_count, count) haven't started yet. Generated programs start them in the end of the tick.
+  int started_count;
+} ScratchClonePool;
+
+extern void Scratch_InitClonePool(ScratchClonePool* pool);
+extern void Scratch_FreeClonePool(ScratchClonePool* pool);
+// Grows columns to hold at least |capacity| clones.
+extern void Scratch_ReserveClonePool(ScratchClonePool* pool, int capacity);
+
+// Amortized O(1), columns grow by doubling.
+extern ScratchCloneId Scratch_CreateClone(
+    ScratchClonePool* pool,
+    ScratchNumber x,
+    ScratchNumber y,
+    ScratchNumber direction_x,
+    ScratchNumber direction_y);
+// O(1), moves at most two clones.
+extern void Scratch_DeleteClone(ScratchClonePool* pool, ScratchCloneId id);
+extern void Scratch_DeleteAllClones(ScratchClonePool* pool);
+
+static inline int Scratch_GetCloneIndex(const ScratchClonePool* pool, ScratchCloneId id) {
+  return pool->indices[id];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_CLONES_H_
@@ -0,0 +1,50 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-columns.h"
+#endif
+
+#if !defined(SCRATCH_VM_NO_SIMD) && defined(__AVX2__)
+#define SCRATCH_VM_COLUMNS_AVX2
+#include <immintrin.h>
+#elif !defined(SCRATCH_VM_NO_SIMD) && defined(__SSE2__)
+#define SCRATCH_VM_COLUMNS_SSE2
+#include <emmintrin.h>
+#endif
+
+_Static_assert(sizeof(ScratchNumber) == sizeof(double), "Column kernels work on doubles");
+
+void Scratch_FillColumn(ScratchNumber* column, int count, ScratchNumber value) {
+  int i = 0;
+#if defined(SCRATCH_VM_COLUMNS_AVX2)
+  __m256d values = _mm256_set1_pd(value);
+  for (; i + 4 <= count; i += 4) {
+    _mm256_storeu_pd(column + i, values);
+  }
+#elif defined(SCRATCH_VM_COLUMNS_SSE2)
+  __m128d values = _mm_set1_pd(value);
+  for (; i + 2 <= count; i += 2) {
+    _mm_storeu_pd(column + i, values);
+  }
+#endif
+  for (; i < count; ++i) {
+    column[i] = value;
+  }
+}
+
+void Scratch_AddToColumn(ScratchNumber* column, int count, ScratchNumber delta) {
+  int i = 0;
+#if defined(SCRATCH_VM_COLUMNS_AVX2)
+  __m256d deltas = _mm256_set1_pd(delta);
+  for (; i + 4 <= count; i += 4) {
+    _mm256_storeu_pd(column + i, _mm256_add_pd(_mm256_loadu_pd(column + i), deltas));
+  }
+#elif defined(SCRATCH_VM_COLUMNS_SSE2)
+  __m128d deltas = _mm_set1_pd(delta);
+  for (; i + 2 <= count; i += 2) {
+    _mm_storeu_pd(column + i, _mm_add_pd(_mm_loadu_pd(column + i), deltas));
+  }
+#endif
+  for (; i < count; ++i) {
+    column[i] += delta;
+  }
+}
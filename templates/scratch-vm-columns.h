@@ -0,0 +1,18 @@
+#ifndef SCRATCH_VM_INCLUDE_COLUMNS_H_
+#define SCRATCH_VM_INCLUDE_COLUMNS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kernels over contiguous columns of numbers, e.g. positions of clones in ScratchClonePool.
+// Vectorized with AVX2 or SSE2 when the compiler targets them, scalar otherwise or when SCRATCH_VM_NO_SIMD
+// is defined.
+extern void Scratch_FillColumn(ScratchNumber* column, int count, ScratchNumber value);
+extern void Scratch_AddToColumn(ScratchNumber* column, int count, ScratchNumber delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_COLUMNS_H_
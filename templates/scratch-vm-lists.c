@@ -0,0 +1,383 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-arena.h"
+#include "scratch-vm-types.h"
+#include "scratch-vm-variables-public.h"
+#include "scratch-vm-variables-internal.h"
+#include "scratch-vm-lists.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+// Capacity of a list after the first item is added.
+#define SCRATCH_VM_LIST_MIN_CAPACITY 16
+// Shorter lists are scanned even if their index is enabled.
+#define SCRATCH_VM_LIST_INDEX_MIN_COUNT 32
+
+// A value as Scratch compares it: a number, or a string which isn't a number.
+typedef struct ScratchListKey {
+  // 0 for numbers.
+  const char* str;
+  ScratchNumber number;
+} ScratchListKey;
+
+static ScratchListKey Scratch_GetNumberListKey(ScratchNumber number) {
+  ScratchListKey key = {0, number};
+  // NaN isn't a number for Scratch comparisons.
+  if (isnan(number)) {
+    key.str = "NaN";
+  }
+  return key;
+}
+
+static ScratchListKey Scratch_GetListKey(ScratchVariable* value) {
+  if (value->str_storage == kScratchStringStorageNone) {
+    return Scratch_GetNumberListKey(value->number_value);
+  }
+
+  ScratchListKey key = {Scratch_ReadStringVariable(value), 0};
+  if (Scratch_ParseNumber(key.str, &key.number)) {
+    key.str = 0;
+  }
+  return key;
+}
+
+static ScratchListKey Scratch_GetListItemKey(ScratchList* list, int index) {
+  if (list->items) {
+    return Scratch_GetListKey(&list->items[index - 1]);
+  }
+  return Scratch_GetNumberListKey(list->numbers[index - 1]);
+}
+
+// Scratch also matches a number with a string which isn't a number when the number prints as the string in
+// another case, i.e. Infinity with "INFINITY". Such keys are never equal here.
+static int Scratch_ListKeysEqual(ScratchListKey key1, ScratchListKey key2) {
+  if (!key1.str || !key2.str) {
+    return !key1.str && !key2.str && key1.number == key2.number;
+  }
+
+  const unsigned char* s1 = (const unsigned char*)key1.str;
+  const unsigned char* s2 = (const unsigned char*)key2.str;
+  while (*s1 && tolower(*s1) == tolower(*s2)) {
+    ++s1;
+    ++s2;
+  }
+  return tolower(*s1) == tolower(*s2);
+}
+
+static uint32_t Scratch_HashListKey(ScratchListKey key) {
+  if (!key.str) {
+    // -0 equals 0.
+    ScratchNumber number = key.number == 0 ? 0 : key.number;
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdull;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+  }
+
+  uint32_t hash = 2166136261u;
+  for (const unsigned char* c = (const unsigned char*)key.str; *c; ++c) {
+    hash = (hash ^ (unsigned char)tolower(*c)) * 16777619u;
+  }
+  return hash;
+}
+
+// Adds the item at |item_index| unless an earlier item with the same key is there already.
+static void Scratch_InsertIntoListIndex(ScratchList* list, int item_index, ScratchListKey key) {
+  ScratchListIndex* index = &list->index;
+  uint32_t hash = Scratch_HashListKey(key);
+  uint32_t mask = (uint32_t)index->size - 1;
+  uint32_t slot = hash & mask;
+  while (index->slots[slot]) {
+    if (index->hashes[slot] == hash && Scratch_ListKeysEqual(key, Scratch_GetListItemKey(list, index->slots[slot]))) {
+      return;
+    }
+    slot = (slot + 1) & mask;
+  }
+  index->slots[slot] = item_index;
+  index->hashes[slot] = hash;
+  ++index->used;
+}
+
+static void Scratch_RebuildListIndex(ScratchList* list) {
+  ScratchListIndex* index = &list->index;
+  // At most a quarter of slots are used after a rebuild, appends rebuild the index once half of them are.
+  int size = SCRATCH_VM_LIST_MIN_CAPACITY;
+  while (size < 4 * list->count) {
+    size *= 2;
+  }
+  if (size != index->size) {
+    free(index->slots);
+    free(index->hashes);
+    index->slots = malloc(sizeof(int) * (size_t)size);
+    index->hashes = malloc(sizeof(uint32_t) * (size_t)size);
+    index->size = size;
+  }
+  memset(index->slots, 0, sizeof(int) * (size_t)size);
+  index->used = 0;
+  index->is_valid = 1;
+  index->stale_lookups = 0;
+
+  for (int i = 1; i <= list->count; ++i) {
+    Scratch_InsertIntoListIndex(list, i, Scratch_GetListItemKey(list, i));
+  }
+}
+
+static void Scratch_DropListIndex(ScratchList* list) {
+  list->index.is_valid = 0;
+  list->index.stale_lookups = 0;
+}
+
+// Called after an item is appended.
+static void Scratch_UpdateListIndex(ScratchList* list) {
+  ScratchListIndex* index = &list->index;
+  if (!index->is_valid) {
+    return;
+  }
+  if (2 * (index->used + 1) > index->size) {
+    Scratch_RebuildListIndex(list);
+    return;
+  }
+  Scratch_InsertIntoListIndex(list, list->count, Scratch_GetListItemKey(list, list->count));
+}
+
+static int Scratch_UseListIndex(ScratchList* list) {
+  ScratchListIndex* index = &list->index;
+  if (!index->is_enabled || list->count < SCRATCH_VM_LIST_INDEX_MIN_COUNT) {
+    return 0;
+  }
+  if (index->is_valid) {
+    return 1;
+  }
+  if (index->stale_lookups++ == 0) {
+    return 0;
+  }
+  Scratch_RebuildListIndex(list);
+  return 1;
+}
+
+static int Scratch_FindListKey(ScratchList* list, ScratchListKey key) {
+  if (Scratch_UseListIndex(list)) {
+    ScratchListIndex* index = &list->index;
+    uint32_t hash = Scratch_HashListKey(key);
+    uint32_t mask = (uint32_t)index->size - 1;
+    for (uint32_t slot = hash & mask; index->slots[slot]; slot = (slot + 1) & mask) {
+      if (index->hashes[slot] == hash && Scratch_ListKeysEqual(key, Scratch_GetListItemKey(list, index->slots[slot]))) {
+        return index->slots[slot];
+      }
+    }
+    return 0;
+  }
+
+  if (!list->items && !key.str) {
+    // Numbers only, a plain scan of the array.
+    const ScratchNumber* numbers = list->numbers;
+    for (int i = 0; i < list->count; ++i) {
+      if (numbers[i] == key.number) {
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+
+  for (int i = 1; i <= list->count; ++i) {
+    if (Scratch_ListKeysEqual(key, Scratch_GetListItemKey(list, i))) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+void Scratch_InitList(ScratchList* list) {
+  list->numbers = 0;
+  list->items = 0;
+  list->count = 0;
+  list->capacity = 0;
+
+  list->index.slots = 0;
+  list->index.hashes = 0;
+  list->index.size = 0;
+  list->index.used = 0;
+  list->index.is_enabled = 0;
+  list->index.is_valid = 0;
+  list->index.stale_lookups = 0;
+}
+
+void Scratch_FreeList(ScratchList* list) {
+  Scratch_DeleteAllOfList(list);
+  free(list->numbers);
+  free(list->index.slots);
+  free(list->index.hashes);
+  Scratch_InitList(list);
+}
+
+void Scratch_EnableListIndex(ScratchList* list) {
+  list->index.is_enabled = 1;
+}
+
+static void Scratch_GrowList(ScratchList* list) {
+  int capacity = list->capacity ? list->capacity * 2 : SCRATCH_VM_LIST_MIN_CAPACITY;
+  if (list->items) {
+    list->items = realloc(list->items, sizeof(ScratchVariable) * (size_t)capacity);
+  } else {
+    list->numbers = realloc(list->numbers, sizeof(ScratchNumber) * (size_t)capacity);
+  }
+  list->capacity = capacity;
+}
+
+// Called before the first string item is stored.
+static void Scratch_MoveListNumbersToItems(ScratchList* list) {
+  if (list->capacity == 0) {
+    list->capacity = SCRATCH_VM_LIST_MIN_CAPACITY;
+  }
+  list->items = malloc(sizeof(ScratchVariable) * (size_t)list->capacity);
+  for (int i = 0; i < list->count; ++i) {
+    Scratch_InitNumberVariable(&list->items[i], list->numbers[i]);
+  }
+  free(list->numbers);
+  list->numbers = 0;
+}
+
+void Scratch_AddNumberToList(ScratchList* list, ScratchNumber number) {
+  if (list->count >= SCRATCH_VM_LIST_ITEM_LIMIT) {
+    return;
+  }
+  if (list->count == list->capacity) {
+    Scratch_GrowList(list);
+  }
+
+  if (list->items) {
+    Scratch_InitNumberVariable(&list->items[list->count], number);
+  } else {
+    list->numbers[list->count] = number;
+  }
+  ++list->count;
+  Scratch_UpdateListIndex(list);
+}
+
+void Scratch_AddToList(ScratchList* list, ScratchVariable* item) {
+  if (item->str_storage == kScratchStringStorageNone) {
+    Scratch_AddNumberToList(list, item->number_value);
+    return;
+  }
+
+  if (list->count >= SCRATCH_VM_LIST_ITEM_LIMIT) {
+    return;
+  }
+  if (!list->items) {
+    Scratch_MoveListNumbersToItems(list);
+  }
+  if (list->count == list->capacity) {
+    Scratch_GrowList(list);
+  }
+
+  Scratch_InitVariable(&list->items[list->count]);
+  Scratch_AssignVariable(&list->items[list->count], item);
+  ++list->count;
+  Scratch_UpdateListIndex(list);
+}
+
+int Scratch_ToListIndex(ScratchList* list, ScratchVariable index, int accept_all) {
+  if (index.str_storage != kScratchStringStorageNone) {
+    const char* str = Scratch_ReadStringVariable(&index);
+    if (strcmp(str, "all") == 0) {
+      return accept_all ? SCRATCH_VM_LIST_INDEX_ALL : SCRATCH_VM_LIST_INVALID_INDEX;
+    }
+    if (strcmp(str, "last") == 0) {
+      return list->count > 0 ? list->count : SCRATCH_VM_LIST_INVALID_INDEX;
+    }
+  }
+  return Scratch_NumberToListIndex(list, Scratch_ReadNumberVariable(&index));
+}
+
+ScratchVariable Scratch_GetListItem(ScratchList* list, int index) {
+  ScratchVariable item;
+  if (index < 1 || index > list->count) {
+    Scratch_InitStringVariable(&item, "", /*is_const_str_value=*/ 1);
+  } else if (list->items) {
+    Scratch_BorrowVariable(&item, &list->items[index - 1]);
+  } else {
+    Scratch_InitNumberVariable(&item, list->numbers[index - 1]);
+  }
+  return item;
+}
+
+void Scratch_ReplaceListItemWithNumber(ScratchList* list, int index, ScratchNumber number) {
+  if (index < 1 || index > list->count) {
+    return;
+  }
+
+  if (list->items) {
+    Scratch_AssignNumberVariable(&list->items[index - 1], number);
+  } else {
+    list->numbers[index - 1] = number;
+  }
+  Scratch_DropListIndex(list);
+}
+
+void Scratch_ReplaceListItem(ScratchList* list, int index, ScratchVariable* item) {
+  if (item->str_storage == kScratchStringStorageNone) {
+    Scratch_ReplaceListItemWithNumber(list, index, item->number_value);
+    return;
+  }
+  if (index < 1 || index > list->count) {
+    return;
+  }
+
+  if (!list->items) {
+    Scratch_MoveListNumbersToItems(list);
+  }
+  Scratch_AssignVariable(&list->items[index - 1], item);
+  Scratch_DropListIndex(list);
+}
+
+void Scratch_DeleteListItem(ScratchList* list, int index) {
+  if (index == SCRATCH_VM_LIST_INDEX_ALL) {
+    Scratch_DeleteAllOfList(list);
+    return;
+  }
+  if (index < 1 || index > list->count) {
+    return;
+  }
+
+  size_t moved = (size_t)(list->count - index);
+  if (list->items) {
+    Scratch_FreeVariable(&list->items[index - 1]);
+    memmove(&list->items[index - 1], &list->items[index], sizeof(ScratchVariable) * moved);
+  } else {
+    memmove(&list->numbers[index - 1], &list->numbers[index], sizeof(ScratchNumber) * moved);
+  }
+  --list->count;
+  Scratch_DropListIndex(list);
+
+  if (list->count == 0) {
+    Scratch_DeleteAllOfList(list);
+  }
+}
+
+// Keeps the storage of numbers, a list of strings becomes a list of numbers again.
+void Scratch_DeleteAllOfList(ScratchList* list) {
+  if (list->items) {
+    for (int i = 0; i < list->count; ++i) {
+      Scratch_FreeVariable(&list->items[i]);
+    }
+    free(list->items);
+    list->items = 0;
+    list->capacity = 0;
+  }
+  list->count = 0;
+  Scratch_DropListIndex(list);
+}
+
+int Scratch_FindListItem(ScratchList* list, ScratchVariable item) {
+  return Scratch_FindListKey(list, Scratch_GetListKey(&item));
+}
+
+int Scratch_FindListNumber(ScratchList* list, ScratchNumber number) {
+  return Scratch_FindListKey(list, Scratch_GetNumberListKey(number));
+}
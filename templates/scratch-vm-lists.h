@@ -0,0 +1,96 @@
+#ifndef SCRATCH_VM_INCLUDE_LISTS_H_
+#define SCRATCH_VM_INCLUDE_LISTS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scratch ignores adding items to lists of this many items.
+#define SCRATCH_VM_LIST_ITEM_LIMIT 200000
+
+// List indices are 1-based like in Scratch. Scratch_ToListIndex returns these for indices Scratch ignores and
+// for "all" of `delete (all) of [list]`.
+#define SCRATCH_VM_LIST_INVALID_INDEX 0
+#define SCRATCH_VM_LIST_INDEX_ALL (-1)
+
+// Hash index of list items for Scratch_FindListItem: open addressing with linear probing.
+// Zero initialized index is a valid disabled index.
+typedef struct ScratchListIndex {
+  // 1-based indices of the first item with every key, 0 for empty slots.
+  int* slots;
+  uint32_t* hashes;
+  // Number of slots, a power of two.
+  int size;
+  int used;
+  int is_enabled;
+  // Only appends keep the index valid, any other change drops it until the next lookup rebuilds it.
+  int is_valid;
+  // Lookups since the index was dropped. The first one scans items, so a list changed between every two
+  // lookups is never rebuilt for nothing.
+  int stale_lookups;
+} ScratchListIndex;
+
+// A Scratch list with contiguous items.
+//
+// Lists of numbers only keep them in |numbers|, so numeric lists are plain arrays of ScratchNumber. The first
+// string item moves all the items to |items|, the list goes back to numbers once all its items are deleted.
+// Storage grows by doubling, appends are amortized O(1).
+//
+// Zero initialized list is a valid empty list.
+typedef struct ScratchList {
+  ScratchNumber* numbers;
+  ScratchVariable* items;
+  int count;
+  int capacity;
+  ScratchListIndex index;
+} ScratchList;
+
+extern void Scratch_InitList(ScratchList* list);
+extern void Scratch_FreeList(ScratchList* list);
+// Makes Scratch_FindListItem and Scratch_FindListNumber use a hash index of items. The transpiler enables it
+// for lists searched with `item # of (thing) in [list]`.
+extern void Scratch_EnableListIndex(ScratchList* list);
+
+extern void Scratch_AddNumberToList(ScratchList* list, ScratchNumber number);
+// The value of |item| is copied.
+extern void Scratch_AddToList(ScratchList* list, ScratchVariable* item);
+
+// Converts an index the way Scratch does: numbers are floored, "last" is the last item, "all" is
+// SCRATCH_VM_LIST_INDEX_ALL if |accept_all| is set. Returns SCRATCH_VM_LIST_INVALID_INDEX for anything else and
+// indices out of the list, "random" and "any" included.
+// Generic inputs are passed by value like to Scratch_ToNumber, so generated expressions call them directly.
+extern int Scratch_ToListIndex(ScratchList* list, ScratchVariable index, int accept_all);
+
+static inline int Scratch_NumberToListIndex(const ScratchList* list, ScratchNumber index) {
+  // Also false for NaN.
+  if (!(index >= 1 && index < (ScratchNumber)list->count + 1)) {
+    return SCRATCH_VM_LIST_INVALID_INDEX;
+  }
+  return (int)index;
+}
+
+static inline int Scratch_GetListLength(const ScratchList* list) {
+  return list->count;
+}
+
+// An empty string for invalid indices. String items are borrowed, see Scratch_BorrowVariable.
+extern ScratchVariable Scratch_GetListItem(ScratchList* list, int index);
+// Invalid indices are ignored.
+extern void Scratch_ReplaceListItemWithNumber(ScratchList* list, int index, ScratchNumber number);
+extern void Scratch_ReplaceListItem(ScratchList* list, int index, ScratchVariable* item);
+// Deletes every item for SCRATCH_VM_LIST_INDEX_ALL, ignores invalid indices. O(count - index).
+extern void Scratch_DeleteListItem(ScratchList* list, int index);
+extern void Scratch_DeleteAllOfList(ScratchList* list);
+
+// 1-based index of the first item equal to |item|, 0 if there is none. Items are compared like Scratch does:
+// as numbers if both are numbers, otherwise as case insensitive strings.
+extern int Scratch_FindListItem(ScratchList* list, ScratchVariable item);
+extern int Scratch_FindListNumber(ScratchList* list, ScratchNumber number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_LISTS_H_
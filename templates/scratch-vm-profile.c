@@ -0,0 +1,63 @@
+// All includes should be below these defines
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE
+
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-profile.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#endif
+
+// Block IDs may contain any printable character, e.g. commas and quotes.
+static void Scratch_WriteProfileString(FILE* file, const char* str, ScratchProfileFormat format) {
+  fputc('"', file);
+  for (; *str; ++str) {
+    if (*str == '"') {
+      fputs(format == kScratchProfileFormatCsv ? "\"\"" : "\\\"", file);
+    } else if (*str == '\\' && format == kScratchProfileFormatJson) {
+      fputs("\\\\", file);
+    } else if ((unsigned char)*str < 0x20 && format == kScratchProfileFormatJson) {
+      fprintf(file, "\\u%04x", (unsigned)(unsigned char)*str);
+    } else {
+      fputc(*str, file);
+    }
+  }
+  fputc('"', file);
+}
+
+void Scratch_WriteProfile(
+    FILE* file,
+    ScratchProfileFormat format,
+    const ScratchProfileSite* sites,
+    const ScratchProfileCounter* counters,
+    int count) {
+  if (format == kScratchProfileFormatCsv) {
+    fputs("block_id,block_opcode,sprite,function,calls,cycles\n", file);
+    for (int i = 0; i < count; ++i) {
+      Scratch_WriteProfileString(file, sites[i].block_id, format);
+      fputc(',', file);
+      Scratch_WriteProfileString(file, sites[i].block_op_code, format);
+      fputc(',', file);
+      Scratch_WriteProfileString(file, sites[i].sprite_name, format);
+      fputc(',', file);
+      Scratch_WriteProfileString(file, sites[i].function_name, format);
+      fprintf(file, ",%" PRIu64 ",%" PRIu64 "\n", counters[i].calls, counters[i].cycles);
+    }
+    return;
+  }
+
+  fputc('[', file);
+  for (int i = 0; i < count; ++i) {
+    fputs(i ? ",\n  {\"block_id\": " : "\n  {\"block_id\": ", file);
+    Scratch_WriteProfileString(file, sites[i].block_id, format);
+    fputs(", \"block_opcode\": ", file);
+    Scratch_WriteProfileString(file, sites[i].block_op_code, format);
+    fputs(", \"sprite\": ", file);
+    Scratch_WriteProfileString(file, sites[i].sprite_name, format);
+    fputs(", \"function\": ", file);
+    Scratch_WriteProfileString(file, sites[i].function_name, format);
+    fprintf(file, ", \"calls\": %" PRIu64 ", \"cycles\": %" PRIu64 "}", counters[i].calls, counters[i].cycles);
+  }
+  fputs(count ? "\n]\n" : "]\n", file);
+}
@@ -0,0 +1,66 @@
+#ifndef SCRATCH_VM_INCLUDE_PROFILE_H_
+#define SCRATCH_VM_INCLUDE_PROFILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ScratchProfileFormat {
+  // A header line, then a line per function.
+  kScratchProfileFormatCsv = 0,
+  // An array of objects, an object per function.
+  kScratchProfileFormatJson = 1,
+} ScratchProfileFormat;
+
+// A generated function counted by the profiler.
+typedef struct ScratchProfileSite {
+  // ID of the Scratch block implemented by the function, the key of the block in project.json.
+  const char* block_id;
+  // Opcode of that block in project.json.
+  const char* block_op_code;
+  const char* sprite_name;
+  const char* function_name;
+} ScratchProfileSite;
+
+typedef struct ScratchProfileCounter {
+  uint64_t calls;
+  // Inclusive: the cycles of a function contain the cycles of the functions it calls.
+  uint64_t cycles;
+} ScratchProfileCounter;
+
+// Time stamp counter on x86, nanoseconds of the monotonic clock elsewhere.
+static inline uint64_t Scratch_ReadCycleCounter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static inline void Scratch_CountProfileSample(ScratchProfileCounter* counter, uint64_t start_cycles) {
+  counter->calls += 1;
+  counter->cycles += Scratch_ReadCycleCounter() - start_cycles;
+}
+
+extern void Scratch_WriteProfile(
+    FILE* file,
+    ScratchProfileFormat format,
+    const ScratchProfileSite* sites,
+    const ScratchProfileCounter* counters,
+    int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_PROFILE_H_
@@ -0,0 +1,56 @@
+#ifndef SCRATCH_VM_INCLUDE_RENDER_H_
+#define SCRATCH_VM_INCLUDE_RENDER_H_
+
+// Included into the public header of generated programs after scratch-vm-types.h and scratch-vm-clones.h.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A costume in the atlas: its image and the rotation center are in pixels of the atlas, from the top left.
+typedef struct ScratchCostume {
+  const char* name;
+  int x;
+  int y;
+  int width;
+  int height;
+  ScratchNumber rotation_center_x;
+  ScratchNumber rotation_center_y;
+  // Pixels per stage unit, e.g. 2 for Scratch bitmaps.
+  ScratchNumber resolution;
+} ScratchCostume;
+
+// Costumes of every target packed by the transpiler into a single image, see SCRATCH_PROGRAM_ATLAS_FILE.
+// Empty for programs transpiled without --atlas.
+typedef struct ScratchAtlas {
+  int width;
+  int height;
+  const ScratchCostume* costumes;
+  int costume_count;
+} ScratchAtlas;
+
+// A target as a host draws it. Positions point into the context, so hosts read them on every frame instead of
+// copying them after every tick.
+//
+// Stage coordinates are Scratch ones: the origin is in the center of the 480x360 stage, y grows upwards. The
+// direction is the unit vector the target points to, (1, 0) for Scratch direction 90, in which costumes are
+// drawn unrotated.
+typedef struct ScratchRenderTarget {
+  const ScratchNumber* x;
+  const ScratchNumber* y;
+  const ScratchNumber* direction_x;
+  const ScratchNumber* direction_y;
+  // Clones of the sprite, drawn with its costume right below it. 0 for the stage.
+  const ScratchClonePool* clones;
+  // Index in ScratchAtlas::costumes, -1 for targets without costumes.
+  int costume;
+  // Size of the target, 1 for 100%.
+  ScratchNumber scale;
+  int is_visible;
+} ScratchRenderTarget;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_RENDER_H_
@@ -0,0 +1,219 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-variables-public.h"
+#include "scratch-vm-variables-internal.h"
+#include "scratch-vm-clones.h"
+#include "scratch-vm-lists.h"
+#include "scratch-vm-state.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#endif
+
+// Size of every field in a state blob.
+#define SCRATCH_VM_STATE_FIELD_SIZE 8
+
+_Static_assert(sizeof(ScratchNumber) == SCRATCH_VM_STATE_FIELD_SIZE, "Numbers are stored as a single field");
+_Static_assert(sizeof(ScratchStateHeader) % SCRATCH_VM_STATE_FIELD_SIZE == 0, "Fields after the header are aligned");
+
+void Scratch_WriteStateBytes(ScratchStateWriter* writer, const void* bytes, size_t size) {
+  if (writer->size + size <= writer->capacity) {
+    memcpy(writer->data + writer->size, bytes, size);
+  }
+  writer->size += size;
+}
+
+void Scratch_WriteStateInt(ScratchStateWriter* writer, int64_t value) {
+  Scratch_WriteStateBytes(writer, &value, sizeof(value));
+}
+
+void Scratch_WriteStateWord(ScratchStateWriter* writer, uint64_t value) {
+  Scratch_WriteStateBytes(writer, &value, sizeof(value));
+}
+
+void Scratch_WriteStateNumber(ScratchStateWriter* writer, ScratchNumber value) {
+  Scratch_WriteStateBytes(writer, &value, sizeof(value));
+}
+
+void Scratch_WriteStateVariable(ScratchStateWriter* writer, ScratchVariable* variable) {
+  if (variable->str_storage == kScratchStringStorageNone) {
+    Scratch_WriteStateInt(writer, 0);
+    Scratch_WriteStateNumber(writer, variable->number_value);
+    return;
+  }
+
+  const char* str = Scratch_ReadStringVariable(variable);
+  size_t size = strlen(str);
+  Scratch_WriteStateInt(writer, 1);
+  Scratch_WriteStateInt(writer, (int64_t)size);
+  // The terminating zero and the padding.
+  static const char kZeros[SCRATCH_VM_STATE_FIELD_SIZE] = {0};
+  Scratch_WriteStateBytes(writer, str, size);
+  Scratch_WriteStateBytes(writer, kZeros, SCRATCH_VM_STATE_FIELD_SIZE - size % SCRATCH_VM_STATE_FIELD_SIZE);
+}
+
+// Ids of deleted clones are saved too, so ids of live clones stay valid after a load.
+void Scratch_WriteStateClonePool(ScratchStateWriter* writer, const ScratchClonePool* pool) {
+  Scratch_WriteStateInt(writer, pool->count);
+  Scratch_WriteStateInt(writer, pool->ids_count);
+  Scratch_WriteStateInt(writer, pool->free_ids_count);
+  for (int i = 0; i < pool->count; ++i) {
+    Scratch_WriteStateNumber(writer, pool->x[i]);
+    Scratch_WriteStateNumber(writer, pool->y[i]);
+    Scratch_WriteStateNumber(writer, pool->direction_x[i]);
+    Scratch_WriteStateNumber(writer, pool->direction_y[i]);
+    Scratch_WriteStateInt(writer, pool->ids[i]);
+  }
+  for (int i = 0; i < pool->free_ids_count; ++i) {
+    Scratch_WriteStateInt(writer, pool->free_ids[i]);
+  }
+}
+
+// Items are written as variables, a list of numbers reads back as one.
+void Scratch_WriteStateList(ScratchStateWriter* writer, ScratchList* list) {
+  Scratch_WriteStateInt(writer, list->count);
+  for (int i = 1; i <= list->count; ++i) {
+    ScratchVariable item = Scratch_GetListItem(list, i);
+    Scratch_WriteStateVariable(writer, &item);
+  }
+}
+
+const void* Scratch_ReadStateBytes(ScratchStateReader* reader, size_t size) {
+  if (reader->failed || size > reader->size - reader->offset) {
+    reader->failed = 1;
+    return 0;
+  }
+  const void* bytes = reader->data + reader->offset;
+  reader->offset += size;
+  return bytes;
+}
+
+int Scratch_ReadStateInt(ScratchStateReader* reader, int min, int max) {
+  int64_t value = 0;
+  const void* bytes = Scratch_ReadStateBytes(reader, sizeof(value));
+  if (!bytes) {
+    return 0;
+  }
+  memcpy(&value, bytes, sizeof(value));
+  if (value < min || value > max) {
+    reader->failed = 1;
+    return 0;
+  }
+  return (int)value;
+}
+
+uint64_t Scratch_ReadStateWord(ScratchStateReader* reader) {
+  uint64_t value = 0;
+  const void* bytes = Scratch_ReadStateBytes(reader, sizeof(value));
+  if (bytes) {
+    memcpy(&value, bytes, sizeof(value));
+  }
+  return value;
+}
+
+uint64_t Scratch_ReadStateBits(ScratchStateReader* reader, uint64_t valid_bits) {
+  uint64_t value = Scratch_ReadStateWord(reader);
+  if (value & ~valid_bits) {
+    reader->failed = 1;
+    return 0;
+  }
+  return value;
+}
+
+ScratchNumber Scratch_ReadStateNumber(ScratchStateReader* reader) {
+  ScratchNumber value = 0;
+  const void* bytes = Scratch_ReadStateBytes(reader, sizeof(value));
+  if (bytes) {
+    memcpy(&value, bytes, sizeof(value));
+  }
+  return value;
+}
+
+void Scratch_ReadStateVariable(ScratchStateReader* reader, ScratchVariable* variable) {
+  int is_string = Scratch_ReadStateInt(reader, 0, 1);
+  if (!is_string) {
+    ScratchNumber value = Scratch_ReadStateNumber(reader);
+    if (!reader->failed) {
+      Scratch_AssignNumberVariable(variable, value);
+    }
+    return;
+  }
+
+  int size = Scratch_ReadStateInt(reader, 0, INT_MAX - SCRATCH_VM_STATE_FIELD_SIZE);
+  const char* str = Scratch_ReadStateBytes(
+      reader, (size_t)size + SCRATCH_VM_STATE_FIELD_SIZE - (size_t)size % SCRATCH_VM_STATE_FIELD_SIZE);
+  if (!str || str[size] != 0) {
+    reader->failed = 1;
+    return;
+  }
+  // The blob may be a read only mapping, the string is copied.
+  Scratch_AssignStringVariable(variable, str);
+}
+
+void Scratch_ReadStateClonePool(ScratchStateReader* reader, ScratchClonePool* pool) {
+  // Counts are bounded by the size of the rest of the blob before anything is allocated.
+  const int max_count = (int)((reader->size - reader->offset) / SCRATCH_VM_STATE_FIELD_SIZE);
+  int count = Scratch_ReadStateInt(reader, 0, max_count);
+  int ids_count = Scratch_ReadStateInt(reader, count, max_count);
+  int free_ids_count = Scratch_ReadStateInt(reader, 0, ids_count);
+  if (reader->failed || count + free_ids_count != ids_count) {
+    reader->failed = 1;
+    return;
+  }
+
+  Scratch_DeleteAllClones(pool);
+  Scratch_ReserveClonePool(pool, ids_count);
+  for (int id = 0; id < ids_count; ++id) {
+    pool->indices[id] = -1;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    pool->x[i] = Scratch_ReadStateNumber(reader);
+    pool->y[i] = Scratch_ReadStateNumber(reader);
+    pool->direction_x[i] = Scratch_ReadStateNumber(reader);
+    pool->direction_y[i] = Scratch_ReadStateNumber(reader);
+    ScratchCloneId id = Scratch_ReadStateInt(reader, 0, ids_count - 1);
+    if (reader->failed || pool->indices[id] != -1) {
+      reader->failed = 1;
+      return;
+    }
+    pool->ids[i] = id;
+    pool->indices[id] = i;
+  }
+  for (int i = 0; i < free_ids_count; ++i) {
+    ScratchCloneId id = Scratch_ReadStateInt(reader, 0, ids_count - 1);
+    // Every id is either live or free, never both.
+    if (reader->failed || pool->indices[id] != -1) {
+      reader->failed = 1;
+      return;
+    }
+    pool->free_ids[i] = id;
+    pool->indices[id] = -2;
+  }
+  for (int i = 0; i < free_ids_count; ++i) {
+    pool->indices[pool->free_ids[i]] = -1;
+  }
+
+  pool->count = count;
+  pool->ids_count = ids_count;
+  pool->free_ids_count = free_ids_count;
+}
+
+void Scratch_ReadStateList(ScratchStateReader* reader, ScratchList* list) {
+  // Every item takes at least two fields.
+  int max_count = (int)((reader->size - reader->offset) / (2 * SCRATCH_VM_STATE_FIELD_SIZE));
+  if (max_count > SCRATCH_VM_LIST_ITEM_LIMIT) {
+    max_count = SCRATCH_VM_LIST_ITEM_LIMIT;
+  }
+  int count = Scratch_ReadStateInt(reader, 0, max_count);
+
+  Scratch_DeleteAllOfList(list);
+  ScratchVariable item;
+  Scratch_InitVariable(&item);
+  for (int i = 0; i < count && !reader->failed; ++i) {
+    Scratch_ReadStateVariable(reader, &item);
+    Scratch_AddToList(list, &item);
+  }
+  Scratch_FreeVariable(&item);
+}
@@ -0,0 +1,79 @@
+#ifndef SCRATCH_VM_INCLUDE_STATE_H_
+#define SCRATCH_VM_INCLUDE_STATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Layout of blobs written by Scratch_SaveState, bump on any change of it.
+#define SCRATCH_VM_STATE_FORMAT_VERSION 1
+// "SCVM" read as a little endian uint32, blobs written with the other byte order don't match.
+#define SCRATCH_VM_STATE_MAGIC 0x4d564353u
+
+typedef enum ScratchLoadStateResult {
+  kScratchLoadStateOk = 0,
+  // Not a state blob, or a truncated or corrupted one.
+  kScratchLoadStateInvalid = 1,
+  // Written with another SCRATCH_VM_STATE_FORMAT_VERSION.
+  kScratchLoadStateUnsupportedVersion = 2,
+  // Written by another program, or by the same program transpiled with other options.
+  kScratchLoadStateOtherProgram = 3,
+} ScratchLoadStateResult;
+
+// A state blob is this header followed by 8 byte fields: integers are int64_t, numbers are ScratchNumber,
+// strings are their size followed by their bytes, the terminating zero and padding to 8 bytes.
+// Fields are in the native byte order and stay aligned in a blob aligned to 8 bytes, e.g. in a memory
+// mapped file.
+typedef struct ScratchStateHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t program_hash;
+  // Size of the whole blob, including the header.
+  uint64_t size;
+} ScratchStateHeader;
+
+// Bytes past |capacity| are counted but not written, so a writer without a buffer measures a blob.
+typedef struct ScratchStateWriter {
+  unsigned char* data;
+  size_t capacity;
+  size_t size;
+} ScratchStateWriter;
+
+// Reads past the end of a blob or of impossible values set |failed| and return zeros.
+typedef struct ScratchStateReader {
+  const unsigned char* data;
+  size_t size;
+  size_t offset;
+  int failed;
+} ScratchStateReader;
+
+extern void Scratch_WriteStateBytes(ScratchStateWriter* writer, const void* bytes, size_t size);
+extern void Scratch_WriteStateInt(ScratchStateWriter* writer, int64_t value);
+extern void Scratch_WriteStateWord(ScratchStateWriter* writer, uint64_t value);
+extern void Scratch_WriteStateNumber(ScratchStateWriter* writer, ScratchNumber value);
+extern void Scratch_WriteStateVariable(ScratchStateWriter* writer, ScratchVariable* variable);
+extern void Scratch_WriteStateClonePool(ScratchStateWriter* writer, const ScratchClonePool* pool);
+extern void Scratch_WriteStateList(ScratchStateWriter* writer, ScratchList* list);
+
+extern const void* Scratch_ReadStateBytes(ScratchStateReader* reader, size_t size);
+// Fails for values outside of [min, max].
+extern int Scratch_ReadStateInt(ScratchStateReader* reader, int min, int max);
+extern uint64_t Scratch_ReadStateWord(ScratchStateReader* reader);
+// Fails for words with bits outside of |valid_bits| set.
+extern uint64_t Scratch_ReadStateBits(ScratchStateReader* reader, uint64_t valid_bits);
+extern ScratchNumber Scratch_ReadStateNumber(ScratchStateReader* reader);
+// |variable| must be initialized, it is assigned the read value.
+extern void Scratch_ReadStateVariable(ScratchStateReader* reader, ScratchVariable* variable);
+// |pool| must be initialized, its clones are replaced with the read ones.
+extern void Scratch_ReadStateClonePool(ScratchStateReader* reader, ScratchClonePool* pool);
+// |list| must be initialized, its items are replaced with the read ones.
+extern void Scratch_ReadStateList(ScratchStateReader* reader, ScratchList* list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_STATE_H_
@@ -0,0 +1,59 @@
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-types.h"
+#include "scratch-vm-timers.h"
+#endif
+
+// Puts |timer| into the hole at |index| of a heap of |size| timers, moving it up or down to keep the order.
+static void Scratch_PlaceTimer(ScratchTimer* heap, int size, int index, ScratchTimer timer) {
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (heap[parent].deadline <= timer.deadline) {
+      break;
+    }
+    heap[index] = heap[parent];
+    index = parent;
+  }
+  for (;;) {
+    int child = 2 * index + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && heap[child + 1].deadline < heap[child].deadline) {
+      ++child;
+    }
+    if (timer.deadline <= heap[child].deadline) {
+      break;
+    }
+    heap[index] = heap[child];
+    index = child;
+  }
+  heap[index] = timer;
+}
+
+void Scratch_PushTimer(ScratchTimer* heap, int* size, ScratchTimer timer) {
+  int index = (*size)++;
+  Scratch_PlaceTimer(heap, *size, index, timer);
+}
+
+ScratchTimer Scratch_PopTimer(ScratchTimer* heap, int* size) {
+  ScratchTimer top = heap[0];
+  --(*size);
+  if (*size > 0) {
+    Scratch_PlaceTimer(heap, *size, 0, heap[*size]);
+  }
+  return top;
+}
+
+int Scratch_RemoveTimer(ScratchTimer* heap, int* size, int program) {
+  for (int index = 0; index < *size; ++index) {
+    if (heap[index].program != program) {
+      continue;
+    }
+    --(*size);
+    if (index < *size) {
+      Scratch_PlaceTimer(heap, *size, index, heap[*size]);
+    }
+    return 1;
+  }
+  return 0;
+}
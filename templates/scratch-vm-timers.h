@@ -0,0 +1,60 @@
+#ifndef SCRATCH_VM_INCLUDE_TIMERS_H_
+#define SCRATCH_VM_INCLUDE_TIMERS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Wake up time of a sleeping program.
+typedef struct ScratchTimer {
+  ScratchNumber deadline;
+  int program;
+} ScratchTimer;
+
+// Binary min-heap of timers ordered by deadline. |heap| is owned by the caller and must have room for all
+// the timers, every program sleeps in at most a single timer.
+extern void Scratch_PushTimer(ScratchTimer* heap, int* size, ScratchTimer timer);
+extern ScratchTimer Scratch_PopTimer(ScratchTimer* heap, int* size);
+// Removes the timer of |program| if there is one, returns whether there was. O(size), for programs woken up
+// before their deadline, e.g. restarted by a broadcast.
+extern int Scratch_RemoveTimer(ScratchTimer* heap, int* size, int program);
+
+// Sets of programs are bitsets of 64 bit words.
+#define SCRATCH_VM_PROGRAM_SET_WORDS(count) (((count) + 63) / 64)
+// Bits of programs below |count| in the word |word| of a set.
+#define SCRATCH_VM_PROGRAM_SET_WORD_MASK(count, word) \
+  ((word) < (count) / 64 ? ~(uint64_t)0 : ((uint64_t)1 << ((count) % 64)) - 1)
+
+static inline void Scratch_AddToProgramSet(uint64_t* set, int program) {
+  set[program / 64] |= (uint64_t)1 << (program % 64);
+}
+
+static inline void Scratch_RemoveFromProgramSet(uint64_t* set, int program) {
+  set[program / 64] &= ~((uint64_t)1 << (program % 64));
+}
+
+static inline int Scratch_IsInProgramSet(const uint64_t* set, int program) {
+  return (set[program / 64] >> (program % 64)) & 1;
+}
+
+// Index of the lowest set bit of a non-zero |bits|.
+static inline int Scratch_LowestProgramInWord(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef SCRATCH_VM_INCLUDE_TIMERS_H_
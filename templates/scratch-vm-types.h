@@ -7,6 +7,9 @@ extern "C" {
 
 typedef double ScratchNumber;
 
+// State of a single instance of a transpiled program. Defined by the generated code.
+typedef struct ScratchContext ScratchContext;
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,28 +1,68 @@
 #ifndef SCRATCH_VM_INCLUDE_VARIABLES_INTERNAL_H_
 #define SCRATCH_VM_INCLUDE_VARIABLES_INTERNAL_H_
 
+#if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-arena.h"
 #include "scratch-vm-types.h"
 #include "scratch-vm-variables-public.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Frees the string owned by |variable| if any and makes it a number, keeps |number_value|.
+extern void Scratch_ReleaseStringVariable(ScratchVariable* variable);
+
 extern void Scratch_InitVariable(ScratchVariable* variable);
-extern void Scratch_InitNumberVariable(ScratchVariable* variable, ScratchNumber number_value);
 extern void Scratch_InitStringVariable(ScratchVariable* variable, const char* str, int is_const_str_value);
 
-extern void Scratch_AssignNumberVariable(ScratchVariable* variable, ScratchNumber number);
 extern void Scratch_AssignStringVariable(ScratchVariable* variable, const char* str);
 extern void Scratch_AssignVariable(ScratchVariable* variable, ScratchVariable* rhv);
 
-extern ScratchNumber Scratch_ReadNumberVariable(ScratchVariable* variable);
-extern const char* Scratch_ReadStringVariable(ScratchVariable* variable);
+// Static initializers of the values Scratch_InitNumberVariable and Scratch_InitStringVariable of a const string
+// set, for variables in read-only data.
+#define SCRATCH_VM_NUMBER_VARIABLE_INIT(number) \
+  { .number_value = (number), .str_value = 0, .str_storage = kScratchStringStorageNone, .cached = 0 }
+#define SCRATCH_VM_CONST_STRING_VARIABLE_INIT(str) \
+  { .number_value = 0, .str_value = (str), .str_storage = kScratchStringStorageInterned, .cached = 0 }
+
+// Number stores and borrows are inline, only releasing a string leaves generated code.
+static inline void Scratch_InitNumberVariable(ScratchVariable* variable, ScratchNumber number_value) {
+  variable->number_value = number_value;
+  variable->cached = 0;
 
-extern ScratchVariable Scratch_JoinStringVariables(ScratchVariable* variable1, ScratchVariable* variable2);
+  variable->str_value = 0;
+  variable->str_storage = kScratchStringStorageNone;
+}
+
+static inline void Scratch_AssignNumberVariable(ScratchVariable* variable, ScratchNumber number) {
+  variable->number_value = number;
+  variable->cached = 0;
+
+  if (variable->str_storage != kScratchStringStorageNone) {
+    Scratch_ReleaseStringVariable(variable);
+  }
+}
+
+// Makes |variable| a temporary view of |source| without copying heap strings.
+// |variable| must not outlive the current tick or the next assignment to |source|.
+static inline void Scratch_BorrowVariable(ScratchVariable* variable, ScratchVariable* source) {
+  *variable = *source;
+  if (variable->str_storage == kScratchStringStorageHeap) {
+    variable->str_storage = kScratchStringStorageBorrowed;
+  }
+}
+
+extern ScratchVariable Scratch_JoinStringVariables(
+    ScratchArena* arena, ScratchVariable* variable1, ScratchVariable* variable2);
 
 extern void Scratch_FreeVariable(ScratchVariable* variable);
 
+// Whether Scratch reads |str| as a number: JavaScript Number() of it isn't NaN and it isn't whitespace only.
+// Shared by variables and list keys.
+extern int Scratch_ParseNumber(const char* str, ScratchNumber* number);
+
 #ifdef __cplusplus
 }
 #endif
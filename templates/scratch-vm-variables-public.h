@@ -5,13 +5,84 @@
 extern "C" {
 #endif
 
+// Strings shorter than this (including the terminating zero) are stored inside
+// the variable itself and never touch the allocator. Fits any number converted to a string.
+#define SCRATCH_VM_SMALL_STRING_SIZE 30
+
+typedef enum ScratchStringStorage {
+  kScratchStringStorageNone = 0,
+  // Stored in |small_str_value|.
+  kScratchStringStorageSmall = 1,
+  // Points to a string with static lifetime (e.g. an interned literal), shared without copying.
+  kScratchStringStorageInterned = 2,
+  // Points to a heap allocated string owned by the variable.
+  kScratchStringStorageHeap = 3,
+  // Points to a string owned by someone else: a per-tick arena or another variable.
+  // Only expression temporaries use it, the string stays valid until the end of the tick.
+  kScratchStringStorageBorrowed = 4,
+} ScratchStringStorage;
+
+// Bits of ScratchVariable::cached. A value is converted to the other type on the first read as that type and the
+// result is kept until the next assignment.
+typedef enum ScratchVariableCache {
+  // |number_value| of a string holds the string converted to a number.
+  kScratchVariableCachedNumber = 1,
+  // |small_str_value| of a number holds the number converted to a string.
+  kScratchVariableCachedString = 2,
+} ScratchVariableCache;
+
+// A number when |str_storage| is kScratchStringStorageNone, a string otherwise. Read values with
+// Scratch_ReadNumberVariable and Scratch_ReadStringVariable, which convert them as Scratch does.
 typedef struct ScratchVariable {
   ScratchNumber number_value;
+  // Set for interned, heap and borrowed strings only. Use Scratch_ReadStringVariable to read any string.
   const char* str_value;
-  int is_const_str_value;
+  unsigned char str_storage;
+  unsigned char cached;
+  char small_str_value[SCRATCH_VM_SMALL_STRING_SIZE];
 } ScratchVariable;
 
-ScratchVariable* Scratch_FindVariable(const char* sprite_name, const char* variable_name);
+// Index of a variable in a program, the same for all contexts of the program.
+typedef int ScratchVariableHandle;
+#define SCRATCH_VM_INVALID_VARIABLE_HANDLE (-1)
+
+// Resolve a variable once and read it with Scratch_GetVariable without any string work.
+// Returns SCRATCH_VM_INVALID_VARIABLE_HANDLE for unknown variables.
+ScratchVariableHandle Scratch_ResolveVariable(const char* sprite_name, const char* variable_name);
+// |handle| must be a valid handle returned by Scratch_ResolveVariable.
+ScratchVariable* Scratch_GetVariable(ScratchContext* ctx, ScratchVariableHandle handle);
+
+// Scratch_ResolveVariable plus Scratch_GetVariable, returns 0 for unknown variables.
+ScratchVariable* Scratch_FindVariable(ScratchContext* ctx, const char* sprite_name, const char* variable_name);
+
+// Slow paths of the readers: convert the value of |variable| to the other type and cache the result.
+ScratchNumber Scratch_CacheStringAsNumber(ScratchVariable* variable);
+const char* Scratch_CacheNumberAsString(ScratchVariable* variable);
+
+// Readers are inline, generated blocks call them on every expression. Strings which aren't numbers read as 0,
+// numbers read as strings the way Scratch prints them, e.g. "42", "0.1" or "1e+21".
+static inline ScratchNumber Scratch_ReadNumberVariable(ScratchVariable* variable) {
+  if (variable->str_storage == kScratchStringStorageNone || (variable->cached & kScratchVariableCachedNumber)) {
+    return variable->number_value;
+  }
+  return Scratch_CacheStringAsNumber(variable);
+}
+
+static inline const char* Scratch_ReadStringVariable(ScratchVariable* variable) {
+  switch (variable->str_storage) {
+    case kScratchStringStorageSmall:
+      return variable->small_str_value;
+    case kScratchStringStorageInterned:
+    case kScratchStringStorageHeap:
+    case kScratchStringStorageBorrowed:
+      return variable->str_value;
+    default:
+      if (variable->cached & kScratchVariableCachedString) {
+        return variable->small_str_value;
+      }
+      return Scratch_CacheNumberAsString(variable);
+  }
+}
 
 #ifdef __cplusplus
 }
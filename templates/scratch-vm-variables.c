@@ -3,104 +3,298 @@
 #define _XOPEN_SOURCE
 
 #if defined(SCRATCH_VM_ALLOW_INCLUDES)
+#include "scratch-vm-arena.h"
 #include "scratch-vm-types.h"
 #include "scratch-vm-variables-public.h"
 #include "scratch-vm-variables-internal.h"
 
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #endif
 
-void Scratch_InitVariable(ScratchVariable* variable) {
-  variable->number_value = 0;
-
-  variable->str_value = 0;
-  variable->is_const_str_value = 0;
-}
-
-void Scratch_InitNumberVariable(ScratchVariable* variable, ScratchNumber number_value) {
-  variable->number_value = number_value;
-
+void Scratch_ReleaseStringVariable(ScratchVariable* variable) {
+  if (variable->str_storage == kScratchStringStorageHeap) {
+    free((void*)variable->str_value);
+  }
   variable->str_value = 0;
-  variable->is_const_str_value = 0;
+  variable->str_storage = kScratchStringStorageNone;
+  variable->cached = 0;
 }
 
-void Scratch_AssignNumberVariable(ScratchVariable* variable, ScratchNumber number) {
-  variable->number_value = number;
-
-  if (variable->str_value) {
-    if (!variable->is_const_str_value) {
-      free((void*)variable->str_value);
-    }
+// Copies |size| bytes of |str| plus the terminating zero into |variable|, using the inline storage when it fits.
+static void Scratch_CopyStringToVariable(ScratchVariable* variable, const char* str, size_t size) {
+  if (size < SCRATCH_VM_SMALL_STRING_SIZE) {
+    memcpy(variable->small_str_value, str, size + 1);
     variable->str_value = 0;
-    variable->is_const_str_value = 0;
+    variable->str_storage = kScratchStringStorageSmall;
+    return;
   }
-}
 
-ScratchNumber Scratch_ReadNumberVariable(ScratchVariable* variable) {
-  return variable->number_value;
+  char* new_string = malloc(size + 1);
+  memcpy(new_string, str, size + 1);
+  variable->str_value = new_string;
+  variable->str_storage = kScratchStringStorageHeap;
 }
 
-const char* Scratch_ReadStringVariable(ScratchVariable* variable) {
-  if (variable->str_value) {
-    return variable->str_value;
-  }
-  return "";
+void Scratch_InitVariable(ScratchVariable* variable) {
+  variable->number_value = 0;
+  variable->cached = 0;
+
+  variable->str_value = 0;
+  variable->str_storage = kScratchStringStorageNone;
 }
 
+// |is_const_str_value| set means |str| has static lifetime (string literals emitted by the transpiler) and is
+// shared without copying. Otherwise |str| must be allocated with malloc and the variable takes ownership of it.
 void Scratch_InitStringVariable(ScratchVariable* variable, const char* str, int is_const_str_value) {
   variable->number_value = 0;
+  variable->cached = 0;
 
   variable->str_value = str;
-  variable->is_const_str_value = is_const_str_value;
+  variable->str_storage = is_const_str_value ? kScratchStringStorageInterned : kScratchStringStorageHeap;
 }
 
 void Scratch_AssignStringVariable(ScratchVariable* variable, const char* str) {
   variable->number_value = 0;
+  variable->cached = 0;
 
-  if (variable->str_value) {
-    if (!variable->is_const_str_value) {
-      free((void*)variable->str_value);
-    }
-    variable->str_value = 0;
+  // |str| may be borrowed from this very variable, e.g. `set (a) to (a)`.
+  if (variable->str_storage != kScratchStringStorageNone && str == Scratch_ReadStringVariable(variable)) {
+    return;
+  }
+
+  size_t size = strlen(str);
+  if (variable->str_storage == kScratchStringStorageHeap && size >= SCRATCH_VM_SMALL_STRING_SIZE) {
+    // Reuse the allocation, long strings are usually replaced with long strings.
+    char* new_string = realloc((void*)variable->str_value, size + 1);
+    memcpy(new_string, str, size + 1);
+    variable->str_value = new_string;
+    return;
   }
 
-  variable->str_value = strdup(str);
-  variable->is_const_str_value = 0;
+  Scratch_ReleaseStringVariable(variable);
+  Scratch_CopyStringToVariable(variable, str, size);
 }
 
-ScratchVariable Scratch_JoinStringVariables(ScratchVariable* variable1, ScratchVariable* variable2) {
+// Long results are allocated from |arena| and borrowed by the result.
+ScratchVariable Scratch_JoinStringVariables(
+    ScratchArena* arena, ScratchVariable* variable1, ScratchVariable* variable2) {
   const char* s1 = Scratch_ReadStringVariable(variable1);
   const char* s2 = Scratch_ReadStringVariable(variable2);
   size_t size1 = strlen(s1);
   size_t size2 = strlen(s2);
-  
-  char* new_string = malloc(size1 + size2 + 1);
-  new_string = strcpy(new_string, s1);
-  new_string = strcat(new_string, s2);
 
   ScratchVariable result;
-  Scratch_InitStringVariable(&result, new_string, /*is_const_str_value=*/ 0);
-  
+  result.number_value = 0;
+  result.cached = 0;
+
+  char* new_string = result.small_str_value;
+  if (size1 + size2 < SCRATCH_VM_SMALL_STRING_SIZE) {
+    result.str_value = 0;
+    result.str_storage = kScratchStringStorageSmall;
+  } else {
+    new_string = Scratch_AllocateFromArena(arena, size1 + size2 + 1);
+    result.str_value = new_string;
+    result.str_storage = kScratchStringStorageBorrowed;
+  }
+  memcpy(new_string, s1, size1);
+  memcpy(new_string + size1, s2, size2 + 1);
+
   return result;
 }
 
 void Scratch_AssignVariable(ScratchVariable* variable, ScratchVariable* rhv) {
-  if (rhv->str_value) {
-    Scratch_AssignStringVariable(variable, rhv->str_value);
-  } else {
-    Scratch_AssignNumberVariable(variable, rhv->number_value);
+  if (variable == rhv) {
+    return;
+  }
+
+  switch (rhv->str_storage) {
+    case kScratchStringStorageSmall:
+      Scratch_ReleaseStringVariable(variable);
+      memcpy(variable->small_str_value, rhv->small_str_value, SCRATCH_VM_SMALL_STRING_SIZE);
+      variable->str_storage = kScratchStringStorageSmall;
+      break;
+    case kScratchStringStorageInterned:
+      Scratch_ReleaseStringVariable(variable);
+      variable->str_value = rhv->str_value;
+      variable->str_storage = kScratchStringStorageInterned;
+      break;
+    case kScratchStringStorageHeap:
+    case kScratchStringStorageBorrowed:
+      Scratch_AssignStringVariable(variable, rhv->str_value);
+      break;
+    default:
+      Scratch_AssignNumberVariable(variable, rhv->number_value);
+      return;
   }
+  // The string is the same, so is its number.
+  variable->number_value = rhv->number_value;
+  variable->cached = rhv->cached & kScratchVariableCachedNumber;
 }
 
 void Scratch_FreeVariable(ScratchVariable* variable) {
   variable->number_value = 0;
+  variable->cached = 0;
 
-  if (variable->str_value) {
-    if (!variable->is_const_str_value) {
-      free((void*)variable->str_value);
+  Scratch_ReleaseStringVariable(variable);
+}
+
+// Scratch converts with JavaScript Number(): surrounding whitespace is ignored, an empty string is 0, anything
+// else which isn't a number is NaN and Scratch reads NaN as 0.
+// Digits of an unsigned 0x, 0o or 0b integer literal, which JavaScript Number() reads too. 0 if it isn't one.
+static int Scratch_GetIntegerLiteralBase(const char* str) {
+  if (str[0] != '0') {
+    return 0;
+  }
+  switch (str[1]) {
+    case 'x':
+    case 'X':
+      return 16;
+    case 'o':
+    case 'O':
+      return 8;
+    case 'b':
+    case 'B':
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+int Scratch_ParseNumber(const char* str, ScratchNumber* number) {
+  while (isspace((unsigned char)*str)) {
+    ++str;
+  }
+  if (!*str) {
+    return 0;
+  }
+
+  const char* end;
+  const int has_sign = *str == '+' || *str == '-';
+  const char* digits = str + has_sign;
+  const int base = Scratch_GetIntegerLiteralBase(digits);
+  if (base) {
+    // Unlike strtod, no sign, fraction or binary exponent: "-0x10" and "0x1p3" aren't numbers.
+    if (has_sign) {
+      return 0;
     }
-    variable->str_value = 0;
-    variable->is_const_str_value = 0;
+    *number = 0;
+    for (end = digits + 2; isxdigit((unsigned char)*end); ++end) {
+      int digit = isdigit((unsigned char)*end) ? *end - '0' : tolower((unsigned char)*end) - 'a' + 10;
+      if (digit >= base) {
+        return 0;
+      }
+      *number = *number * base + digit;
+    }
+    if (end == digits + 2) {
+      return 0;
+    }
+  } else {
+    // strtod also reads "inf" and "nan" in any case, JavaScript only reads "Infinity".
+    if (!isdigit((unsigned char)*digits) && *digits != '.' && strncmp(digits, "Infinity", 8) != 0) {
+      return 0;
+    }
+    char* number_end;
+    *number = strtod(str, &number_end);
+    if (number_end == str) {
+      return 0;
+    }
+    end = number_end;
+  }
+
+  while (isspace((unsigned char)*end)) {
+    ++end;
+  }
+  return !*end;
+}
+
+ScratchNumber Scratch_CacheStringAsNumber(ScratchVariable* variable) {
+  ScratchNumber number = 0;
+  if (!Scratch_ParseNumber(Scratch_ReadStringVariable(variable), &number)) {
+    number = 0;
   }
+
+  variable->number_value = number;
+  variable->cached |= kScratchVariableCachedNumber;
+  return number;
+}
+
+// Must match to_scratch_number_text in the transpiler, folded joins print numbers the same way.
+const char* Scratch_CacheNumberAsString(ScratchVariable* variable) {
+  ScratchNumber number = variable->number_value;
+  char* str = variable->small_str_value;
+  if (isnan(number)) {
+    strcpy(str, "NaN");
+  } else if (isinf(number)) {
+    strcpy(str, number > 0 ? "Infinity" : "-Infinity");
+  } else if (number == floor(number) && fabs(number) < 9007199254740992.0) {
+    // Integers below 2^53 are printed in full, their digits are the shortest ones. -0 is printed as 0.
+    snprintf(str, SCRATCH_VM_SMALL_STRING_SIZE, "%.0f", number == 0 ? 0 : number);
+  } else {
+    // The shortest digits that read back as the same number. Once some precision does, any higher one does too,
+    // so it's searched for in at most 5 steps. 17 digits always do.
+    char scientific[SCRATCH_VM_SMALL_STRING_SIZE];
+    int min_precision = 1;
+    int max_precision = 17;
+    while (min_precision < max_precision) {
+      int precision = (min_precision + max_precision) / 2;
+      snprintf(scientific, sizeof(scientific), "%.*e", precision - 1, fabs(number));
+      if (strtod(scientific, 0) == fabs(number)) {
+        max_precision = precision;
+      } else {
+        min_precision = precision + 1;
+      }
+    }
+    snprintf(scientific, sizeof(scientific), "%.*e", max_precision - 1, fabs(number));
+    // "d.ddde[+-]x" to the significant digits without trailing zeros and the exponent.
+    char* exponent_mark = strchr(scientific, 'e');
+    int exponent = atoi(exponent_mark + 1);
+    char digits[20];
+    int digit_count = 0;
+    for (const char* c = scientific; c < exponent_mark; ++c) {
+      if (*c != '.') {
+        digits[digit_count++] = *c;
+      }
+    }
+    while (digit_count > 1 && digits[digit_count - 1] == '0') {
+      --digit_count;
+    }
+
+    // Number::toString of JavaScript: fixed notation for 1e-6 <= |number| < 1e21, exponent form outside.
+    char* out = str;
+    if (number < 0) {
+      *out++ = '-';
+    }
+    if (exponent >= 0 && exponent < 21) {
+      for (int i = 0; i < digit_count || i <= exponent; ++i) {
+        if (i == exponent + 1) {
+          *out++ = '.';
+        }
+        *out++ = i < digit_count ? digits[i] : '0';
+      }
+    } else if (exponent < 0 && exponent >= -6) {
+      *out++ = '0';
+      *out++ = '.';
+      for (int i = exponent + 1; i < 0; ++i) {
+        *out++ = '0';
+      }
+      memcpy(out, digits, (size_t)digit_count);
+      out += digit_count;
+    } else {
+      *out++ = digits[0];
+      if (digit_count > 1) {
+        *out++ = '.';
+        memcpy(out, digits + 1, (size_t)digit_count - 1);
+        out += digit_count - 1;
+      }
+      out += sprintf(out, "e%c%d", exponent < 0 ? '-' : '+', abs(exponent));
+    }
+    *out = 0;
+  }
+
+  variable->cached |= kScratchVariableCachedString;
+  return str;
 }
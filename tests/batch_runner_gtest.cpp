@@ -0,0 +1,69 @@
+// Header of the transpiled variables.sb3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "batch_runner.h"
+
+namespace {
+
+const scratch::Program kProgram{Scratch_GetContextSize, Scratch_Init, Scratch_Free, Scratch_Advance};
+
+}  // namespace
+
+TEST(batch_runner_gtest, matches_single_context) {
+    constexpr size_t kInstances = 37;
+    constexpr size_t kTicks = 4;
+    constexpr ScratchNumber kDt = 0.3;
+
+    ScratchContext* expected = Scratch_NewContext();
+    for (size_t i = 0; i < kTicks; ++i) {
+        Scratch_Advance(expected, kDt);
+    }
+
+    scratch::BatchRunnerOptions options;
+    options.threads = 3;
+    options.chunk_size = 2;
+    scratch::BatchRunner runner(kProgram, kInstances, options);
+    scratch::BatchReport report = runner.Run(kTicks, kDt);
+
+    ASSERT_EQ(report.instances, kInstances);
+    ASSERT_EQ(report.ticks, kTicks);
+    ASSERT_EQ(report.threads, 3u);
+    ASSERT_EQ(report.chunk_size, 2u);
+
+    for (const char* name : {"Number", "Another Number"}) {
+        ScratchNumber value = Scratch_FindVariable(expected, "Stage", name)->number_value;
+        for (size_t i = 0; i < runner.GetInstanceCount(); ++i) {
+            ASSERT_FLOAT_EQ(Scratch_FindVariable(runner.GetContext(i), "Stage", name)->number_value, value);
+        }
+    }
+    for (const char* name : {"Text", "Another Text"}) {
+        std::string value = Scratch_ReadStringVariable(Scratch_FindVariable(expected, "Stage", name));
+        for (size_t i = 0; i < runner.GetInstanceCount(); ++i) {
+            ASSERT_EQ(Scratch_ReadStringVariable(Scratch_FindVariable(runner.GetContext(i), "Stage", name)), value);
+        }
+    }
+
+    Scratch_DeleteContext(expected);
+}
+
+TEST(batch_runner_gtest, report) {
+    scratch::BatchRunnerOptions options;
+    options.threads = 4;
+    scratch::BatchRunner runner(kProgram, 3, options);
+    scratch::BatchReport report = runner.Run(2, 0.1);
+
+    // Never more workers than instances.
+    ASSERT_EQ(report.threads, 3u);
+    ASSERT_EQ(report.chunk_size, 1u);
+    ASSERT_GT(report.TicksPerSecond(), 0);
+    ASSERT_DOUBLE_EQ(report.TicksPerSecondPerCore() * 3, report.TicksPerSecond());
+
+    std::ostringstream out;
+    report.Print(out);
+    ASSERT_NE(out.str().find("ticks/s/core: "), std::string::npos);
+}
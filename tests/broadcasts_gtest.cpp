@@ -0,0 +1,65 @@
+// Header of the transpiled broadcasts program of size 5, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+ScratchNumber ReadNumber(ScratchContext* ctx, const char* variable_name) {
+    return Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", variable_name));
+}
+
+std::vector<unsigned char> SaveState(ScratchContext* ctx) {
+    std::vector<unsigned char> blob(Scratch_SaveState(ctx, nullptr, 0));
+    Scratch_SaveState(ctx, blob.data(), blob.size());
+    return blob;
+}
+
+}  // namespace
+
+// 5 scripts receive "tick" and increment Counter. The flag script waits for them once, then "loop" restarts
+// itself, the "tick" receivers and a script sleeping before it increments Naps every tick.
+TEST(broadcasts_gtest, broadcast_blocks) {
+    ScratchContext* ctx = Scratch_NewContext();
+
+    // `broadcast [tick] and wait` waits for all the receivers to finish.
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_EQ(ReadNumber(ctx, "Counter"), 5);
+    ASSERT_EQ(ReadNumber(ctx, "Waited"), 0);
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_EQ(ReadNumber(ctx, "Waited"), 5);
+    ASSERT_EQ(ReadNumber(ctx, "Loops"), 1);
+    ASSERT_EQ(ReadNumber(ctx, "Counter"), 10);
+
+    // Receivers run once every tick, the sleeping script is restarted before it wakes up.
+    for (int i = 0; i < 18; ++i) {
+        Scratch_Advance(ctx, 0.1);
+    }
+    ASSERT_EQ(ReadNumber(ctx, "Counter"), 100);
+    ASSERT_EQ(ReadNumber(ctx, "Loops"), 19);
+    ASSERT_EQ(ReadNumber(ctx, "Naps"), 0);
+
+    // Running and sleeping receivers are saved with the state.
+    std::vector<unsigned char> blob = SaveState(ctx);
+    ScratchContext* loaded = Scratch_NewContext();
+    ASSERT_EQ(Scratch_LoadState(loaded, blob.data(), blob.size()), kScratchLoadStateOk);
+    for (int i = 0; i < 3; ++i) {
+        Scratch_Advance(ctx, 0.1);
+        Scratch_Advance(loaded, 0.1);
+    }
+    ASSERT_EQ(ReadNumber(loaded, "Counter"), 115);
+    ASSERT_EQ(ReadNumber(loaded, "Loops"), 22);
+    ASSERT_EQ(SaveState(loaded), SaveState(ctx));
+    Scratch_DeleteContext(loaded);
+
+    // Reinitialization waits for the first "tick" again.
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_EQ(ReadNumber(ctx, "Counter"), 5);
+    ASSERT_EQ(ReadNumber(ctx, "Loops"), 0);
+
+    Scratch_DeleteContext(ctx);
+}
@@ -0,0 +1,51 @@
+// Header of the transpiled clones program of size 5, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <gtest/gtest.h>
+
+TEST(clones_gtest, create_clone_of_myself) {
+    ScratchContext* ctx = Scratch_NewContext();
+    ScratchClonePool* clones = Scratch_GetClonePool(ctx, "Sprite1");
+    ASSERT_NE(clones, nullptr);
+    ASSERT_EQ(clones->count, 0);
+    ASSERT_EQ(Scratch_GetClonePool(ctx, "Unknown"), nullptr);
+
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_EQ(clones->count, 5);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", "Counter")), 5);
+    // Both "when I start as a clone" scripts ran once for every clone, after the sprite moved to x = 7.
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", "Started")), 5);
+    for (int i = 0; i < clones->count; ++i) {
+        ASSERT_EQ(clones->x[i], 17);
+        ASSERT_EQ(clones->y[i], 6);
+    }
+
+    // Clones run their start scripts once.
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", "Started")), 5);
+    ASSERT_EQ(clones->x[0], 17);
+
+    // Hosts can manage clones directly.
+    Scratch_DeleteClone(clones, clones->ids[0]);
+    ASSERT_EQ(clones->count, 4);
+
+    // Clones created by the host start in the end of the tick, even when a started clone is deleted before.
+    Scratch_CreateClone(clones, 100, 0, 1, 0);
+    Scratch_CreateClone(clones, 100, 0, 1, 0);
+    Scratch_DeleteClone(clones, clones->ids[1]);
+    ASSERT_EQ(clones->count, 5);
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", "Started")), 7);
+    int moved = 0;
+    for (int i = 0; i < clones->count; ++i) {
+        moved += clones->x[i] == 110;
+    }
+    ASSERT_EQ(moved, 2);
+
+    // Reinitialization removes all clones.
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    ASSERT_EQ(Scratch_GetClonePool(ctx, "Sprite1")->count, 0);
+
+    Scratch_DeleteContext(ctx);
+}
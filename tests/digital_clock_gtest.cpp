@@ -3,5 +3,6 @@
 #include <gtest/gtest.h>
 
 TEST(digital_clock_gtest, simple) {
-    Scratch_Init();
+    ScratchContext* ctx = Scratch_NewContext();
+    Scratch_DeleteContext(ctx);
 }
@@ -0,0 +1,78 @@
+// Header of the transpiled variables.sb3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "frame_loop.h"
+
+namespace {
+
+std::vector<ScratchNumber> advanced_dts;
+
+void RecordAdvance(ScratchContext*, ScratchNumber dt) {
+    advanced_dts.push_back(dt);
+}
+
+std::vector<unsigned char> SaveState(ScratchContext* ctx) {
+    std::vector<unsigned char> blob(Scratch_SaveState(ctx, nullptr, 0));
+    Scratch_SaveState(ctx, blob.data(), blob.size());
+    return blob;
+}
+
+}  // namespace
+
+TEST(frame_loop_gtest, fixed_ticks) {
+    advanced_dts.clear();
+    scratch::FrameLoop loop(nullptr, RecordAdvance);
+
+    ASSERT_EQ(loop.Update(0.01), 0u);
+    ASSERT_NEAR(loop.GetInterpolationAlpha(), 0.3, 1e-9);
+    ASSERT_EQ(loop.Update(0.04), 1u);
+    ASSERT_NEAR(loop.GetInterpolationAlpha(), 0.5, 1e-9);
+    ASSERT_EQ(loop.Update(0.1), 3u);
+    ASSERT_NEAR(loop.GetInterpolationAlpha(), 0.5, 1e-9);
+
+    ASSERT_EQ(advanced_dts, std::vector<ScratchNumber>(4, 1.0 / 30));
+
+    const scratch::FrameStats& stats = loop.GetStats();
+    ASSERT_EQ(stats.frames, 3u);
+    ASSERT_EQ(stats.ticks, 4u);
+    ASSERT_EQ(stats.dropped_ticks, 0u);
+    ASSERT_DOUBLE_EQ(stats.frame_seconds_min, 0.01);
+    ASSERT_DOUBLE_EQ(stats.frame_seconds_max, 0.1);
+}
+
+TEST(frame_loop_gtest, drops_ticks_after_stall) {
+    advanced_dts.clear();
+    scratch::FrameLoopOptions options;
+    options.max_ticks_per_frame = 5;
+    scratch::FrameLoop loop(nullptr, RecordAdvance, options);
+
+    // A second long frame runs only 5 ticks, the next frames are not affected by the stall.
+    ASSERT_EQ(loop.Update(1.0 + 0.5 / 30), 5u);
+    ASSERT_EQ(loop.GetStats().dropped_ticks, 25u);
+    ASSERT_NEAR(loop.GetInterpolationAlpha(), 0.5, 1e-9);
+    ASSERT_EQ(loop.Update(1.0 / 30), 1u);
+    ASSERT_EQ(advanced_dts.size(), 6u);
+}
+
+TEST(frame_loop_gtest, same_state_at_any_frame_rate) {
+    // Irregular frames of about two seconds.
+    ScratchContext* desktop = Scratch_NewContext();
+    scratch::FrameLoop desktop_loop(desktop, Scratch_Advance);
+    const double frames[] = {0.016, 0.017, 0.1, 0.001, 0.05};
+    for (size_t i = 0; desktop_loop.GetStats().ticks < 60; ++i) {
+        desktop_loop.Update(frames[i % 5]);
+    }
+
+    ScratchContext* headless = Scratch_NewContext();
+    scratch::FrameLoop headless_loop(headless, Scratch_Advance);
+    headless_loop.AdvanceTicks(desktop_loop.GetStats().ticks);
+
+    ASSERT_EQ(SaveState(headless), SaveState(desktop));
+
+    Scratch_DeleteContext(headless);
+    Scratch_DeleteContext(desktop);
+}
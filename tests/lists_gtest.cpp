@@ -0,0 +1,63 @@
+// Header of the transpiled lists program of size 5, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::string ReadItem(ScratchList* list, int index) {
+    ScratchVariable item = Scratch_GetListItem(list, index);
+    return Scratch_ReadStringVariable(&item);
+}
+
+ScratchNumber ReadNumber(ScratchContext* ctx, const char* variable_name) {
+    return Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", variable_name));
+}
+
+}  // namespace
+
+TEST(lists_gtest, list_blocks) {
+    ScratchContext* ctx = Scratch_NewContext();
+    ScratchList* items = Scratch_FindList(ctx, "Stage", "Items");
+    ASSERT_NE(items, nullptr);
+    ASSERT_EQ(Scratch_FindList(ctx, "Stage", "Unknown"), nullptr);
+
+    // Initial items, the numeric one is a number.
+    ASSERT_EQ(Scratch_GetListLength(items), 2);
+    ASSERT_EQ(ReadItem(items, 1), "1");
+    ASSERT_EQ(ReadItem(items, 2), "two");
+
+    Scratch_Advance(ctx, 0.1);
+    // 1, "two", 0, 1, 2, 3, 4, "Apple": numbers 0 to 4 are found at 3, 1, 5, 6 and 7.
+    ASSERT_EQ(ReadNumber(ctx, "Counter"), 22);
+    ASSERT_EQ(ReadNumber(ctx, "Found"), 8);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(Scratch_FindVariable(ctx, "Stage", "Last"))), "Apple");
+
+    // The first item is replaced with the length and the last one is deleted.
+    const std::vector<std::string> expected = {"8", "two", "0", "1", "2", "3", "4"};
+    ASSERT_EQ(Scratch_GetListLength(items), static_cast<int>(expected.size()));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(ReadItem(items, static_cast<int>(i) + 1), expected[i]);
+    }
+
+    // Lists are saved with the state.
+    std::vector<unsigned char> blob(Scratch_SaveState(ctx, nullptr, 0));
+    Scratch_SaveState(ctx, blob.data(), blob.size());
+    ScratchContext* loaded = Scratch_NewContext();
+    ASSERT_EQ(Scratch_LoadState(loaded, blob.data(), blob.size()), kScratchLoadStateOk);
+    ScratchList* loaded_items = Scratch_FindList(loaded, "Stage", "Items");
+    ASSERT_EQ(Scratch_GetListLength(loaded_items), static_cast<int>(expected.size()));
+    ASSERT_EQ(ReadItem(loaded_items, 2), "two");
+    Scratch_DeleteContext(loaded);
+
+    // Reinitialization restores the initial items.
+    Scratch_Free(ctx);
+    Scratch_Init(ctx);
+    ASSERT_EQ(Scratch_GetListLength(items), 2);
+    ASSERT_EQ(ReadItem(items, 2), "two");
+
+    Scratch_DeleteContext(ctx);
+}
@@ -0,0 +1,31 @@
+// Header of the transpiled number texts program of size 8, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::string ReadString(ScratchContext* ctx, const std::string& variable_name) {
+    return Scratch_ReadStringVariable(Scratch_FindVariable(ctx, "Stage", variable_name.c_str()));
+}
+
+}  // namespace
+
+// Joins folded by the transpiler print numbers exactly like the runtime, the way JavaScript does: fixed notation
+// from 1e-6 on, the exponent form below.
+TEST(number_texts_gtest, folded_joins_match_runtime) {
+    const char* expected[] = {
+        "a1e-7", "a1.5e-7", "a0.000001", "a0.000012", "a0.00001", "a0.0000123", "a0.000099", "a0.0001",
+    };
+
+    ScratchContext* ctx = Scratch_NewContext();
+    Scratch_Advance(ctx, 0.1);
+    for (int i = 0; i < 8; ++i) {
+        const std::string index = std::to_string(i);
+        ASSERT_EQ(ReadString(ctx, "Joined" + index), expected[i]) << i;
+        ASSERT_EQ(ReadString(ctx, "Folded" + index), ReadString(ctx, "Joined" + index)) << i;
+    }
+    Scratch_DeleteContext(ctx);
+}
@@ -0,0 +1,95 @@
+// Header of the transpiled variables.sb3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::string DumpProfile(ScratchContext* ctx, ScratchProfileFormat format) {
+    std::FILE* file = std::tmpfile();
+    Scratch_DumpProfile(ctx, file, format);
+    std::rewind(file);
+    std::string result;
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        result.push_back(static_cast<char>(c));
+    }
+    std::fclose(file);
+    return result;
+}
+
+// Splits a CSV line, quoted fields may contain commas and doubled quotes.
+std::vector<std::string> SplitCsvLine(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '"') {
+            if (quoted && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back().push_back('"');
+                ++i;
+            } else {
+                quoted = !quoted;
+            }
+        } else if (line[i] == ',' && !quoted) {
+            fields.emplace_back();
+        } else {
+            fields.back().push_back(line[i]);
+        }
+    }
+    return fields;
+}
+
+// Rows of the CSV profile by function name.
+std::map<std::string, std::vector<std::string>> ParseCsvProfile(const std::string& csv) {
+    std::map<std::string, std::vector<std::string>> rows;
+    size_t begin = csv.find('\n') + 1;
+    for (size_t end = csv.find('\n', begin); end != std::string::npos; end = csv.find('\n', begin)) {
+        std::vector<std::string> fields = SplitCsvLine(csv.substr(begin, end - begin));
+        EXPECT_EQ(fields.size(), 6u);
+        rows[fields[3]] = fields;
+        begin = end + 1;
+    }
+    return rows;
+}
+
+}  // namespace
+
+TEST(profile_gtest, dump_profile) {
+    ScratchContext* ctx = Scratch_NewContext();
+    Scratch_Advance(ctx, 0.5);
+
+    std::string csv = DumpProfile(ctx, kScratchProfileFormatCsv);
+    ASSERT_EQ(csv.substr(0, csv.find('\n')), "block_id,block_opcode,sprite,function,calls,cycles");
+    std::map<std::string, std::vector<std::string>> rows = ParseCsvProfile(csv);
+    std::string json = DumpProfile(ctx, kScratchProfileFormatJson);
+
+#if SCRATCH_PROGRAM_PROFILE
+    // The first `set Text to (Text)` block, counted with its ID in project.json.
+    ASSERT_EQ(rows.count("Sprite1_set_variable_1"), 1u);
+    const std::vector<std::string>& row = rows["Sprite1_set_variable_1"];
+    ASSERT_EQ(row[0], "bzGh#?wk;roMG|hhHn{w");
+    ASSERT_EQ(row[1], "data_setvariableto");
+    ASSERT_EQ(row[2], "Sprite1");
+    ASSERT_EQ(row[4], "1");
+    ASSERT_NE(json.find("{\"block_id\": \"bzGh#?wk;roMG|hhHn{w\", \"block_opcode\": \"data_setvariableto\", "
+                        "\"sprite\": \"Sprite1\", \"function\": \"Sprite1_set_variable_1\", \"calls\": 1, "),
+              std::string::npos);
+    // IDs with commas are quoted.
+    ASSERT_NE(csv.find("\"w,npDXm0PBZatQ0PnpZE\""), std::string::npos);
+
+    Scratch_ResetProfile(ctx);
+    for (const auto& [function, fields] : ParseCsvProfile(DumpProfile(ctx, kScratchProfileFormatCsv))) {
+        ASSERT_EQ(fields[4], "0") << function;
+        ASSERT_EQ(fields[5], "0") << function;
+    }
+#else
+    ASSERT_TRUE(rows.empty());
+    ASSERT_EQ(json, "[]\n");
+#endif
+
+    Scratch_DeleteContext(ctx);
+}
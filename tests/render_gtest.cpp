@@ -0,0 +1,57 @@
+// Header of the transpiled clones program of size 5 with --atlas, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// The sprite has a single 32x32 bitmap costume of resolution 2, the stage has none.
+TEST(render_gtest, atlas) {
+    const ScratchAtlas* atlas = Scratch_GetAtlas();
+    ASSERT_EQ(atlas->costume_count, 1);
+    ASSERT_EQ(atlas->width, 64);
+    ASSERT_EQ(atlas->height, 64);
+    const std::string atlas_file = SCRATCH_PROGRAM_ATLAS_FILE;
+    ASSERT_EQ(atlas_file.substr(atlas_file.size() - 10), "_atlas.bmp");
+
+    const ScratchCostume& costume = atlas->costumes[0];
+    ASSERT_EQ(std::string(costume.name), "arrow");
+    ASSERT_EQ(costume.x, 0);
+    ASSERT_EQ(costume.y, 0);
+    ASSERT_EQ(costume.width, 32);
+    ASSERT_EQ(costume.height, 32);
+    ASSERT_EQ(costume.rotation_center_x, 16);
+    ASSERT_EQ(costume.rotation_center_y, 16);
+    ASSERT_EQ(costume.resolution, 2);
+}
+
+TEST(render_gtest, render_targets) {
+    ScratchContext* ctx = Scratch_NewContext();
+    ASSERT_EQ(Scratch_GetRenderTargets(ctx, nullptr, 0), 2);
+    std::vector<ScratchRenderTarget> targets(2);
+    ASSERT_EQ(Scratch_GetRenderTargets(ctx, targets.data(), 2), 2);
+
+    // The stage is drawn first, without clones.
+    ASSERT_EQ(targets[0].clones, nullptr);
+    ASSERT_EQ(targets[0].costume, -1);
+
+    const ScratchRenderTarget& sprite = targets[1];
+    ASSERT_EQ(sprite.clones, Scratch_GetClonePool(ctx, "Sprite1"));
+    ASSERT_EQ(sprite.costume, 0);
+    ASSERT_EQ(sprite.scale, 1);
+    ASSERT_TRUE(sprite.is_visible);
+    ASSERT_EQ(*sprite.x, 0);
+    ASSERT_EQ(*sprite.y, 0);
+    // Scratch direction 90.
+    ASSERT_EQ(*sprite.direction_x, 1);
+    ASSERT_EQ(*sprite.direction_y, 0);
+
+    // Positions are read through the pointers after every tick.
+    Scratch_Advance(ctx, 0.1);
+    ASSERT_EQ(*sprite.x, 7);
+    ASSERT_EQ(sprite.clones->count, 5);
+    ASSERT_EQ(sprite.clones->x[0], 17);
+
+    Scratch_DeleteContext(ctx);
+}
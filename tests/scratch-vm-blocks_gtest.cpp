@@ -0,0 +1,112 @@
+#include <cmath>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-blocks.h"
+
+namespace {
+
+// Blocks of the test programs append their names here, the context isn't dereferenced by the runtime.
+std::string trace;
+ScratchNumber wait_duration = 0;
+ScratchControlWaitRuntime wait_runtime;
+ScratchClock test_clock;
+
+void A(ScratchContext*, ScratchNumber) {
+  trace += "a";
+}
+
+void B(ScratchContext*, ScratchNumber) {
+  trace += "b";
+}
+
+ScratchNumber WaitDuration(ScratchContext*, ScratchSprite*, ScratchNumber) {
+  return wait_duration;
+}
+
+ScratchBlockFunctionResult Wait(ScratchContext* ctx, ScratchNumber dt) {
+  trace += "w";
+  return Scratch_AdvanceControlWaitRuntime(ctx, dt, nullptr, WaitDuration, &wait_runtime, &test_clock);
+}
+
+ScratchBlock MakeInPlace(const ScratchBlock* next, ImplaceBlockFunction function) {
+  ScratchBlock block = {};
+  block.next = next;
+  block.op_code = kScratchInPlace;
+  block.inplace_function = function;
+  return block;
+}
+
+}  // namespace
+
+TEST(scratch_vm_blocks_gtest, control_wait) {
+  test_clock = ScratchClock{0, 0.25, 0};
+  wait_runtime = ScratchControlWaitRuntime{0, 0};
+  wait_duration = 1;
+
+  // Ends in the first tick ending at or after 1.
+  int ticks = 0;
+  while (Scratch_AdvanceControlWaitRuntime(nullptr, 0, nullptr, WaitDuration, &wait_runtime, &test_clock) ==
+         kScratchBlockFunctionResultWait) {
+    ASSERT_EQ(test_clock.wake_up_time, 1);
+    test_clock.tick_start_time = test_clock.current_time;
+    test_clock.current_time += 0.25;
+    ++ticks;
+  }
+  ASSERT_EQ(ticks, 3);
+  ASSERT_EQ(test_clock.current_time, 1);
+  ASSERT_EQ(wait_runtime.is_running, 0);
+
+  // A zero wait ends in the same tick, a NaN one never does.
+  wait_duration = 0;
+  ASSERT_EQ(Scratch_AdvanceControlWaitRuntime(nullptr, 0, nullptr, WaitDuration, &wait_runtime, &test_clock),
+            kScratchBlockFunctionResultContinue);
+  wait_duration = NAN;
+  ASSERT_EQ(Scratch_AdvanceControlWaitRuntime(nullptr, 0, nullptr, WaitDuration, &wait_runtime, &test_clock),
+            kScratchBlockFunctionResultWait);
+  ASSERT_EQ(wait_runtime.deadline, INFINITY);
+}
+
+TEST(scratch_vm_blocks_gtest, advance_single_program) {
+  test_clock = ScratchClock{0, 0.25, 0};
+  wait_runtime = ScratchControlWaitRuntime{0, 0};
+  wait_duration = 0.5;
+  trace.clear();
+
+  // a -> wait -> b
+  ScratchBlock b = MakeInPlace(nullptr, B);
+  ScratchBlock wait = {};
+  wait.next = &b;
+  wait.op_code = kScratchControlWait;
+  wait.block_function = Wait;
+  ScratchBlock a = MakeInPlace(&wait, A);
+
+  const ScratchBlock* stack[1] = {&a};
+  int cur_stack_index = 0;
+  ASSERT_EQ(Scratch_AdvanceSingleProgram(nullptr, 0, stack, &cur_stack_index, 0), kScratchProgramSleeping);
+  ASSERT_EQ(trace, "aw");
+  ASSERT_EQ(stack[0], &wait);
+
+  test_clock.tick_start_time = test_clock.current_time;
+  test_clock.current_time += 0.25;
+  ASSERT_EQ(Scratch_AdvanceSingleProgram(nullptr, 0, stack, &cur_stack_index, 0), kScratchProgramFinished);
+  ASSERT_EQ(trace, "awwb");
+  ASSERT_EQ(cur_stack_index, -1);
+}
+
+TEST(scratch_vm_blocks_gtest, advance_sub_stack) {
+  trace.clear();
+
+  // The substack ends without popping it, the caller continues after the block owning it.
+  ScratchBlock b = MakeInPlace(nullptr, B);
+  ScratchBlock a = MakeInPlace(&b, A);
+  ScratchBlock outer = MakeInPlace(nullptr, A);
+
+  const ScratchBlock* stack[2] = {&outer, &a};
+  int cur_stack_index = 1;
+  ASSERT_EQ(Scratch_AdvanceSingleProgram(nullptr, 0, stack, &cur_stack_index, 1), kScratchProgramRunnable);
+  ASSERT_EQ(trace, "ab");
+  ASSERT_EQ(cur_stack_index, 1);
+  ASSERT_EQ(stack[1], nullptr);
+}
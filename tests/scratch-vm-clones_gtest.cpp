@@ -0,0 +1,79 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-clones.h"
+
+TEST(scratch_vm_clones_gtest, create_and_delete) {
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+
+  std::vector<ScratchCloneId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(Scratch_CreateClone(&pool, i, -i, 1, 0));
+  }
+  ASSERT_EQ(pool.count, 100);
+  for (int i = 0; i < 100; ++i) {
+    int index = Scratch_GetCloneIndex(&pool, ids[i]);
+    ASSERT_EQ(pool.x[index], i);
+    ASSERT_EQ(pool.y[index], -i);
+    ASSERT_EQ(pool.ids[index], ids[i]);
+  }
+
+  // Delete every even clone, the rest keep their values.
+  for (int i = 0; i < 100; i += 2) {
+    Scratch_DeleteClone(&pool, ids[i]);
+    ASSERT_EQ(Scratch_GetCloneIndex(&pool, ids[i]), -1);
+  }
+  ASSERT_EQ(pool.count, 50);
+  for (int i = 1; i < 100; i += 2) {
+    int index = Scratch_GetCloneIndex(&pool, ids[i]);
+    ASSERT_LT(index, pool.count);
+    ASSERT_EQ(pool.x[index], i);
+  }
+
+  // Ids of deleted clones are reused, no column grows.
+  int capacity = pool.capacity;
+  for (int i = 0; i < 50; ++i) {
+    ScratchCloneId id = Scratch_CreateClone(&pool, 1000 + i, 0, 0, 1);
+    ASSERT_LT(id, 100);
+    ASSERT_EQ(pool.x[Scratch_GetCloneIndex(&pool, id)], 1000 + i);
+  }
+  ASSERT_EQ(pool.count, 100);
+  ASSERT_EQ(pool.capacity, capacity);
+
+  Scratch_DeleteAllClones(&pool);
+  ASSERT_EQ(pool.count, 0);
+  ASSERT_EQ(Scratch_CreateClone(&pool, 0, 0, 0, 0), 0);
+
+  Scratch_FreeClonePool(&pool);
+  ASSERT_EQ(pool.count, 0);
+  ASSERT_EQ(pool.capacity, 0);
+}
+
+TEST(scratch_vm_clones_gtest, delete_keeps_started_clones_first) {
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+
+  // Clones 0-4 started, 5-7 haven't.
+  std::vector<ScratchCloneId> ids;
+  for (int i = 0; i < 8; ++i) {
+    ids.push_back(Scratch_CreateClone(&pool, i, 0, 1, 0));
+  }
+  pool.started_count = 5;
+
+  Scratch_DeleteClone(&pool, ids[1]);
+  Scratch_DeleteClone(&pool, ids[6]);
+  Scratch_DeleteClone(&pool, ids[4]);
+  ASSERT_EQ(pool.count, 5);
+  ASSERT_EQ(pool.started_count, 3);
+  for (int i = 0; i < pool.count; ++i) {
+    ASSERT_EQ(i < pool.started_count, pool.x[i] < 5) << "clone " << pool.x[i] << " at " << i;
+    ASSERT_EQ(Scratch_GetCloneIndex(&pool, pool.ids[i]), i);
+  }
+
+  Scratch_DeleteAllClones(&pool);
+  ASSERT_EQ(pool.started_count, 0);
+  Scratch_FreeClonePool(&pool);
+}
@@ -0,0 +1,31 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-columns.h"
+
+TEST(scratch_vm_columns_gtest, fill_and_add) {
+  // Sizes around the vector widths exercise the scalar tails.
+  for (int count = 0; count < 20; ++count) {
+    // Guards around the column catch writes out of bounds.
+    std::vector<ScratchNumber> memory(count + 2, -1);
+    ScratchNumber* column = memory.data() + 1;
+
+    Scratch_FillColumn(column, count, 3);
+    Scratch_AddToColumn(column, count, 0.5);
+    for (int i = 0; i < count; ++i) {
+      ASSERT_EQ(column[i], 3.5);
+    }
+    ASSERT_EQ(memory.front(), -1);
+    ASSERT_EQ(memory.back(), -1);
+  }
+
+  // Unaligned start.
+  std::vector<ScratchNumber> memory = {0, 1, 2, 3, 4, 5, 6, 7};
+  Scratch_AddToColumn(memory.data() + 1, 7, 10);
+  ASSERT_EQ(memory[0], 0);
+  for (int i = 1; i < 8; ++i) {
+    ASSERT_EQ(memory[i], 10 + i);
+  }
+}
@@ -0,0 +1,203 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-variables-internal.h"
+#include "templates/scratch-vm-clones.h"
+#include "templates/scratch-vm-lists.h"
+#include "templates/scratch-vm-state.h"
+
+namespace {
+
+std::string ReadItem(ScratchList* list, int index) {
+  ScratchVariable item = Scratch_GetListItem(list, index);
+  return Scratch_ReadStringVariable(&item);
+}
+
+ScratchVariable MakeString(const char* str) {
+  ScratchVariable variable;
+  Scratch_InitStringVariable(&variable, str, /*is_const_str_value=*/ 1);
+  return variable;
+}
+
+ScratchVariable MakeNumber(ScratchNumber number) {
+  ScratchVariable variable;
+  Scratch_InitNumberVariable(&variable, number);
+  return variable;
+}
+
+}  // namespace
+
+TEST(scratch_vm_lists_gtest, numbers) {
+  ScratchList list;
+  Scratch_InitList(&list);
+
+  for (int i = 0; i < 100; ++i) {
+    Scratch_AddNumberToList(&list, i * 10);
+  }
+  ASSERT_EQ(Scratch_GetListLength(&list), 100);
+  // Numbers only, so they stay a plain array.
+  ASSERT_EQ(list.items, nullptr);
+  ASSERT_EQ(list.numbers[42], 420);
+  ASSERT_EQ(ReadItem(&list, 1), "0");
+  ASSERT_EQ(ReadItem(&list, 100), "990");
+
+  Scratch_ReplaceListItemWithNumber(&list, 1, 1.5);
+  ASSERT_EQ(ReadItem(&list, 1), "1.5");
+  Scratch_DeleteListItem(&list, 2);
+  ASSERT_EQ(Scratch_GetListLength(&list), 99);
+  ASSERT_EQ(ReadItem(&list, 2), "20");
+
+  // A string moves the items, they read the same.
+  ScratchVariable banana = MakeString("banana");
+  Scratch_AddToList(&list, &banana);
+  ASSERT_NE(list.items, nullptr);
+  ASSERT_EQ(ReadItem(&list, 2), "20");
+  ASSERT_EQ(ReadItem(&list, 100), "banana");
+
+  // Lists of strings become lists of numbers once empty.
+  Scratch_DeleteAllOfList(&list);
+  ASSERT_EQ(Scratch_GetListLength(&list), 0);
+  ASSERT_EQ(list.items, nullptr);
+  Scratch_AddNumberToList(&list, 7);
+  ASSERT_EQ(ReadItem(&list, 1), "7");
+
+  Scratch_FreeList(&list);
+}
+
+TEST(scratch_vm_lists_gtest, indices) {
+  ScratchList list;
+  Scratch_InitList(&list);
+  ScratchVariable a = MakeString("a");
+  ScratchVariable b = MakeString("b");
+  ScratchVariable c = MakeString("c");
+  Scratch_AddToList(&list, &a);
+  Scratch_AddToList(&list, &b);
+  Scratch_AddToList(&list, &c);
+
+  ASSERT_EQ(Scratch_NumberToListIndex(&list, 1), 1);
+  ASSERT_EQ(Scratch_NumberToListIndex(&list, 3.9), 3);
+  ASSERT_EQ(Scratch_NumberToListIndex(&list, 0.5), SCRATCH_VM_LIST_INVALID_INDEX);
+  ASSERT_EQ(Scratch_NumberToListIndex(&list, 4), SCRATCH_VM_LIST_INVALID_INDEX);
+  ASSERT_EQ(Scratch_NumberToListIndex(&list, NAN), SCRATCH_VM_LIST_INVALID_INDEX);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("last"), 0), 3);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("2"), 0), 2);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("all"), 0), SCRATCH_VM_LIST_INVALID_INDEX);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("all"), 1), SCRATCH_VM_LIST_INDEX_ALL);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("banana"), 0), SCRATCH_VM_LIST_INVALID_INDEX);
+
+  // Invalid indices read as an empty string and are ignored by changes.
+  ASSERT_EQ(ReadItem(&list, 0), "");
+  ASSERT_EQ(ReadItem(&list, 4), "");
+  Scratch_ReplaceListItem(&list, 4, &a);
+  Scratch_DeleteListItem(&list, SCRATCH_VM_LIST_INVALID_INDEX);
+  ASSERT_EQ(Scratch_GetListLength(&list), 3);
+
+  Scratch_ReplaceListItemWithNumber(&list, 2, 5);
+  ASSERT_EQ(ReadItem(&list, 2), "5");
+  Scratch_DeleteListItem(&list, 1);
+  ASSERT_EQ(ReadItem(&list, 1), "5");
+  ASSERT_EQ(ReadItem(&list, 2), "c");
+  Scratch_DeleteListItem(&list, SCRATCH_VM_LIST_INDEX_ALL);
+  ASSERT_EQ(Scratch_GetListLength(&list), 0);
+  ASSERT_EQ(Scratch_ToListIndex(&list, MakeString("last"), 0), SCRATCH_VM_LIST_INVALID_INDEX);
+
+  Scratch_FreeList(&list);
+}
+
+TEST(scratch_vm_lists_gtest, item_limit) {
+  ScratchList list;
+  Scratch_InitList(&list);
+  for (int i = 0; i < SCRATCH_VM_LIST_ITEM_LIMIT + 10; ++i) {
+    Scratch_AddNumberToList(&list, i);
+  }
+  ASSERT_EQ(Scratch_GetListLength(&list), SCRATCH_VM_LIST_ITEM_LIMIT);
+  Scratch_FreeList(&list);
+}
+
+// Lookups with and without the index find the same items.
+TEST(scratch_vm_lists_gtest, find_items) {
+  for (int is_indexed = 0; is_indexed < 2; ++is_indexed) {
+    ScratchList list;
+    Scratch_InitList(&list);
+    if (is_indexed) {
+      Scratch_EnableListIndex(&list);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+      Scratch_AddNumberToList(&list, i % 50);
+    }
+    ScratchVariable apple = MakeString("Apple");
+    ScratchVariable ten = MakeString(" 10.0 ");
+    ScratchVariable blank = MakeString(" ");
+    Scratch_AddToList(&list, &apple);
+    Scratch_AddToList(&list, &ten);
+    Scratch_AddToList(&list, &blank);
+    Scratch_AddNumberToList(&list, -0.0);
+    Scratch_AddNumberToList(&list, NAN);
+
+    for (int repeat = 0; repeat < 3; ++repeat) {
+      // The first of equal items.
+      ASSERT_EQ(Scratch_FindListNumber(&list, 49), 50);
+      ASSERT_EQ(Scratch_FindListNumber(&list, 0), 1);
+      ASSERT_EQ(Scratch_FindListNumber(&list, 50), 0);
+      // Numbers compare as numbers, other strings case insensitively.
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString("1e1")), 11);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString("APPLE")), 101);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString("apple ")), 0);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString(" ")), 103);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString("")), 0);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeString("nan")), 105);
+      ASSERT_EQ(Scratch_FindListItem(&list, MakeNumber(12)), 13);
+    }
+
+    // Changes are seen by lookups.
+    Scratch_DeleteListItem(&list, 1);
+    ASSERT_EQ(Scratch_FindListNumber(&list, 0), 50);
+    ASSERT_EQ(Scratch_FindListNumber(&list, 0), 50);
+    Scratch_ReplaceListItem(&list, 1, &apple);
+    ASSERT_EQ(Scratch_FindListItem(&list, MakeString("apple")), 1);
+    ASSERT_EQ(Scratch_FindListItem(&list, MakeString("apple")), 1);
+    Scratch_AddNumberToList(&list, 1000);
+    ASSERT_EQ(Scratch_FindListNumber(&list, 1000), Scratch_GetListLength(&list));
+
+    Scratch_FreeList(&list);
+  }
+}
+
+TEST(scratch_vm_lists_gtest, state) {
+  ScratchList list;
+  Scratch_InitList(&list);
+  Scratch_AddNumberToList(&list, 1);
+  ScratchVariable banana = MakeString("a banana that doesn't fit into a small string");
+  Scratch_AddToList(&list, &banana);
+  Scratch_AddNumberToList(&list, 3);
+
+  ScratchStateWriter measure = {nullptr, 0, 0};
+  Scratch_WriteStateList(&measure, &list);
+  std::vector<unsigned char> blob(measure.size);
+  ScratchStateWriter writer = {blob.data(), blob.size(), 0};
+  Scratch_WriteStateList(&writer, &list);
+
+  ScratchList loaded;
+  Scratch_InitList(&loaded);
+  Scratch_AddNumberToList(&loaded, 42);
+  ScratchStateReader reader = {blob.data(), blob.size(), 0, 0};
+  Scratch_ReadStateList(&reader, &loaded);
+  ASSERT_FALSE(reader.failed);
+  ASSERT_EQ(reader.offset, blob.size());
+  ASSERT_EQ(Scratch_GetListLength(&loaded), 3);
+  ASSERT_EQ(ReadItem(&loaded, 1), "1");
+  ASSERT_EQ(ReadItem(&loaded, 2), "a banana that doesn't fit into a small string");
+  ASSERT_EQ(ReadItem(&loaded, 3), "3");
+
+  // A truncated blob is rejected.
+  ScratchStateReader truncated_reader = {blob.data(), blob.size() - 8, 0, 0};
+  Scratch_ReadStateList(&truncated_reader, &loaded);
+  ASSERT_TRUE(truncated_reader.failed);
+
+  Scratch_FreeList(&loaded);
+  Scratch_FreeList(&list);
+}
@@ -0,0 +1,118 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-variables-internal.h"
+#include "templates/scratch-vm-clones.h"
+#include "templates/scratch-vm-lists.h"
+#include "templates/scratch-vm-state.h"
+
+namespace {
+
+std::vector<unsigned char> Save(void (*write)(ScratchStateWriter*, const void*), const void* value) {
+  ScratchStateWriter measure = {nullptr, 0, 0};
+  write(&measure, value);
+
+  std::vector<unsigned char> blob(measure.size);
+  ScratchStateWriter writer = {blob.data(), blob.size(), 0};
+  write(&writer, value);
+  EXPECT_EQ(writer.size, blob.size());
+  return blob;
+}
+
+void WriteVariable(ScratchStateWriter* writer, const void* variable) {
+  Scratch_WriteStateVariable(writer, static_cast<ScratchVariable*>(const_cast<void*>(variable)));
+}
+
+void WriteClonePool(ScratchStateWriter* writer, const void* pool) {
+  Scratch_WriteStateClonePool(writer, static_cast<const ScratchClonePool*>(pool));
+}
+
+}  // namespace
+
+TEST(scratch_vm_state_gtest, variables) {
+  const std::string long_string(100, 'a');
+
+  ScratchVariable number;
+  Scratch_InitNumberVariable(&number, 42.5);
+  ScratchVariable small_string;
+  Scratch_InitStringVariable(&small_string, "Text", /*is_const_str_value=*/1);
+  ScratchVariable heap_string;
+  Scratch_InitVariable(&heap_string);
+  Scratch_AssignStringVariable(&heap_string, long_string.c_str());
+
+  for (ScratchVariable* variable : {&number, &small_string, &heap_string}) {
+    std::vector<unsigned char> blob = Save(WriteVariable, variable);
+    ASSERT_EQ(blob.size() % 8, 0u);
+
+    ScratchVariable loaded;
+    Scratch_InitStringVariable(&loaded, "Previous", /*is_const_str_value=*/1);
+    ScratchStateReader reader = {blob.data(), blob.size(), 0, 0};
+    Scratch_ReadStateVariable(&reader, &loaded);
+    ASSERT_FALSE(reader.failed);
+    ASSERT_EQ(reader.offset, blob.size());
+    ASSERT_EQ(Scratch_ReadNumberVariable(&loaded), Scratch_ReadNumberVariable(variable));
+    ASSERT_STREQ(Scratch_ReadStringVariable(&loaded), Scratch_ReadStringVariable(variable));
+    Scratch_FreeVariable(&loaded);
+
+    // Truncated blobs fail without reading past the end.
+    ScratchVariable truncated;
+    Scratch_InitVariable(&truncated);
+    ScratchStateReader truncated_reader = {blob.data(), blob.size() - 1, 0, 0};
+    Scratch_ReadStateVariable(&truncated_reader, &truncated);
+    ASSERT_TRUE(truncated_reader.failed);
+    Scratch_FreeVariable(&truncated);
+  }
+
+  Scratch_FreeVariable(&number);
+  Scratch_FreeVariable(&small_string);
+  Scratch_FreeVariable(&heap_string);
+}
+
+TEST(scratch_vm_state_gtest, clone_pool) {
+  ScratchClonePool pool;
+  Scratch_InitClonePool(&pool);
+  std::vector<ScratchCloneId> ids;
+  for (int i = 0; i < 20; ++i) {
+    ids.push_back(Scratch_CreateClone(&pool, i, -i, 1, 0));
+  }
+  Scratch_DeleteClone(&pool, ids[3]);
+  Scratch_DeleteClone(&pool, ids[10]);
+
+  std::vector<unsigned char> blob = Save(WriteClonePool, &pool);
+
+  ScratchClonePool loaded;
+  Scratch_InitClonePool(&loaded);
+  Scratch_CreateClone(&loaded, 100, 100, 0, 0);
+  ScratchStateReader reader = {blob.data(), blob.size(), 0, 0};
+  Scratch_ReadStateClonePool(&reader, &loaded);
+  ASSERT_FALSE(reader.failed);
+  ASSERT_EQ(loaded.count, 18);
+
+  // Ids stay valid and deleted ids are reused in the same order.
+  for (int i = 0; i < 20; ++i) {
+    if (i == 3 || i == 10) {
+      continue;
+    }
+    int index = Scratch_GetCloneIndex(&loaded, ids[i]);
+    ASSERT_EQ(loaded.x[index], i);
+    ASSERT_EQ(loaded.y[index], -i);
+  }
+  ASSERT_EQ(Scratch_CreateClone(&loaded, 0, 0, 0, 0), Scratch_CreateClone(&pool, 0, 0, 0, 0));
+
+  // An id used twice is rejected.
+  std::vector<unsigned char> corrupted = blob;
+  // Counts, then x, y, direction_x, direction_y and id of every clone.
+  const size_t first_id_offset = 3 * 8 + 4 * 8;
+  const size_t second_id_offset = first_id_offset + 5 * 8;
+  std::copy(corrupted.begin() + first_id_offset, corrupted.begin() + first_id_offset + 8,
+            corrupted.begin() + second_id_offset);
+  ScratchStateReader corrupted_reader = {corrupted.data(), corrupted.size(), 0, 0};
+  Scratch_ReadStateClonePool(&corrupted_reader, &loaded);
+  ASSERT_TRUE(corrupted_reader.failed);
+
+  Scratch_FreeClonePool(&loaded);
+  Scratch_FreeClonePool(&pool);
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "templates/scratch-vm-types.h"
+#include "templates/scratch-vm-timers.h"
+
+TEST(scratch_vm_timers_gtest, heap) {
+  const ScratchNumber deadlines[] = {5, 1, 4, 1, 3, 9, 2, 6, 0.5, 7};
+  const int count = sizeof(deadlines) / sizeof(deadlines[0]);
+
+  std::vector<ScratchTimer> heap(count);
+  int size = 0;
+  for (int i = 0; i < count; ++i) {
+    Scratch_PushTimer(heap.data(), &size, ScratchTimer{deadlines[i], i});
+  }
+  ASSERT_EQ(size, count);
+
+  std::vector<ScratchNumber> sorted(deadlines, deadlines + count);
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 0; i < count; ++i) {
+    ScratchTimer timer = Scratch_PopTimer(heap.data(), &size);
+    ASSERT_EQ(timer.deadline, sorted[i]);
+    ASSERT_EQ(deadlines[timer.program], timer.deadline);
+  }
+  ASSERT_EQ(size, 0);
+
+  // Interleaved push and pop.
+  Scratch_PushTimer(heap.data(), &size, ScratchTimer{3, 0});
+  Scratch_PushTimer(heap.data(), &size, ScratchTimer{1, 1});
+  ASSERT_EQ(Scratch_PopTimer(heap.data(), &size).program, 1);
+  Scratch_PushTimer(heap.data(), &size, ScratchTimer{2, 2});
+  ASSERT_EQ(Scratch_PopTimer(heap.data(), &size).program, 2);
+  ASSERT_EQ(Scratch_PopTimer(heap.data(), &size).program, 0);
+  ASSERT_EQ(size, 0);
+}
+
+TEST(scratch_vm_timers_gtest, remove) {
+  const ScratchNumber deadlines[] = {5, 1, 4, 1, 3, 9, 2, 6, 0.5, 7};
+  const int count = sizeof(deadlines) / sizeof(deadlines[0]);
+
+  std::vector<ScratchTimer> heap(count);
+  int size = 0;
+  for (int i = 0; i < count; ++i) {
+    Scratch_PushTimer(heap.data(), &size, ScratchTimer{deadlines[i], i});
+  }
+
+  // The top, a leaf and one in the middle.
+  ASSERT_TRUE(Scratch_RemoveTimer(heap.data(), &size, 8));
+  ASSERT_TRUE(Scratch_RemoveTimer(heap.data(), &size, 9));
+  ASSERT_TRUE(Scratch_RemoveTimer(heap.data(), &size, 2));
+  ASSERT_FALSE(Scratch_RemoveTimer(heap.data(), &size, 2));
+  ASSERT_EQ(size, count - 3);
+
+  std::vector<ScratchNumber> sorted = {5, 1, 1, 3, 9, 2, 6};
+  std::sort(sorted.begin(), sorted.end());
+  for (ScratchNumber deadline : sorted) {
+    ScratchTimer timer = Scratch_PopTimer(heap.data(), &size);
+    ASSERT_EQ(timer.deadline, deadline);
+    ASSERT_EQ(deadlines[timer.program], timer.deadline);
+  }
+  ASSERT_EQ(size, 0);
+}
+
+TEST(scratch_vm_timers_gtest, program_set) {
+  uint64_t set[SCRATCH_VM_PROGRAM_SET_WORDS(130)] = {};
+  ASSERT_EQ(sizeof(set) / sizeof(set[0]), 3u);
+
+  Scratch_AddToProgramSet(set, 0);
+  Scratch_AddToProgramSet(set, 63);
+  Scratch_AddToProgramSet(set, 64);
+  Scratch_AddToProgramSet(set, 129);
+  Scratch_RemoveFromProgramSet(set, 0);
+  ASSERT_FALSE(Scratch_IsInProgramSet(set, 0));
+  ASSERT_TRUE(Scratch_IsInProgramSet(set, 64));
+
+  ASSERT_EQ(Scratch_LowestProgramInWord(set[0]), 63);
+  ASSERT_EQ(Scratch_LowestProgramInWord(set[1]), 0);
+  ASSERT_EQ(Scratch_LowestProgramInWord(set[2]), 1);
+}
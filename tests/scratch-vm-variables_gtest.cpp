@@ -1,3 +1,9 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
 #include <gtest/gtest.h>
 
 #include "templates/scratch-vm-variables-internal.h"
@@ -16,7 +22,8 @@ TEST(scratch_vm_variables_gtest, strings) {
   Scratch_InitVariable(&s4);
   Scratch_AssignVariable(&s4, &s3);
 
-  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s1)), "");
+  // A new variable is the number 0.
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s1)), "0");
   ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s2)), "chicken");
   ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s3)), "banana");
   ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s4)), "banana");
@@ -24,8 +31,11 @@ TEST(scratch_vm_variables_gtest, strings) {
   Scratch_AssignStringVariable(&s1, " ");
   ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s1)), " ");
 
-  ScratchVariable s5 = Scratch_JoinStringVariables(&s2, &s1);
-  ScratchVariable s6 = Scratch_JoinStringVariables(&s5, &s3);
+  ScratchArena arena;
+  Scratch_InitArena(&arena);
+
+  ScratchVariable s5 = Scratch_JoinStringVariables(&arena, &s2, &s1);
+  ScratchVariable s6 = Scratch_JoinStringVariables(&arena, &s5, &s3);
   ASSERT_EQ(std::string(Scratch_ReadStringVariable(&s6)), "chicken banana");
 
   Scratch_FreeVariable(&s1);
@@ -34,4 +44,177 @@ TEST(scratch_vm_variables_gtest, strings) {
   Scratch_FreeVariable(&s4);
   Scratch_FreeVariable(&s5);
   Scratch_FreeVariable(&s6);
+  Scratch_FreeArena(&arena);
+}
+
+TEST(scratch_vm_variables_gtest, string_storage) {
+  static const char kLiteral[] = "a literal that is longer than the small string buffer";
+
+  ScratchVariable literal;
+  Scratch_InitStringVariable(&literal, kLiteral, /*is_const_str_value=*/ 1);
+
+  // Interned strings are shared by pointer.
+  ScratchVariable v1;
+  Scratch_InitVariable(&v1);
+  Scratch_AssignVariable(&v1, &literal);
+  ASSERT_EQ(v1.str_storage, kScratchStringStorageInterned);
+  ASSERT_EQ(Scratch_ReadStringVariable(&v1), kLiteral);
+
+  // Short strings are stored inline.
+  ScratchVariable v2;
+  Scratch_InitVariable(&v2);
+  Scratch_AssignStringVariable(&v2, "banana");
+  ASSERT_EQ(v2.str_storage, kScratchStringStorageSmall);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v2)), "banana");
+
+  ScratchArena arena;
+  Scratch_InitArena(&arena);
+
+  // Joins that fit are stored inline too.
+  ScratchVariable v3 = Scratch_JoinStringVariables(&arena, &v2, &v2);
+  ASSERT_EQ(v3.str_storage, kScratchStringStorageSmall);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v3)), "bananabanana");
+
+  // Long joins are allocated from the arena and copied on assignment.
+  ScratchVariable v4 = Scratch_JoinStringVariables(&arena, &literal, &v3);
+  ASSERT_EQ(v4.str_storage, kScratchStringStorageBorrowed);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v4)), std::string(kLiteral) + "bananabanana");
+
+  Scratch_AssignVariable(&v1, &v4);
+  ASSERT_EQ(v1.str_storage, kScratchStringStorageHeap);
+  ASSERT_NE(Scratch_ReadStringVariable(&v1), Scratch_ReadStringVariable(&v4));
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v1)), std::string(kLiteral) + "bananabanana");
+
+  // Assigning a variable to itself keeps its value.
+  Scratch_AssignVariable(&v1, &v1);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v1)), std::string(kLiteral) + "bananabanana");
+
+  // Borrowing doesn't copy and assigning the borrowed value back is a no-op.
+  ScratchVariable v5;
+  Scratch_BorrowVariable(&v5, &v1);
+  ASSERT_EQ(v5.str_storage, kScratchStringStorageBorrowed);
+  ASSERT_EQ(Scratch_ReadStringVariable(&v5), Scratch_ReadStringVariable(&v1));
+  Scratch_AssignVariable(&v1, &v5);
+  ASSERT_EQ(v1.str_storage, kScratchStringStorageHeap);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v1)), std::string(kLiteral) + "bananabanana");
+
+  Scratch_AssignNumberVariable(&v1, 42);
+  ASSERT_EQ(v1.str_storage, kScratchStringStorageNone);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&v1)), "42");
+  ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(&v1), 42);
+
+  Scratch_FreeVariable(&literal);
+  Scratch_FreeVariable(&v1);
+  Scratch_FreeVariable(&v2);
+  Scratch_FreeVariable(&v3);
+  Scratch_FreeVariable(&v4);
+  Scratch_FreeVariable(&v5);
+  Scratch_FreeArena(&arena);
+}
+
+TEST(scratch_vm_variables_gtest, arena) {
+  ScratchArena arena;
+  Scratch_InitArena(&arena);
+
+  char* p1 = static_cast<char*>(Scratch_AllocateFromArena(&arena, 10));
+  char* p2 = static_cast<char*>(Scratch_AllocateFromArena(&arena, 10));
+  ASSERT_NE(p1, p2);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(p2) % 16, 0u);
+
+  // Doesn't fit into a regular block.
+  char* p3 = static_cast<char*>(Scratch_AllocateFromArena(&arena, 2 * SCRATCH_VM_ARENA_BLOCK_SIZE));
+  memset(p3, 0, 2 * SCRATCH_VM_ARENA_BLOCK_SIZE);
+
+  // Memory is reused after reset.
+  Scratch_ResetArena(&arena);
+  ASSERT_EQ(Scratch_AllocateFromArena(&arena, 10), p1);
+  ASSERT_EQ(Scratch_AllocateFromArena(&arena, 10), p2);
+  ASSERT_EQ(Scratch_AllocateFromArena(&arena, 2 * SCRATCH_VM_ARENA_BLOCK_SIZE), p3);
+
+  Scratch_FreeArena(&arena);
+}
+
+TEST(scratch_vm_variables_gtest, strings_as_numbers) {
+  const std::pair<const char*, ScratchNumber> cases[] = {
+      {"42", 42}, {" -1.5\n", -1.5}, {"1e3", 1000}, {"0x10", 16}, {"", 0},
+      {"   ", 0}, {"12abc", 0}, {"banana", 0}, {"nan", 0}, {"Infinity", INFINITY},
+      // Only what JavaScript Number() reads: no other spellings of infinity, no signed or fractional hex.
+      {" -Infinity ", -INFINITY}, {"inf", 0}, {"infinity", 0}, {"-INF", 0}, {"NaN", 0}, {"0x1p3", 0},
+      {"-0x10", 0}, {"0x", 0}, {"0b101", 5}, {"0o17", 15}, {"0b2", 0}, {".5", 0.5}, {"1e", 0},
+  };
+  for (const auto& [str, number] : cases) {
+    ScratchVariable variable;
+    Scratch_InitVariable(&variable);
+    Scratch_AssignStringVariable(&variable, str);
+    ASSERT_EQ(Scratch_ReadNumberVariable(&variable), number) << str;
+    // The string itself is kept.
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(&variable)), str);
+    Scratch_FreeVariable(&variable);
+  }
+}
+
+TEST(scratch_vm_variables_gtest, numbers_as_strings) {
+  const std::pair<ScratchNumber, const char*> cases[] = {
+      {42, "42"}, {-7, "-7"}, {-0.0, "0"}, {0.1, "0.1"}, {1.0 / 3, "0.3333333333333333"},
+      {1e20, "100000000000000000000"}, {1e21, "1e+21"}, {1.5e-7, "1.5e-7"},
+      // Like JavaScript, only numbers below 1e-6 are printed with an exponent.
+      {1e-5, "0.00001"}, {1.2e-5, "0.000012"}, {-1e-6, "-0.000001"}, {1e-7, "1e-7"}, {5e-324, "5e-324"},
+      {0.1 + 0.2, "0.30000000000000004"}, {123.456, "123.456"}, {-1.5e22, "-1.5e+22"},
+      {1.7976931348623157e308, "1.7976931348623157e+308"}, {1152921504606846976.0, "1152921504606847000"},
+      {NAN, "NaN"}, {INFINITY, "Infinity"}, {-INFINITY, "-Infinity"},
+  };
+  for (const auto& [number, str] : cases) {
+    ScratchVariable variable;
+    Scratch_InitNumberVariable(&variable, number);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(&variable)), str);
+    ASSERT_EQ(variable.str_storage, kScratchStringStorageNone);
+  }
+}
+
+TEST(scratch_vm_variables_gtest, conversion_cache) {
+  ScratchVariable variable;
+  Scratch_InitVariable(&variable);
+
+  // Conversions are computed once and dropped by the next assignment.
+  Scratch_AssignStringVariable(&variable, "12");
+  ASSERT_EQ(variable.cached, 0);
+  ASSERT_EQ(Scratch_ReadNumberVariable(&variable), 12);
+  ASSERT_EQ(variable.cached, kScratchVariableCachedNumber);
+  ASSERT_EQ(Scratch_ReadNumberVariable(&variable), 12);
+
+  Scratch_AssignStringVariable(&variable, "13");
+  ASSERT_EQ(variable.cached, 0);
+  ASSERT_EQ(Scratch_ReadNumberVariable(&variable), 13);
+
+  Scratch_AssignNumberVariable(&variable, 2.5);
+  ASSERT_EQ(variable.cached, 0);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&variable)), "2.5");
+  ASSERT_EQ(variable.cached, kScratchVariableCachedString);
+  Scratch_AssignNumberVariable(&variable, 3.5);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&variable)), "3.5");
+
+  // Copies of a string keep its number, borrowed values keep both.
+  ScratchVariable source;
+  Scratch_InitStringVariable(&source, "7", /*is_const_str_value=*/ 1);
+  ASSERT_EQ(Scratch_ReadNumberVariable(&source), 7);
+  Scratch_AssignVariable(&variable, &source);
+  ASSERT_EQ(variable.cached, kScratchVariableCachedNumber);
+  ASSERT_EQ(Scratch_ReadNumberVariable(&variable), 7);
+
+  ScratchVariable borrowed;
+  Scratch_AssignNumberVariable(&variable, 8);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&variable)), "8");
+  Scratch_BorrowVariable(&borrowed, &variable);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&borrowed)), "8");
+
+  // A number joined with a string is printed.
+  ScratchArena arena;
+  Scratch_InitArena(&arena);
+  ScratchVariable joined = Scratch_JoinStringVariables(&arena, &variable, &source);
+  ASSERT_EQ(std::string(Scratch_ReadStringVariable(&joined)), "87");
+  ASSERT_EQ(Scratch_ReadNumberVariable(&joined), 87);
+  Scratch_FreeArena(&arena);
+
+  Scratch_FreeVariable(&variable);
+  Scratch_FreeVariable(&source);
 }
@@ -0,0 +1,59 @@
+// Header of the transpiled sleeping scripts program of size 3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <gtest/gtest.h>
+
+// Scripts wait 1000, 1001 and 1002 seconds, then increment Counter.
+TEST(sleeping_scripts_gtest, wake_up_in_order) {
+    ScratchContext* ctx = Scratch_NewContext();
+    ScratchVariable* counter = Scratch_FindVariable(ctx, "Stage", "Counter");
+
+    for (int i = 0; i < 999; ++i) {
+        Scratch_Advance(ctx, 1);
+    }
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(counter), 0);
+
+    Scratch_Advance(ctx, 0.5);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(counter), 0);
+
+    // The wait ends in the tick which ends at or after its deadline.
+    Scratch_Advance(ctx, 0.5);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(counter), 1);
+
+    // Two deadlines passed within a single tick.
+    Scratch_Advance(ctx, 5);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(counter), 3);
+
+    Scratch_Advance(ctx, 5);
+    ASSERT_FLOAT_EQ(Scratch_ReadNumberVariable(counter), 3);
+
+    Scratch_DeleteContext(ctx);
+}
+
+TEST(sleeping_scripts_gtest, advance_until) {
+    ScratchContext* stepped = Scratch_NewContext();
+    ScratchContext* skipped = Scratch_NewContext();
+    ScratchVariable* stepped_counter = Scratch_FindVariable(stepped, "Stage", "Counter");
+    ScratchVariable* skipped_counter = Scratch_FindVariable(skipped, "Stage", "Counter");
+
+    const ScratchNumber dt = 1.0 / 30.0;
+    ScratchNumber time = 0;
+    size_t ticks = 0;
+    size_t skipped_ticks = 0;
+    for (ScratchNumber target_time : {999.99, 1000.0, 1000.01, 1001.5, 1010.0}) {
+        while (time + dt <= target_time) {
+            Scratch_Advance(stepped, dt);
+            time += dt;
+            ++ticks;
+        }
+
+        skipped_ticks += Scratch_AdvanceUntil(skipped, target_time, dt);
+        ASSERT_EQ(Scratch_ReadNumberVariable(skipped_counter), Scratch_ReadNumberVariable(stepped_counter));
+    }
+    ASSERT_EQ(Scratch_ReadNumberVariable(skipped_counter), 3);
+    // Only the first tick and the ticks ending the waits are advanced.
+    ASSERT_EQ(skipped_ticks, ticks - 4);
+
+    Scratch_DeleteContext(skipped);
+    Scratch_DeleteContext(stepped);
+}
@@ -0,0 +1,119 @@
+// Header of the transpiled sleeping scripts program of size 3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Blobs are kept in 8 byte words, the way a memory mapped file is aligned.
+std::vector<uint64_t> SaveState(ScratchContext* ctx) {
+    size_t size = Scratch_SaveState(ctx, nullptr, 0);
+    EXPECT_EQ(size % sizeof(uint64_t), 0u);
+    std::vector<uint64_t> blob(size / sizeof(uint64_t));
+    EXPECT_EQ(Scratch_SaveState(ctx, blob.data(), size), size);
+    return blob;
+}
+
+ScratchNumber ReadCounter(ScratchContext* ctx) {
+    return Scratch_ReadNumberVariable(Scratch_FindVariable(ctx, "Stage", "Counter"));
+}
+
+}  // namespace
+
+// Scripts wait 1000, 1001 and 1002 seconds, then increment Counter.
+TEST(state_gtest, fork_sleeping_scripts) {
+    ScratchContext* ctx = Scratch_NewContext();
+    for (int i = 0; i < 1000; ++i) {
+        Scratch_Advance(ctx, 1);
+    }
+    ASSERT_FLOAT_EQ(ReadCounter(ctx), 1);
+    std::vector<uint64_t> blob = SaveState(ctx);
+
+    // Forks continue exactly where the original is, even when they ran ahead before loading.
+    std::vector<ScratchContext*> forks;
+    for (int i = 0; i < 3; ++i) {
+        ScratchContext* fork = Scratch_NewContext();
+        for (int j = 0; j < i * 1001; ++j) {
+            Scratch_Advance(fork, 1);
+        }
+        ASSERT_EQ(Scratch_LoadState(fork, blob.data(), blob.size() * sizeof(uint64_t)), kScratchLoadStateOk);
+        forks.push_back(fork);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        Scratch_Advance(ctx, 0.5);
+        for (ScratchContext* fork : forks) {
+            Scratch_Advance(fork, 0.5);
+            ASSERT_EQ(ReadCounter(fork), ReadCounter(ctx));
+        }
+    }
+    ASSERT_FLOAT_EQ(ReadCounter(ctx), 3);
+    ASSERT_EQ(SaveState(forks[0]), SaveState(ctx));
+
+    for (ScratchContext* fork : forks) {
+        Scratch_DeleteContext(fork);
+    }
+    Scratch_DeleteContext(ctx);
+}
+
+TEST(state_gtest, rejects_other_blobs) {
+    ScratchContext* ctx = Scratch_NewContext();
+    Scratch_Advance(ctx, 1);
+    std::vector<uint64_t> blob = SaveState(ctx);
+    const size_t size = blob.size() * sizeof(uint64_t);
+    ScratchStateHeader header;
+    std::memcpy(&header, blob.data(), sizeof(header));
+
+    ScratchContext* loaded = Scratch_NewContext();
+    ASSERT_EQ(Scratch_LoadState(loaded, blob.data(), size - 1), kScratchLoadStateInvalid);
+    ASSERT_EQ(Scratch_LoadState(loaded, blob.data(), 4), kScratchLoadStateInvalid);
+
+    std::vector<uint64_t> other_version = blob;
+    reinterpret_cast<ScratchStateHeader*>(other_version.data())->version = header.version + 1;
+    ASSERT_EQ(Scratch_LoadState(loaded, other_version.data(), size), kScratchLoadStateUnsupportedVersion);
+
+    std::vector<uint64_t> other_program = blob;
+    reinterpret_cast<ScratchStateHeader*>(other_program.data())->program_hash = header.program_hash + 1;
+    ASSERT_EQ(Scratch_LoadState(loaded, other_program.data(), size), kScratchLoadStateOtherProgram);
+
+    // Rejected blobs leave the context untouched.
+    Scratch_Advance(loaded, 1);
+    Scratch_Advance(loaded, 999);
+    ASSERT_FLOAT_EQ(ReadCounter(loaded), 1);
+
+    // The blob claims to end before its last field, the partially loaded context is reinitialized.
+    std::vector<uint64_t> corrupted = blob;
+    reinterpret_cast<ScratchStateHeader*>(corrupted.data())->size = size - sizeof(uint64_t);
+    ASSERT_EQ(Scratch_LoadState(loaded, corrupted.data(), size), kScratchLoadStateInvalid);
+    ASSERT_FLOAT_EQ(ReadCounter(loaded), 0);
+
+    // The blob ends with the runnable programs, then the 3 timers of the sleeping scripts as the count and
+    // (deadline, program) pairs.
+    const size_t runnable = blob.size() - 8;
+    ASSERT_EQ(blob[runnable], 0u);
+    ASSERT_EQ(blob[runnable + 1], 3u);
+    const size_t first_program = runnable + 3;
+
+    // Programs past the end of the program table.
+    std::vector<uint64_t> unknown_program = blob;
+    unknown_program[runnable] |= uint64_t{1} << 63;
+    ASSERT_EQ(Scratch_LoadState(loaded, unknown_program.data(), size), kScratchLoadStateInvalid);
+
+    // A sleeping program which is runnable too.
+    std::vector<uint64_t> runnable_sleeping = blob;
+    runnable_sleeping[runnable] |= uint64_t{1} << blob[first_program];
+    ASSERT_EQ(Scratch_LoadState(loaded, runnable_sleeping.data(), size), kScratchLoadStateInvalid);
+
+    // A program sleeping twice.
+    std::vector<uint64_t> duplicate_timer = blob;
+    duplicate_timer[first_program + 2] = blob[first_program];
+    ASSERT_EQ(Scratch_LoadState(loaded, duplicate_timer.data(), size), kScratchLoadStateInvalid);
+
+    ASSERT_EQ(Scratch_LoadState(loaded, blob.data(), size), kScratchLoadStateOk);
+    Scratch_DeleteContext(loaded);
+    Scratch_DeleteContext(ctx);
+}
@@ -1,25 +1,83 @@
-#include "variables.h"
+// Header of the transpiled variables.sb3, defined by the build.
+#include SCRATCH_PROGRAM_HEADER
 
 #include <gtest/gtest.h>
 
 TEST(variables_gtest, simple) {
-    Scratch_Init();
+    ScratchContext* ctx = Scratch_NewContext();
 
-    Scratch_Advance(0.5);
-    ScratchVariable* v1 = Scratch_FindVariable("Stage", "Number");
+    Scratch_Advance(ctx, 0.5);
+    ScratchVariable* v1 = Scratch_FindVariable(ctx, "Stage", "Number");
     ASSERT_FLOAT_EQ(v1->number_value, 7);
-    ScratchVariable* v2 = Scratch_FindVariable("Stage", "Another Number");
+    ScratchVariable* v2 = Scratch_FindVariable(ctx, "Stage", "Another Number");
     ASSERT_FLOAT_EQ(v2->number_value, 30);
-    ScratchVariable* v3 = Scratch_FindVariable("Stage", "Text");
-    ASSERT_EQ(std::string(v3->str_value), "Text");
-    ScratchVariable* v4 = Scratch_FindVariable("Stage", "Another Text");
-    ASSERT_EQ(std::string(v4->str_value), "Another Text");
-
-    Scratch_Advance(0.4);
-    ASSERT_EQ(std::string(v3->str_value), "Text");
-    ASSERT_EQ(std::string(v4->str_value), "Another Text");
-
-    Scratch_Advance(0.2);
-    ASSERT_EQ(std::string(v3->str_value), "chicken banana chicken banana chicken banana banana banana banana");
-    ASSERT_EQ(std::string(v4->str_value), "chicken");
+    ScratchVariable* v3 = Scratch_FindVariable(ctx, "Stage", "Text");
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v3)), "Text");
+    ScratchVariable* v4 = Scratch_FindVariable(ctx, "Stage", "Another Text");
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v4)), "Another Text");
+
+    Scratch_Advance(ctx, 0.4);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v3)), "Text");
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v4)), "Another Text");
+
+    Scratch_Advance(ctx, 0.2);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v3)), "chicken banana chicken banana chicken banana banana banana banana");
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(v4)), "chicken");
+
+    Scratch_DeleteContext(ctx);
+}
+
+TEST(variables_gtest, independent_contexts) {
+    ScratchContext* ctx1 = Scratch_NewContext();
+    ScratchContext* ctx2 = Scratch_NewContext();
+
+    ScratchVariable* text1 = Scratch_FindVariable(ctx1, "Stage", "Text");
+    ScratchVariable* text2 = Scratch_FindVariable(ctx2, "Stage", "Text");
+    ASSERT_NE(text1, text2);
+    const std::string initial_text = Scratch_ReadStringVariable(text2);
+
+    Scratch_Advance(ctx1, 0.5);
+    Scratch_Advance(ctx1, 0.4);
+    Scratch_Advance(ctx1, 0.2);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(text1)), "chicken banana chicken banana chicken banana banana banana banana");
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(text2)), initial_text);
+
+    Scratch_Advance(ctx2, 0.5);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(text2)), "Text");
+
+    // Reinitializing a context restarts its program.
+    Scratch_Free(ctx1);
+    Scratch_Init(ctx1);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(text1)), initial_text);
+    Scratch_Advance(ctx1, 0.5);
+    ASSERT_EQ(std::string(Scratch_ReadStringVariable(text1)), "Text");
+
+    Scratch_DeleteContext(ctx2);
+    Scratch_DeleteContext(ctx1);
+}
+
+TEST(variables_gtest, handles) {
+    ScratchContext* ctx1 = Scratch_NewContext();
+    ScratchContext* ctx2 = Scratch_NewContext();
+
+    const char* names[] = {"Number", "Another Number", "Text", "Another Text"};
+    ScratchVariableHandle handles[4];
+    for (int i = 0; i < 4; ++i) {
+        handles[i] = Scratch_ResolveVariable("Stage", names[i]);
+        ASSERT_NE(handles[i], SCRATCH_VM_INVALID_VARIABLE_HANDLE);
+        for (int j = 0; j < i; ++j) {
+            ASSERT_NE(handles[i], handles[j]);
+        }
+
+        ASSERT_EQ(Scratch_GetVariable(ctx1, handles[i]), Scratch_FindVariable(ctx1, "Stage", names[i]));
+        ASSERT_EQ(Scratch_GetVariable(ctx2, handles[i]), Scratch_FindVariable(ctx2, "Stage", names[i]));
+    }
+
+    ASSERT_EQ(Scratch_ResolveVariable("Stage", "Unknown"), SCRATCH_VM_INVALID_VARIABLE_HANDLE);
+    ASSERT_EQ(Scratch_ResolveVariable("Sprite1", "Number"), SCRATCH_VM_INVALID_VARIABLE_HANDLE);
+    ASSERT_EQ(Scratch_ResolveVariable("", ""), SCRATCH_VM_INVALID_VARIABLE_HANDLE);
+    ASSERT_EQ(Scratch_FindVariable(ctx1, "Stage", "Unknown"), nullptr);
+
+    Scratch_DeleteContext(ctx2);
+    Scratch_DeleteContext(ctx1);
 }